@@ -0,0 +1,628 @@
+/*
+    RIFF file process library
+
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "soundfont_parser.h"
+#include "soundfont_synth.h"
+
+#define BENCH_PATH "sf2Bench.sf2"  // the generated font, removed afterwards unless -o names it
+#define BENCH_RATE 44100
+#define BENCH_BLOCK 256  // frames per render call
+
+// records per unit of scale; pdta indices are 16 bits wide, which keeps the scale at 6 or below
+#define BENCH_PRESETS 1600
+#define BENCH_INSTRUMENTS 800
+#define BENCH_SAMPLES 1000
+#define BENCH_INST_ZONES 4
+#define BENCH_MAX_SCALE 6
+#define BENCH_SAMPLE_PAD 46  // zero points after every sample, as the specification asks for
+
+typedef struct PdtaLayout {
+    const char *fourcc;
+    uint8_t fields[10];  // byte width of each field, 0 terminated
+} PdtaLayout;
+
+static PdtaLayout LAYOUTS[9] = {
+    {"phdr", {20, 2, 2, 2, 4, 4, 4}},
+    {"pbag", {2, 2}},
+    {"pmod", {2, 2, 2, 2, 2}},
+    {"pgen", {2, 2}},
+    {"inst", {20, 2}},
+    {"ibag", {2, 2}},
+    {"imod", {2, 2, 2, 2, 2}},
+    {"igen", {2, 2}},
+    {"shdr", {20, 4, 4, 4, 4, 4, 1, 1, 2, 2}}};
+
+// everything the benchmarks share, loaded once
+typedef struct Bench {
+    int iterations;
+    FILE *file;
+    SoundFontChunkDirectory directory;
+    const SoundFontChunk *pdtaChunk;
+    SoundFontSdtaLocation sdta;
+    uint8_t *pdtaBuffer;  // the pdta sub-chunks
+    SoundFontMapping whole;  // the entire file, for the in-place parse
+    uint64_t records;        // pdta records, what a parse has to hand out
+    SoundFontPdtaData pdta;
+    SoundFontRegionIndex regions;
+    SoundFontZoneTable zones;
+    const char *path;
+    SoundFontFont font;
+    SoundFontSynth synth;
+    uint32_t voices;
+    double *times;  // seconds of every iteration of the running benchmark
+} Bench;
+
+typedef bool (*BenchStep)(Bench *bench);
+
+static uint32_t record_size(PdtaLayout *layout) {
+    uint32_t size = 0;
+    for (int i = 0; i < 10 && layout->fields[i] != 0; i++) {
+        size += layout->fields[i];
+    }
+    return size;
+}
+
+static void put_u16(FILE *file, uint32_t value) {
+    fputc(value & 0xFF, file);
+    fputc((value >> 8) & 0xFF, file);
+}
+
+static void put_u32(FILE *file, uint32_t value) {
+    put_u16(file, value & 0xFFFF);
+    put_u16(file, value >> 16);
+}
+
+static void put_chunk(FILE *file, const char *fourcc, uint32_t size) {
+    fwrite(fourcc, 1, 4, file);
+    put_u32(file, size);
+}
+
+static void put_name(FILE *file, const char *format, uint32_t index) {
+    char name[21];
+    memset(name, 0, sizeof(name));
+    snprintf(name, sizeof(name), format, index);
+    fwrite(name, 1, 20, file);
+}
+
+/*
+    Writes a valid sound font of scale * BENCH_PRESETS presets. Every preset splits the keyboard
+    between two instruments, every instrument has a global zone with one generator and one
+    modulator and BENCH_INST_ZONES looped zones, and megabytes of sample points are shared out
+    among scale * BENCH_SAMPLES samples.
+*/
+static bool generate_font(const char *path, uint32_t scale, uint32_t megabytes) {
+    uint32_t presets = BENCH_PRESETS * scale;
+    uint32_t instruments = BENCH_INSTRUMENTS * scale;
+    uint32_t samples = BENCH_SAMPLES * scale;
+    uint32_t instGens = 3 * BENCH_INST_ZONES + 1;  // per instrument
+    uint32_t frames = (uint32_t)(((uint64_t)megabytes << 20) / 2 / samples);
+    frames = frames > 256 + BENCH_SAMPLE_PAD ? frames - BENCH_SAMPLE_PAD : 256;
+
+    uint32_t counts[9] = {presets + 1, 2 * presets + 1, 1, 4 * presets + 1, instruments + 1, instruments * (BENCH_INST_ZONES + 1) + 1, instruments + 1,
+                          instruments * instGens + 1, samples + 1};
+    uint32_t pdtaSize = 4;
+    for (int i = 0; i < 9; i++) {
+        pdtaSize += 8 + counts[i] * record_size(LAYOUTS + i);
+    }
+    uint32_t smplSize = samples * (frames + BENCH_SAMPLE_PAD) * 2;
+    uint32_t infoSize = 4 + 12 + 16 + 18;
+
+    FILE *file = fopen(path, "wb");
+    if (NULL == file) {
+        printf("Can't create %s.\n", path);
+        return false;
+    }
+    put_chunk(file, "RIFF", 4 + 8 + infoSize + 8 + 4 + 8 + smplSize + 8 + pdtaSize);
+    fwrite("sfbk", 1, 4, file);
+    put_chunk(file, "LIST", infoSize);
+    fwrite("INFO", 1, 4, file);
+    put_chunk(file, "ifil", 4);
+    put_u16(file, 2);
+    put_u16(file, 1);
+    put_chunk(file, "isng", 8);
+    fwrite("EMU8000\0", 1, 8, file);
+    put_chunk(file, "INAM", 10);
+    fwrite("Benchmark\0", 1, 10, file);
+
+    // a cycle of a few dozen points per sample, so the samples differ and loop on whole cycles
+    put_chunk(file, "LIST", 4 + 8 + smplSize);
+    fwrite("sdta", 1, 4, file);
+    put_chunk(file, "smpl", smplSize);
+    int16_t *points = (int16_t *)malloc(sizeof(int16_t) * (frames + BENCH_SAMPLE_PAD));
+    if (NULL == points) {
+        printf("Not enough memory for generating samples.\n");
+        fclose(file);
+        return false;
+    }
+    for (uint32_t i = 0; i < samples; i++) {
+        uint32_t period = 40 + i % 60;
+        for (uint32_t p = 0; p < period && p < frames; p++) {
+            points[p] = (int16_t)lrint(12000.0 * sin(6.283185307179586 * p / period) + (i * 37 % 2000));
+        }
+        for (uint32_t p = period; p < frames; p++) {
+            points[p] = points[p - period];
+        }
+        memset(points + frames, 0, sizeof(int16_t) * BENCH_SAMPLE_PAD);
+        for (uint32_t p = 0; p < frames + BENCH_SAMPLE_PAD; p++) {
+            put_u16(file, (uint16_t)points[p]);
+        }
+    }
+    free(points);
+
+    put_chunk(file, "LIST", pdtaSize);
+    fwrite("pdta", 1, 4, file);
+    put_chunk(file, "phdr", counts[0] * 38);
+    for (uint32_t i = 0; i <= presets; i++) {
+        put_name(file, i < presets ? "Preset %u" : "EOP", i);
+        put_u16(file, i < presets ? i % 128 : 0);
+        put_u16(file, i < presets ? i / 128 : 0);
+        put_u16(file, 2 * i);
+        put_u32(file, 0);
+        put_u32(file, 0);
+        put_u32(file, 0);
+    }
+    put_chunk(file, "pbag", counts[1] * 4);
+    for (uint32_t z = 0; z <= 2 * presets; z++) {
+        put_u16(file, 2 * z);
+        put_u16(file, 0);
+    }
+    put_chunk(file, "pmod", 10);
+    for (int k = 0; k < 5; k++) {
+        put_u16(file, 0);
+    }
+    put_chunk(file, "pgen", counts[3] * 4);
+    for (uint32_t z = 0; z < 2 * presets; z++) {
+        put_u16(file, SOUNDFONT_GEN_KEY_RANGE);
+        put_u16(file, z % 2 == 0 ? 63 << 8 : 127 << 8 | 64);
+        put_u16(file, SOUNDFONT_GEN_INSTRUMENT);
+        put_u16(file, z % instruments);
+    }
+    put_u32(file, 0);
+    put_chunk(file, "inst", counts[4] * 22);
+    for (uint32_t i = 0; i <= instruments; i++) {
+        put_name(file, i < instruments ? "Instrument %u" : "EOI", i);
+        put_u16(file, i * (BENCH_INST_ZONES + 1));
+    }
+    put_chunk(file, "ibag", counts[5] * 4);
+    for (uint32_t i = 0; i < instruments; i++) {
+        for (uint32_t z = 0; z <= BENCH_INST_ZONES; z++) {
+            put_u16(file, i * instGens + (z == 0 ? 0 : 1 + 3 * (z - 1)));
+            put_u16(file, z == 0 ? i : i + 1);
+        }
+    }
+    put_u16(file, instruments * instGens);
+    put_u16(file, instruments);
+    put_chunk(file, "imod", counts[6] * 10);
+    for (uint32_t i = 0; i <= instruments; i++) {
+        // the modulation wheel to vibrato depth
+        put_u16(file, i < instruments ? 0x0081 : 0);
+        put_u16(file, i < instruments ? SOUNDFONT_GEN_VIB_LFO_TO_PITCH : 0);
+        put_u16(file, i < instruments ? 50 : 0);
+        put_u16(file, 0);
+        put_u16(file, 0);
+    }
+    put_chunk(file, "igen", counts[7] * 4);
+    for (uint32_t i = 0; i < instruments; i++) {
+        put_u16(file, SOUNDFONT_GEN_RELEASE_VOL_ENV);
+        put_u16(file, 0);
+        for (uint32_t z = 0; z < BENCH_INST_ZONES; z++) {
+            uint32_t low = z * 128 / BENCH_INST_ZONES;
+            uint32_t high = (z + 1) * 128 / BENCH_INST_ZONES - 1;
+            put_u16(file, SOUNDFONT_GEN_KEY_RANGE);
+            put_u16(file, high << 8 | low);
+            put_u16(file, SOUNDFONT_GEN_SAMPLE_MODES);
+            put_u16(file, SOUNDFONT_LOOP_CONTINUOUS);
+            put_u16(file, SOUNDFONT_GEN_SAMPLE_ID);
+            put_u16(file, (i * BENCH_INST_ZONES + z) % samples);
+        }
+    }
+    put_u32(file, 0);
+    put_chunk(file, "shdr", counts[8] * 46);
+    for (uint32_t i = 0; i <= samples; i++) {
+        uint32_t start = i * (frames + BENCH_SAMPLE_PAD);
+        uint32_t period = 40 + i % 60;
+        put_name(file, i < samples ? "Sample %u" : "EOS", i);
+        put_u32(file, i < samples ? start : 0);
+        put_u32(file, i < samples ? start + frames : 0);
+        put_u32(file, i < samples ? start + 8 : 0);
+        put_u32(file, i < samples ? start + 8 + period * ((frames - 16) / period) : 0);
+        put_u32(file, i < samples ? BENCH_RATE : 0);
+        fputc(i < samples ? 60 : 0, file);
+        fputc(0, file);
+        put_u16(file, 0);
+        put_u16(file, i < samples ? 1 : 0);
+    }
+
+    bool ok = 0 == ferror(file);
+    ok = 0 == fclose(file) && ok;
+    if (!ok) {
+        printf("Failed to write %s.\n", path);
+    }
+
+    return ok;
+}
+
+/*
+    The per field reader soundfont_read_pdta used to be: one fread and one manual byte swap
+    for every field of every record.
+*/
+static bool legacy_read_pdta(uint32_t **tables, FILE *file) {
+    uint8_t buffer[20];
+    for (int i = 0; i < 9; i++) {
+        char fourcc[5];
+        if (!soundfont_read_fourcc(fourcc, file)) {
+            return false;
+        }
+        uint32_t chunkSize = soundfont_read_size(file);
+
+        PdtaLayout *layout = LAYOUTS + i;
+        uint32_t count = chunkSize / record_size(layout);
+        uint32_t *values = (uint32_t *)malloc(sizeof(uint32_t) * 10 * (count + 1));
+        tables[i] = values;
+        for (uint32_t j = 0; j < count; j++) {
+            for (int k = 0; k < 10 && layout->fields[k] != 0; k++) {
+                uint8_t width = layout->fields[k];
+                if (width != fread(buffer, 1, width, file)) {
+                    return false;
+                }
+                if (width == 4) {
+                    *values++ = buffer[0] | buffer[1] << 8 | buffer[2] << 16 | (uint32_t)buffer[3] << 24;
+                } else if (width == 2) {
+                    *values++ = buffer[0] | buffer[1] << 8;
+                } else {
+                    *values++ = buffer[0];
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+static bool step_pdta_per_field(Bench *bench) {
+    uint32_t *tables[9] = {NULL};
+    bool ok = soundfont_os_seek(bench->file, bench->pdtaChunk->offset) && legacy_read_pdta(tables, bench->file);
+    for (int j = 0; j < 9; j++) {
+        free(tables[j]);
+    }
+    return ok;
+}
+
+static bool step_pdta_read(Bench *bench) {
+    SoundFontPdtaData pdta;
+    soundfont_init_pdta(&pdta);
+    bool ok = soundfont_os_seek(bench->file, bench->pdtaChunk->offset) && soundfont_read_pdta(&pdta, bench->pdtaChunk->size, bench->file);
+    soundfont_release_pdta(&pdta);
+    return ok;
+}
+
+static bool step_pdta_decode(Bench *bench) {
+    SoundFontPdtaData pdta;
+    soundfont_init_pdta(&pdta);
+    bool ok = soundfont_decode_pdta(&pdta, bench->pdtaBuffer, bench->pdtaChunk->size);
+    soundfont_release_pdta(&pdta);
+    return ok;
+}
+
+static bool step_pdta_parallel(Bench *bench) {
+    SoundFontPdtaData pdta;
+    soundfont_init_pdta(&pdta);
+    bool ok = soundfont_read_pdta_parallel(&pdta, &bench->directory, bench->file, 0);
+    soundfont_release_pdta(&pdta);
+    return ok;
+}
+
+static bool count_record(void *user, SoundFontRecordType type, uint32_t index, const void *record) {
+    (void)type;
+    (void)index;
+    (void)record;
+    (*(uint64_t *)user)++;
+    return true;
+}
+
+// the streaming parser hands out every record and seeks over the sample data nobody asked for
+static bool step_pdta_parse_file(Bench *bench) {
+    uint64_t count = 0;
+    SoundFontParseHandler handler = {&count, NULL, count_record, NULL, SOUNDFONT_RECORD_ALL};
+    bool ok = soundfont_os_seek(bench->file, 0) && soundfont_parse_file(bench->file, &handler);
+    return ok && count == bench->records;
+}
+
+static bool step_pdta_parse_memory(Bench *bench) {
+    uint64_t count = 0;
+    SoundFontParseHandler handler = {&count, NULL, count_record, NULL, SOUNDFONT_RECORD_ALL};
+    bool ok = soundfont_parse_memory(bench->whole.data, bench->whole.size, &handler);
+    return ok && count == bench->records;
+}
+
+static bool step_sdta_read(Bench *bench) {
+    SoundFontSdtaData sdta;
+    bool ok = soundfont_os_seek(bench->file, bench->sdta.smplOffset - 8) && soundfont_read_sdta(&sdta, bench->file);
+    soundfont_release_sdta(&sdta);
+    return ok;
+}
+
+static bool step_sdta_map(Bench *bench) {
+    SoundFontSdtaData sdta;
+    bool ok = soundfont_map_sdta_at(&sdta, bench->file, &bench->sdta, SOUNDFONT_ADVICE_RANDOM);
+    soundfont_release_sdta(&sdta);
+    return ok;
+}
+
+static bool step_regions_build(Bench *bench) {
+    SoundFontRegionIndex regions;
+    soundfont_init_regions(&regions);
+    bool ok = soundfont_build_regions(&regions, &bench->pdta);
+    soundfont_release_regions(&regions);
+    return ok;
+}
+
+static bool step_zones_build(Bench *bench) {
+    SoundFontZoneTable zones;
+    soundfont_init_zones(&zones);
+    bool ok = soundfont_build_zones(&zones, &bench->pdta);
+    soundfont_release_zones(&zones);
+    return ok;
+}
+
+// every bank and program of the font, plus as many that miss
+static bool step_preset_lookup(Bench *bench) {
+    uint32_t found = 0;
+    for (uint32_t i = 0; i + 1 < bench->pdta.presetHeaderSize; i++) {
+        const SoundFontPresetHeader *header = bench->pdta.presetHeader + i;
+        found += NULL != soundfont_find_preset(&bench->pdta, header->bank, (uint8_t)header->preset);
+        found += NULL != soundfont_find_preset(&bench->pdta, header->bank + 1000, (uint8_t)header->preset);
+    }
+    return found + 1 >= bench->pdta.presetHeaderSize;
+}
+
+// the regions of every key of every preset
+static bool step_region_lookup(Bench *bench) {
+    const SoundFontRegion *regions[16];
+    uint32_t found = 0;
+    for (uint16_t p = 0; p < bench->regions.presetCount; p++) {
+        for (uint32_t key = 0; key < 128; key++) {
+            found += soundfont_find_regions(&bench->regions, p, (uint8_t)key, 100, regions, 16);
+        }
+    }
+    return found > 0 || 0 == bench->regions.presetCount;
+}
+
+static bool step_zone_resolve(Bench *bench) {
+    SoundFontZone zone;
+    int32_t check = 0;
+    for (uint32_t r = 0; r < bench->regions.regionCount; r++) {
+        soundfont_resolve_zone(&bench->zones, bench->regions.regions + r, &zone);
+        check += zone.gen[SOUNDFONT_GEN_SAMPLE_ID].value;
+    }
+    return check >= 0;
+}
+
+static bool step_font_load(Bench *bench) {
+    SoundFontFont font;
+    bool ok = soundfont_load_font(&font, bench->path);
+    if (ok) {
+        soundfont_release_font(&font);
+    }
+    return ok;
+}
+
+// one second of audio with every voice sounding
+static bool step_render(Bench *bench) {
+    float left[BENCH_BLOCK];
+    float right[BENCH_BLOCK];
+    for (uint32_t frame = 0; frame < BENCH_RATE; frame += BENCH_BLOCK) {
+        soundfont_synth_render(&bench->synth, left, right, BENCH_RATE - frame < BENCH_BLOCK ? BENCH_RATE - frame : BENCH_BLOCK);
+    }
+    return soundfont_synth_active(&bench->synth) > 0;
+}
+
+static int compare_times(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/*
+    Runs step once to warm up and then iterations times, and prints the median and the fastest
+    iteration. items and bytes are the work of one iteration.
+*/
+static bool measure(Bench *bench, const char *name, BenchStep step, uint64_t items, uint64_t bytes) {
+    if (!step(bench)) {
+        printf("%s failed.\n", name);
+        return false;
+    }
+    for (int i = 0; i < bench->iterations; i++) {
+        double start = soundfont_os_now();
+        step(bench);
+        bench->times[i] = soundfont_os_now() - start;
+    }
+    qsort(bench->times, bench->iterations, sizeof(double), compare_times);
+    double median = bench->iterations % 2 == 1 ? bench->times[bench->iterations / 2] : (bench->times[bench->iterations / 2 - 1] + bench->times[bench->iterations / 2]) / 2.0;
+    median = median > 1e-9 ? median : 1e-9;
+    printf("%s,%d,%llu,%llu,%.6f,%.6f,%.0f,%.2f\n", name, bench->iterations, (unsigned long long)items, (unsigned long long)bytes, median, bench->times[0],
+           items / median, bytes / median / (1024.0 * 1024.0));
+    fflush(stdout);
+
+    return true;
+}
+
+// a synth holding up to bench->voices looped voices, spread over the melodic channels
+static bool start_voices(Bench *bench, SoundFontInterp interp) {
+    if (!soundfont_create_synth(&bench->synth, &bench->font, BENCH_RATE, bench->voices)) {
+        return false;
+    }
+    if (interp != SOUNDFONT_INTERP_CUBIC && !soundfont_mixer_set_interp(&bench->synth.mixer, interp, SOUNDFONT_SINC_TAPS, SOUNDFONT_SINC_PHASES)) {
+        soundfont_release_synth(&bench->synth);
+        return false;
+    }
+    for (uint8_t channel = 0; channel < SOUNDFONT_SYNTH_CHANNELS; channel++) {
+        soundfont_synth_program_change(&bench->synth, channel, (uint8_t)(channel * 7 % 128));
+    }
+    for (uint32_t n = 0; n < 4 * bench->voices && soundfont_synth_active(&bench->synth) < bench->voices; n++) {
+        uint8_t channel = (uint8_t)(n % (SOUNDFONT_SYNTH_CHANNELS - 1));
+        channel = channel >= SOUNDFONT_SYNTH_PERCUSSION ? channel + 1 : channel;
+        soundfont_synth_note_on(&bench->synth, channel, (uint8_t)(36 + (n / (SOUNDFONT_SYNTH_CHANNELS - 1) * 7) % 60), 100);
+    }
+
+    return true;
+}
+
+static void usage(void) {
+    printf("Usage : sf2Bench [-s scale 1-%d] [-i iterations] [-m sample-MB] [-v voices] [-o out.sf2 | -f font.sf2]\n", BENCH_MAX_SCALE);
+}
+
+/*
+    Benchmarks the load, lookup and render paths on a generated font, or on font.sf2 with -f, and
+    prints one CSV row per benchmark. items_per_second is records, lookups or regions per second;
+    for the render rows items are the voices sounding and items_per_second the voices one core
+    renders in real time.
+*/
+int main(int argc, char **argv) {
+    uint32_t scale = 1;
+    uint32_t megabytes = 64;
+    const char *out = NULL;
+    const char *input = NULL;
+    Bench bench;
+    memset(&bench, 0, sizeof(Bench));
+    bench.iterations = 10;
+    bench.voices = 256;
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] != '-' || i + 1 >= argc) {
+            usage();
+            return EXIT_FAILURE;
+        }
+        switch (argv[i][1]) {
+            case 's':
+                scale = (uint32_t)atoi(argv[++i]);
+                break;
+            case 'i':
+                bench.iterations = atoi(argv[++i]);
+                break;
+            case 'm':
+                megabytes = (uint32_t)atoi(argv[++i]);
+                break;
+            case 'v':
+                bench.voices = (uint32_t)atoi(argv[++i]);
+                break;
+            case 'o':
+                out = argv[++i];
+                break;
+            case 'f':
+                input = argv[++i];
+                break;
+            default:
+                usage();
+                return EXIT_FAILURE;
+        }
+    }
+    if (scale == 0 || scale > BENCH_MAX_SCALE || bench.iterations < 1 || megabytes == 0 || megabytes > 2000 || bench.voices == 0) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    bench.path = NULL != input ? input : (NULL != out ? out : BENCH_PATH);
+    if (NULL == input) {
+        double start = soundfont_os_now();
+        if (!generate_font(bench.path, scale, megabytes)) {
+            return EXIT_FAILURE;
+        }
+        fprintf(stderr, "Generated %s in %.3f s\n", bench.path, soundfont_os_now() - start);
+    }
+
+    bench.file = fopen(bench.path, "rb");
+    bench.times = (double *)malloc(sizeof(double) * bench.iterations);
+    soundfont_init_chunks(&bench.directory);
+    soundfont_init_pdta(&bench.pdta);
+    soundfont_init_regions(&bench.regions);
+    soundfont_init_zones(&bench.zones);
+    bool ok = NULL != bench.file && NULL != bench.times && soundfont_scan_chunks(&bench.directory, bench.file);
+    bench.pdtaChunk = ok ? soundfont_find_chunk(&bench.directory, "", "pdta") : NULL;
+    ok = ok && NULL != bench.pdtaChunk && soundfont_find_sdta(&bench.directory, &bench.sdta);
+    bench.pdtaBuffer = ok ? soundfont_read_chunk(bench.file, bench.pdtaChunk) : NULL;
+    ok = ok && NULL != bench.pdtaBuffer && soundfont_decode_pdta(&bench.pdta, bench.pdtaBuffer, bench.pdtaChunk->size);
+    ok = ok && soundfont_build_regions(&bench.regions, &bench.pdta) && soundfont_build_zones(&bench.zones, &bench.pdta);
+    ok = ok && soundfont_load_font(&bench.font, bench.path);
+    ok = ok && soundfont_os_map(&bench.whole, bench.file, 0, (size_t)soundfont_os_file_size(bench.file));
+    if (!ok) {
+        printf("Can't benchmark %s.\n", bench.path);
+        return EXIT_FAILURE;
+    }
+
+    uint64_t records = 0;
+    records += bench.pdta.presetHeaderSize + bench.pdta.presetIndexSize + bench.pdta.presetModSize + bench.pdta.presetGenSize;
+    records += bench.pdta.presetInstSize + bench.pdta.presetIbagSize + bench.pdta.iModSize + bench.pdta.iGenSize + bench.pdta.shdrSize;
+    uint32_t pdtaSize = bench.pdtaChunk->size;
+    bench.records = records;
+    uint32_t presets = bench.pdta.presetHeaderSize > 0 ? bench.pdta.presetHeaderSize - 1 : 0;
+
+    printf("benchmark,iterations,items,bytes,median_seconds,min_seconds,items_per_second,mib_per_second\n");
+    ok = measure(&bench, "pdta_per_field_fread", step_pdta_per_field, records, pdtaSize);
+    ok = measure(&bench, "pdta_read_bulk", step_pdta_read, records, pdtaSize) && ok;
+    ok = measure(&bench, "pdta_decode_memory", step_pdta_decode, records, pdtaSize) && ok;
+    ok = measure(&bench, "pdta_read_parallel", step_pdta_parallel, records, pdtaSize) && ok;
+    ok = measure(&bench, "pdta_parse_file", step_pdta_parse_file, records, pdtaSize) && ok;
+    ok = measure(&bench, "pdta_parse_memory", step_pdta_parse_memory, records, pdtaSize) && ok;
+    ok = measure(&bench, "sdta_read", step_sdta_read, bench.sdta.smplSize / 2, bench.sdta.smplSize) && ok;
+    ok = measure(&bench, "sdta_map", step_sdta_map, bench.sdta.smplSize / 2, bench.sdta.smplSize) && ok;
+    ok = measure(&bench, "regions_build", step_regions_build, bench.regions.regionCount, 0) && ok;
+    ok = measure(&bench, "zones_build", step_zones_build, bench.regions.regionCount, 0) && ok;
+    ok = measure(&bench, "preset_lookup", step_preset_lookup, 2 * (uint64_t)presets, 0) && ok;
+    ok = measure(&bench, "region_lookup", step_region_lookup, 128 * (uint64_t)bench.regions.presetCount, 0) && ok;
+    ok = measure(&bench, "zone_resolve", step_zone_resolve, bench.regions.regionCount, 0) && ok;
+    ok = measure(&bench, "font_load", step_font_load, records, (uint64_t)pdtaSize + bench.sdta.smplSize) && ok;
+
+    SoundFontInterp interps[3] = {SOUNDFONT_INTERP_LINEAR, SOUNDFONT_INTERP_CUBIC, SOUNDFONT_INTERP_SINC};
+    const char *names[3] = {"render_linear", "render_cubic", "render_sinc"};
+    for (int i = 0; i < 3; i++) {
+        if (!start_voices(&bench, interps[i])) {
+            ok = false;
+            continue;
+        }
+        ok = measure(&bench, names[i], step_render, soundfont_synth_active(&bench.synth), 0) && ok;
+        soundfont_release_synth(&bench.synth);
+    }
+
+    soundfont_release_font(&bench.font);
+    soundfont_release_zones(&bench.zones);
+    soundfont_release_regions(&bench.regions);
+    soundfont_release_pdta(&bench.pdta);
+    free(bench.pdtaBuffer);
+    soundfont_os_unmap(&bench.whole);
+    soundfont_release_chunks(&bench.directory);
+    fclose(bench.file);
+    free(bench.times);
+    if (NULL == input && NULL == out) {
+        remove(bench.path);
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
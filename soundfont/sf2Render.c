@@ -0,0 +1,221 @@
+/*
+    RIFF file process library
+
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "soundfont_cache.h"
+#include "soundfont_render.h"
+#include "soundfont_stats.h"
+
+#define RENDER_PATH_MAX 1024
+
+static void usage(void) {
+    printf("Usage : sf2Render <font.sf2> <out-dir> <file.mid>... [-j threads] [-r rate] [-p polyphony] [-g gain] [-f] [-c] [-l] [-d] [-t] [-m budget-MB] [-s sinc-taps]\n");
+    printf("        -l and -d prepare the 16-bit samples in memory, so neither goes with -f or -m\n");
+}
+
+static void print_stats(void) {
+    SoundFontStatsSnapshot stats;
+    soundfont_stats_snapshot(&stats);
+    if (!stats.enabled) {
+        printf("Built without SOUNDFONT_STATS, no timers to print\n");
+        return;
+    }
+    printf("Stats over %u threads\n", stats.threads);
+    for (int i = 0; i < SOUNDFONT_PHASES; i++) {
+        if (stats.calls[i] > 0) {
+            printf("  %-14s %10llu calls %10.4f s\n", soundfont_stats_phase_name(i), (unsigned long long)stats.calls[i], stats.seconds[i]);
+        }
+    }
+    for (int i = 0; i < SOUNDFONT_COUNTERS; i++) {
+        printf("  %-16s %llu\n", soundfont_stats_counter_name(i), (unsigned long long)stats.counters[i]);
+    }
+}
+
+// out-dir/name.wav for in-dir/name.mid
+static void wav_path(char *out, const char *dir, const char *midiPath) {
+    const char *name = midiPath;
+    for (const char *p = midiPath; *p != '\0'; p++) {
+        if (*p == '/' || *p == '\\') {
+            name = p + 1;
+        }
+    }
+    size_t length = strlen(name);
+    const char *dot = strrchr(name, '.');
+    if (NULL != dot) {
+        length = dot - name;
+    }
+    snprintf(out, RENDER_PATH_MAX, "%s/%.*s.wav", dir, (int)length, name);
+}
+
+// parses the options into jobs and paths, room for argc of each, then loads the font and renders
+static int run(int argc, char **argv, SoundFontRenderJob *jobs, char *paths) {
+    SoundFontRenderOptions options;
+    soundfont_render_defaults(&options);
+    uint32_t threads = 0;
+    bool floats = false;  // -f converts the samples to float32 after loading
+    bool cached = false;  // -c loads the tables from font.sf2.cache, writing it first if needed
+    bool padded = false;  // -l moves the samples into buffers with loop-wrapped guard points
+    uint32_t levels = 1;  // -d adds half and quarter rate copies to them
+    bool timed = false;   // -t prints the phase timers and counters, needs a build with -DSOUNDFONT_STATS
+    bool paged = false;   // -m streams the samples in, keeping at most budget-MB of them resident
+    SoundFontStoreOptions paging;
+    soundfont_store_defaults(&paging);
+    paging.wait = true;  // rendering runs ahead of the loader, it never may play a head alone
+
+    uint32_t jobCount = 0;
+    for (int i = 3; i < argc; i++) {
+        if (0 == strcmp(argv[i], "-f")) {
+            floats = true;
+            continue;
+        }
+        if (0 == strcmp(argv[i], "-c")) {
+            cached = true;
+            continue;
+        }
+        if (0 == strcmp(argv[i], "-l")) {
+            padded = true;
+            continue;
+        }
+        if (0 == strcmp(argv[i], "-d")) {
+            padded = true;
+            levels = SOUNDFONT_PREPARE_LEVELS;
+            continue;
+        }
+        if (0 == strcmp(argv[i], "-t")) {
+            timed = true;
+            continue;
+        }
+        if (argv[i][0] == '-' && i + 1 < argc) {
+            switch (argv[i][1]) {
+                case 'j':
+                    threads = (uint32_t)atoi(argv[++i]);
+                    break;
+                case 'r':
+                    options.sampleRate = (uint32_t)atoi(argv[++i]);
+                    break;
+                case 'p':
+                    options.polyphony = (uint32_t)atoi(argv[++i]);
+                    break;
+                case 'g':
+                    options.gain = (float)atof(argv[++i]);
+                    break;
+                case 'm':
+                    paged = true;
+                    paging.budget = (size_t)atoi(argv[++i]) << 20;
+                    break;
+                case 's':
+                    options.interp = SOUNDFONT_INTERP_SINC;
+                    options.sincTaps = (uint32_t)atoi(argv[++i]);
+                    break;
+                default:
+                    usage();
+                    return EXIT_FAILURE;
+            }
+            continue;
+        }
+        char *out = paths + (size_t)jobCount * RENDER_PATH_MAX;
+        wav_path(out, argv[2], argv[i]);
+        jobs[jobCount].midiPath = argv[i];
+        jobs[jobCount].wavPath = out;
+        jobCount++;
+    }
+
+    if (padded && (floats || paged)) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    double started = soundfont_os_now();
+    SoundFontFont font;
+    bool ok = false;
+    if (paged) {
+        ok = soundfont_load_font_paged(&font, argv[1], &paging);
+    } else {
+        ok = cached ? soundfont_load_font_cached(&font, argv[1]) : soundfont_load_font(&font, argv[1]);
+    }
+    if (!ok) {
+        return EXIT_FAILURE;
+    }
+    if (floats && !soundfont_convert_font(&font)) {
+        soundfont_release_font(&font);
+        return EXIT_FAILURE;
+    }
+    if (padded) {
+        if (!soundfont_prepare_font(&font, levels)) {
+            soundfont_release_font(&font);
+            return EXIT_FAILURE;
+        }
+        printf("Prepared %.1f MB of padded samples, %.1f MB of guards, loop copies and levels, %.1f MB of them levels\n", font.prepared.bytes / 1048576.0, font.prepared.extraBytes / 1048576.0,
+               font.prepared.levelBytes / 1048576.0);
+    }
+    double loaded = soundfont_os_now();
+    printf("Loaded %s in %.3f s\n", argv[1], loaded - started);
+
+    uint32_t succeeded = soundfont_render_batch(&font, jobs, jobCount, &options, threads);
+    double elapsed = soundfont_os_now() - loaded;
+
+    double audio = 0.0;
+    for (uint32_t i = 0; i < jobCount; i++) {
+        printf("%s %s -> %s : %.2f s of audio in %.3f s\n", jobs[i].ok ? "ok  " : "FAIL", jobs[i].midiPath, jobs[i].wavPath, jobs[i].duration, jobs[i].seconds);
+        audio += jobs[i].duration;
+    }
+    printf("%u of %u files, %.2f s of audio in %.3f s, %.1fx real time\n", succeeded, jobCount, audio, elapsed, elapsed > 0.0 ? audio / elapsed : 0.0);
+
+    if (paged) {
+        printf("%llu samples streamed in, %llu evicted, %.1f MB resident\n", (unsigned long long)font.store->loads, (unsigned long long)font.store->evictions,
+               (font.store->pinned + font.store->resident) / 1048576.0);
+    }
+    if (timed) {
+        print_stats();
+    }
+    soundfont_release_font(&font);
+
+    return succeeded == jobCount ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    // every exit of run leaves these two here to be freed
+    SoundFontRenderJob *jobs = (SoundFontRenderJob *)calloc(argc, sizeof(SoundFontRenderJob));
+    char *paths = (char *)malloc((size_t)argc * RENDER_PATH_MAX);
+    int status = EXIT_FAILURE;
+    if (NULL == jobs || NULL == paths) {
+        printf("Not enough memory.\n");
+    } else {
+        status = run(argc, argv, jobs, paths);
+    }
+    free(paths);
+    free(jobs);
+
+    return status;
+}
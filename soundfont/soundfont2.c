@@ -26,6 +26,9 @@
 */
 #include "soundfont2.h"
 
+#include "soundfont_simd.h"
+#include "soundfont_stats.h"
+
 static char *STR_FORMAT_LIST = "LIST";
 static char *STR_TYPE_INFO = "INFO";
 static char *STR_TYPE_SDTA = "sdta";
@@ -40,15 +43,96 @@ static char *STR_PDTA_TYPE_IMOD = "imod";
 static char *STR_PDTA_TYPE_IGEN = "igen";
 static char *STR_PDTA_TYPE_SHDR = "shdr";
 
-static bool read_pdta_preset_header(SoundFontPdtaData *pdta, uint32_t *pdtaSize, FILE *file);
-static bool read_pdta_preset_index(SoundFontPdtaData *pdta, uint32_t *pdtaSize, FILE *file);
-static bool read_pdta_preset_mod(SoundFontPdtaData *pdta, uint32_t *pdtaSize, FILE *file);
-static bool read_pdta_preset_gen(SoundFontPdtaData *pdta, uint32_t *pdtaSize, FILE *file);
-static bool read_pdta_preset_inst(SoundFontPdtaData *pdta, uint32_t *pdtaSize, FILE *file);
-static bool read_pdta_preset_ibag(SoundFontPdtaData *pdta, uint32_t *pdtaSize, FILE *file);
-static bool read_pdta_inst_mod(SoundFontPdtaData *pdta, uint32_t *pdtaSize, FILE *file);
-static bool read_pdta_inst_gen(SoundFontPdtaData *pdta, uint32_t *pdtaSize, FILE *file);
-static bool read_pdta_shdr(SoundFontPdtaData *pdta, uint32_t *pdtaSize, FILE *file);
+typedef enum PdtaTableId {
+    PDTA_PHDR,
+    PDTA_PBAG,
+    PDTA_PMOD,
+    PDTA_PGEN,
+    PDTA_INST,
+    PDTA_IBAG,
+    PDTA_IMOD,
+    PDTA_IGEN,
+    PDTA_SHDR,
+    PDTA_TABLE_COUNT
+} PdtaTableId;
+
+typedef struct PdtaTable {
+    char **fourcc;
+    uint32_t recordSize;  // size of one record in the file
+    uint32_t structSize;  // size of one decoded record
+    const char *name;
+} PdtaTable;
+
+static const PdtaTable PDTA_TABLES[PDTA_TABLE_COUNT] = {
+    {&STR_PDTA_TYPE_PHDR, 38, sizeof(SoundFontPresetHeader), "preset header"},
+    {&STR_PDTA_TYPE_PBAG, 4, sizeof(SoundFontPresetIndex), "preset index"},
+    {&STR_PDTA_TYPE_PMOD, 10, sizeof(SoundFontMod), "preset mod"},
+    {&STR_PDTA_TYPE_PGEN, 4, sizeof(SoundFontGen), "preset generator"},
+    {&STR_PDTA_TYPE_INST, 22, sizeof(SoundFontPresetInst), "preset instructment names and indices"},
+    {&STR_PDTA_TYPE_IBAG, 4, sizeof(SoundFontPresetIbag), "preset instrument index list"},
+    {&STR_PDTA_TYPE_IMOD, 10, sizeof(SoundFontMod), "instrument mod"},
+    {&STR_PDTA_TYPE_IGEN, 4, sizeof(SoundFontGen), "instrument generator"},
+    {&STR_PDTA_TYPE_SHDR, 46, sizeof(SoundFontSample), "the sample header"}};
+
+// PdtaTableId follows SoundFontRecordType, so the public record type indexes PDTA_TABLES
+typedef char soundfont_check_record_types[(int)PDTA_SHDR == (int)SOUNDFONT_RECORD_SHDR && (int)PDTA_TABLE_COUNT == (int)SOUNDFONT_RECORD_TYPES ? 1 : -1];
+
+// arena placement follows the phdr -> pbag -> pgen -> inst -> ibag -> igen -> shdr walk of a note-on,
+// the modulator lists are rarely touched and go last
+static const PdtaTableId PDTA_ARENA_ORDER[PDTA_TABLE_COUNT] = {
+    PDTA_PHDR, PDTA_PBAG, PDTA_PGEN, PDTA_INST, PDTA_IBAG, PDTA_IGEN, PDTA_SHDR, PDTA_PMOD, PDTA_IMOD};
+
+// the bag, modulator, generator and instrument records are copied straight into these structs
+typedef char soundfont_check_record_layout[(sizeof(SoundFontPresetIndex) == 4 && sizeof(SoundFontMod) == 10 &&
+                                            sizeof(SoundFontGen) == 4 && sizeof(SoundFontPresetInst) == 22 &&
+                                            sizeof(SoundFontPresetIbag) == 4)
+                                               ? 1
+                                               : -1];
+
+// one range of records of a pdta table, decoded by whichever worker takes it
+typedef struct PdtaTask {
+    PdtaTableId id;
+    uint32_t first;  // index of the first record
+    uint32_t count;
+    int64_t offset;  // file offset of the first record
+} PdtaTask;
+
+typedef struct PdtaJob {
+    SoundFontPdtaData *pdta;
+    FILE *file;
+    PdtaTask *tasks;
+    uint32_t taskCount;
+    uint32_t next;      // the next task to take, atomic
+    uint32_t phdrLeft;  // phdr tasks not decoded yet, atomic, the worker finishing the last builds the preset map
+    uint32_t failed;    // atomic
+} PdtaJob;
+
+static void read_pdta_preset_header(SoundFontPdtaData *pdta, const uint8_t *data);
+static void read_pdta_preset_index(SoundFontPdtaData *pdta, const uint8_t *data);
+static void read_pdta_preset_mod(SoundFontPdtaData *pdta, const uint8_t *data);
+static void read_pdta_preset_gen(SoundFontPdtaData *pdta, const uint8_t *data);
+static void read_pdta_preset_inst(SoundFontPdtaData *pdta, const uint8_t *data);
+static void read_pdta_preset_ibag(SoundFontPdtaData *pdta, const uint8_t *data);
+static void read_pdta_inst_mod(SoundFontPdtaData *pdta, const uint8_t *data);
+static void read_pdta_inst_gen(SoundFontPdtaData *pdta, const uint8_t *data);
+static void read_pdta_shdr(SoundFontPdtaData *pdta, const uint8_t *data);
+static void decode_preset_header(SoundFontPresetHeader *header, const uint8_t *data);
+static void decode_sample(SoundFontSample *header, const uint8_t *data);
+static void decode_pdta_range(SoundFontPdtaData *pdta, PdtaTableId id, uint32_t first, uint32_t count, const uint8_t *data);
+static void pdta_worker(void *arg);
+
+static int32_t count_pdta_records(uint32_t chunkSize, uint32_t recordSize, const char *name);
+static bool alloc_pdta_arena(SoundFontPdtaData *pdta, const int32_t *counts);
+static void build_preset_map(SoundFontPdtaData *pdta);
+static bool verify_links(const uint16_t *links, size_t stride, uint32_t count, uint32_t targetSize, const char *name);
+static bool verify_gens(const SoundFontGen *gens, uint16_t genCount, uint16_t operator, uint32_t targetSize, const char *name);
+static bool verify_terminal(const char *recordName, const char *expected, const char *name);
+static const SoundFontPresetSlot *probe_preset_map(const SoundFontPresetMap *map, uint32_t key);
+static void decode_u16_records(uint16_t *dest, const uint8_t *data, uint32_t count);
+static uint32_t find_sm24(FILE *file, uint32_t smplSize);
+static bool scan_chunks(SoundFontChunkDirectory *directory, FILE *file, const char *list, int64_t position, int64_t end);
+static bool add_chunk(SoundFontChunkDirectory *directory, const SoundFontChunk *chunk);
+static void convert_points(float *out, const uint8_t *data, const uint8_t *low, uint32_t count);
 
 static void print_pdta_preset_header(SoundFontPdtaData *pdta);
 static void print_pdta_preset_index(SoundFontPdtaData *pdta);
@@ -116,6 +200,8 @@ SoundFontListType soundfont_fetch_list_type(FILE *file, uint32_t *size) {
 
 SoundFontChunk soundfont_read_chunk_info(FILE *file) {
     SoundFontChunk chunk;
+    chunk.list[0] = '\0';
+    chunk.offset = -1;
 
     if (soundfont_read_fourcc(chunk.fourcc, file)) {
         chunk.fourcc[4] = '\0';
@@ -137,9 +223,77 @@ SoundFontChunk soundfont_read_chunk_info(FILE *file) {
     return chunk;
 }
 
-SoundFontChunk soundfont_read_chunk(FILE *file);
+void soundfont_init_chunks(SoundFontChunkDirectory *directory) {
+    directory->chunks = NULL;
+    directory->count = 0;
+    directory->capacity = 0;
+}
+
+/*
+    Lists every chunk of the file and the sub-chunks of every LIST in one pass over the headers,
+    seeking over the payloads, so its cost depends on the number of chunks and not on the file
+    size. Any chunk can then be read on its own, in any order. The stream position is left
+    undefined.
+*/
+bool soundfont_scan_chunks(SoundFontChunkDirectory *directory, FILE *file) {
+    directory->count = 0;
+
+    uint8_t header[12];
+    if (!soundfont_os_seek(file, 0) || 12 != fread(header, 1, 12, file) || 0 != memcmp(header, "RIFF", 4) || 0 != memcmp(header + 8, "sfbk", 4)) {
+        printf("Not a sound font 2 file.\n");
+        return false;
+    }
+    int64_t end = 8 + (int64_t)soundfont_read_u32(header + 4);
+    int64_t fileSize = soundfont_os_file_size(file);
+    if (end > fileSize) {
+        end = fileSize;
+    }
+
+    return scan_chunks(directory, file, "", 12, end);
+}
+
+// the first chunk with the fourcc inside the list, pass an empty list for a top level chunk or LIST
+const SoundFontChunk *soundfont_find_chunk(const SoundFontChunkDirectory *directory, const char *list, const char *fourcc) {
+    for (uint32_t i = 0; i < directory->count; i++) {
+        const SoundFontChunk *chunk = directory->chunks + i;
+        if (0 == strcmp(chunk->fourcc, fourcc) && 0 == strcmp(chunk->list, list)) {
+            return chunk;
+        }
+    }
+
+    return NULL;
+}
+
+// the payload of one chunk in a new allocation the caller frees
+uint8_t *soundfont_read_chunk(FILE *file, const SoundFontChunk *chunk) {
+    uint8_t *data = (uint8_t *)malloc(chunk->size > 0 ? chunk->size : 1);
+    if (NULL == data) {
+        printf("Not enough memory for reading %s.\n", chunk->fourcc);
+        return NULL;
+    }
+    if (!soundfont_os_read_at(file, data, chunk->size, chunk->offset)) {
+        printf("Failed to read %s.\n", chunk->fourcc);
+        free(data);
+        return NULL;
+    }
+
+    return data;
+}
+
+void soundfont_release_chunks(SoundFontChunkDirectory *directory) {
+    if (NULL != directory->chunks) {
+        free(directory->chunks);
+    }
+    soundfont_init_chunks(directory);
+}
 
 void soundfont_init_pdta(SoundFontPdtaData *pdta) {
+    pdta->arena = NULL;
+    pdta->arenaSize = 0;
+
+    pdta->presetMap.slots = NULL;
+    pdta->presetMap.mask = 0;
+
     pdta->presetHeader = NULL;
     pdta->presetHeaderSize = 0;
 
@@ -163,116 +317,281 @@ void soundfont_init_pdta(SoundFontPdtaData *pdta) {
 
     pdta->iGen = NULL;
     pdta->iGenSize = 0;
+
+    pdta->shdr = NULL;
+    pdta->shdrSize = 0;
+
+    pdta->verified = false;
 }
 
 bool soundfont_read_pdta(SoundFontPdtaData *pdta, uint32_t size, FILE *file) {
-    uint32_t pdtaSize = size;
+    SOUNDFONT_STATS_BEGIN(timer);
+    // one read for the whole list, the records are decoded from memory afterwards
+    uint8_t *buffer = (uint8_t *)malloc(size);
+    if (NULL == buffer) {
+        printf("Not enough memory for reading pdta.\n");
 
-    char fourcc[5];
-    fourcc[4] = '\0';
-    if (soundfont_read_fourcc(fourcc, file)) {
-        pdtaSize -= 4;
+        return false;
+    }
+    if (size != fread(buffer, 1, size, file)) {
+        printf("Failed to read pdta chunk.\n");
+        free(buffer);
 
-        if (0 == strcmp(STR_PDTA_TYPE_PHDR, fourcc)) {
-            read_pdta_preset_header(pdta, &pdtaSize, file);
-        }
+        return false;
     }
 
-    if (soundfont_read_fourcc(fourcc, file)) {
-        pdtaSize -= 4;
+    SOUNDFONT_STATS_ADD(SOUNDFONT_COUNT_BYTES_READ, size);
 
-        if (0 == strcmp(STR_PDTA_TYPE_PBAG, fourcc)) {
-            read_pdta_preset_index(pdta, &pdtaSize, file);
-        }
-    }
+    bool result = soundfont_decode_pdta(pdta, buffer, size);
+    free(buffer);
+    SOUNDFONT_STATS_END(SOUNDFONT_PHASE_PDTA_READ, timer);
 
-    if (soundfont_read_fourcc(fourcc, file)) {
-        pdtaSize -= 4;
+    return result;
+}
 
-        if (0 == strcmp(STR_PDTA_TYPE_PMOD, fourcc)) {
-            read_pdta_preset_mod(pdta, &pdtaSize, file);
+bool soundfont_decode_pdta(SoundFontPdtaData *pdta, const uint8_t *data, uint32_t size) {
+    SOUNDFONT_STATS_BEGIN(timer);
+    // size every table from the sub-chunk headers first, so they can share one allocation
+    const uint8_t *payloads[PDTA_TABLE_COUNT] = {NULL};
+    int32_t counts[PDTA_TABLE_COUNT] = {0};
+
+    uint32_t offset = 0;
+    while (size - offset >= 8) {
+        const uint8_t *chunk = data + offset;
+        uint32_t chunkSize = soundfont_read_u32(chunk + 4);
+        if (chunkSize > size - offset - 8) {
+            printf("Broken data for pdta.\n");
+            return false;
         }
-    }
 
-    if (soundfont_read_fourcc(fourcc, file)) {
-        pdtaSize -= 4;
+        for (int i = 0; i < PDTA_TABLE_COUNT; i++) {
+            if (0 == memcmp(chunk, *PDTA_TABLES[i].fourcc, 4)) {
+                counts[i] = count_pdta_records(chunkSize, PDTA_TABLES[i].recordSize, PDTA_TABLES[i].name);
+                if (counts[i] < 0) {
+                    return false;
+                }
+                payloads[i] = chunk + 8;
+                break;
+            }
+        }
 
-        if (0 == strcmp(STR_PDTA_TYPE_PGEN, fourcc)) {
-            read_pdta_preset_gen(pdta, &pdtaSize, file);
+        // RIFF pads odd sized chunks to a word boundary
+        offset += 8 + chunkSize + (chunkSize & 1);
+        if (offset > size) {
+            break;
         }
     }
 
-    if (soundfont_read_fourcc(fourcc, file)) {
-        pdtaSize -= 4;
+    if (!alloc_pdta_arena(pdta, counts)) {
+        return false;
+    }
 
-        if (0 == strcmp(STR_PDTA_TYPE_INST, fourcc)) {
-            read_pdta_preset_inst(pdta, &pdtaSize, file);
-        }
+    if (NULL != payloads[PDTA_PHDR]) {
+        read_pdta_preset_header(pdta, payloads[PDTA_PHDR]);
+    }
+    if (NULL != payloads[PDTA_PBAG]) {
+        read_pdta_preset_index(pdta, payloads[PDTA_PBAG]);
+    }
+    if (NULL != payloads[PDTA_PMOD]) {
+        read_pdta_preset_mod(pdta, payloads[PDTA_PMOD]);
+    }
+    if (NULL != payloads[PDTA_PGEN]) {
+        read_pdta_preset_gen(pdta, payloads[PDTA_PGEN]);
+    }
+    if (NULL != payloads[PDTA_INST]) {
+        read_pdta_preset_inst(pdta, payloads[PDTA_INST]);
+    }
+    if (NULL != payloads[PDTA_IBAG]) {
+        read_pdta_preset_ibag(pdta, payloads[PDTA_IBAG]);
+    }
+    if (NULL != payloads[PDTA_IMOD]) {
+        read_pdta_inst_mod(pdta, payloads[PDTA_IMOD]);
+    }
+    if (NULL != payloads[PDTA_IGEN]) {
+        read_pdta_inst_gen(pdta, payloads[PDTA_IGEN]);
+    }
+    if (NULL != payloads[PDTA_SHDR]) {
+        read_pdta_shdr(pdta, payloads[PDTA_SHDR]);
     }
 
-    if (soundfont_read_fourcc(fourcc, file)) {
-        pdtaSize -= 4;
+    if (!soundfont_verify_pdta(pdta)) {
+        soundfont_release_pdta(pdta);
+        return false;
+    }
+    build_preset_map(pdta);
+    for (int i = 0; i < PDTA_TABLE_COUNT; i++) {
+        SOUNDFONT_STATS_ADD(SOUNDFONT_COUNT_RECORDS_DECODED, counts[i]);
+    }
+    SOUNDFONT_STATS_END(SOUNDFONT_PHASE_PDTA_DECODE, timer);
+
+    return true;
+}
 
-        if (0 == strcmp(STR_PDTA_TYPE_IBAG, fourcc)) {
-            read_pdta_preset_ibag(pdta, &pdtaSize, file);
+/*
+    soundfont_read_pdta for large fonts. The sub-chunks are found in the chunk directory, every
+    table is cut into ranges of SOUNDFONT_PDTA_TASK_BYTES, and a pool of threads reads the ranges
+    with positional reads and decodes them straight into the arena, in any order. The preset map
+    is built by the worker that completes the preset headers while the others are still on the
+    remaining tables. threads 0 means one per core; a font small enough for a single range is
+    decoded on the calling thread alone.
+*/
+bool soundfont_read_pdta_parallel(SoundFontPdtaData *pdta, const SoundFontChunkDirectory *directory, FILE *file, uint32_t threads) {
+    SOUNDFONT_STATS_BEGIN(timer);
+    const SoundFontChunk *chunks[PDTA_TABLE_COUNT] = {NULL};
+    int32_t counts[PDTA_TABLE_COUNT] = {0};
+    uint32_t taskCount = 0;
+    for (int i = 0; i < PDTA_TABLE_COUNT; i++) {
+        chunks[i] = soundfont_find_chunk(directory, STR_TYPE_PDTA, *PDTA_TABLES[i].fourcc);
+        if (NULL != chunks[i]) {
+            counts[i] = count_pdta_records(chunks[i]->size, PDTA_TABLES[i].recordSize, PDTA_TABLES[i].name);
+            if (counts[i] < 0) {
+                return false;
+            }
+            uint32_t perTask = SOUNDFONT_PDTA_TASK_BYTES / PDTA_TABLES[i].recordSize;
+            taskCount += (counts[i] + perTask - 1) / perTask;
         }
     }
 
-    if (soundfont_read_fourcc(fourcc, file)) {
-        pdtaSize -= 4;
+    PdtaTask *tasks = (PdtaTask *)malloc(sizeof(PdtaTask) * (taskCount > 0 ? taskCount : 1));
+    if (NULL == tasks) {
+        printf("Not enough memory for reading pdta.\n");
+        return false;
+    }
+    if (!alloc_pdta_arena(pdta, counts)) {
+        free(tasks);
+        return false;
+    }
 
-        if (0 == strcmp(STR_PDTA_TYPE_IMOD, fourcc)) {
-            read_pdta_inst_mod(pdta, &pdtaSize, file);
+    // the generator and sample header ranges dominate, they are queued first so no worker is left
+    // with a long one at the end
+    static const PdtaTableId TASK_ORDER[PDTA_TABLE_COUNT] = {PDTA_PHDR, PDTA_IGEN, PDTA_SHDR, PDTA_PGEN, PDTA_IBAG, PDTA_PBAG, PDTA_INST, PDTA_IMOD, PDTA_PMOD};
+    PdtaJob job = {pdta, file, tasks, 0, 0, 0, 0};
+    for (int i = 0; i < PDTA_TABLE_COUNT; i++) {
+        PdtaTableId id = TASK_ORDER[i];
+        uint32_t perTask = SOUNDFONT_PDTA_TASK_BYTES / PDTA_TABLES[id].recordSize;
+        for (uint32_t first = 0; first < (uint32_t)counts[id]; first += perTask) {
+            PdtaTask *task = tasks + job.taskCount++;
+            task->id = id;
+            task->first = first;
+            task->count = (uint32_t)counts[id] - first < perTask ? (uint32_t)counts[id] - first : perTask;
+            task->offset = chunks[id]->offset + (int64_t)first * PDTA_TABLES[id].recordSize;
+            job.phdrLeft += PDTA_PHDR == id;
         }
     }
+    if (0 == job.phdrLeft) {
+        build_preset_map(pdta);
+    }
 
-    if (soundfont_read_fourcc(fourcc, file)) {
-        pdtaSize -= 4;
+    if (0 == threads) {
+        threads = soundfont_os_cpu_count();
+    }
+    if (threads > job.taskCount) {
+        threads = job.taskCount;
+    }
+    if (threads > SOUNDFONT_PDTA_MAX_THREADS) {
+        threads = SOUNDFONT_PDTA_MAX_THREADS;
+    }
+    SoundFontThread pool[SOUNDFONT_PDTA_MAX_THREADS];
+    uint32_t started = 0;
+    while (started + 1 < threads && soundfont_os_thread_start(pool + started, pdta_worker, &job)) {
+        started++;
+    }
+    pdta_worker(&job);
+    for (uint32_t i = 0; i < started; i++) {
+        soundfont_os_thread_join(pool + i);
+    }
+    free(tasks);
 
-        if (0 == strcmp(STR_PDTA_TYPE_IGEN, fourcc)) {
-            read_pdta_inst_gen(pdta, &pdtaSize, file);
-        }
+    if (job.failed) {
+        printf("Failed to read pdta chunk.\n");
+        soundfont_release_pdta(pdta);
+        soundfont_init_pdta(pdta);
+        return false;
     }
+    if (!soundfont_verify_pdta(pdta)) {
+        soundfont_release_pdta(pdta);
+        return false;
+    }
+    SOUNDFONT_STATS_END(SOUNDFONT_PHASE_PDTA_PARALLEL, timer);
 
-    if (soundfont_read_fourcc(fourcc, file)) {
-        pdtaSize -= 4;
+    return true;
+}
 
-        if (0 == strcmp(STR_PDTA_TYPE_SHDR, fourcc)) {
-            read_pdta_shdr(pdta, &pdtaSize, file);
+/*
+    Resolves a MIDI bank/program pair through the preset map. When the exact pair is missing the
+    GM fallback applies: percussion banks fall back to the standard kit (128, 0), melodic banks to
+    the capital tone (0, program). Returns NULL when neither exists.
+*/
+const SoundFontPresetSlot *soundfont_find_preset(const SoundFontPdtaData *pdta, uint16_t bank, uint8_t program) {
+    if (NULL == pdta->presetMap.slots) {
+        return NULL;
+    }
+
+    program &= 0x7F;
+    const SoundFontPresetSlot *slot = probe_preset_map(&pdta->presetMap, (uint32_t)bank << 7 | program);
+    if (NULL == slot) {
+        if (SOUNDFONT_PERCUSSION_BANK == bank) {
+            slot = probe_preset_map(&pdta->presetMap, (uint32_t)SOUNDFONT_PERCUSSION_BANK << 7);
+        } else if (0 != bank) {
+            slot = probe_preset_map(&pdta->presetMap, program);
         }
     }
 
-    return true;
+    return slot;
 }
 
 void soundfont_release_pdta(SoundFontPdtaData *pdta) {
-    if (NULL != pdta->presetHeader) {
-        free(pdta->presetHeader);
-    }
-    if (NULL != pdta->presetIndex) {
-        free(pdta->presetIndex);
-    }
-    if (NULL != pdta->presetMod) {
-        free(pdta->presetMod);
-    }
-    if (NULL != pdta->presetGen) {
-        free(pdta->presetGen);
-    }
-    if (NULL != pdta->presetInst) {
-        free(pdta->presetInst);
+    // all nine tables live in the arena
+    if (NULL != pdta->arena) {
+        free(pdta->arena);
     }
-    if (NULL != pdta->presetIbag) {
-        free(pdta->presetIbag);
-    }
-    if (NULL != pdta->iMod) {
-        free(pdta->iMod);
+    soundfont_init_pdta(pdta);
+}
+
+/*
+    Proves once, in a single pass over the tables, what everything reading them would otherwise
+    check on every access: all nine tables end with their terminal record, named EOP, EOI and EOS
+    in phdr, inst and shdr; the bag, generator and modulator indices never decrease and reach at
+    most the terminal record of the table they index, which the terminal records index exactly,
+    so the last preset, instrument and zone end inside their tables as well; and the instrument
+    and sampleID generators and the links of stereo samples name a record before the terminal
+    one. Sets verified on success; a pdta failing any of it is malformed and must not be used.
+    Sample points are not covered, they are checked against the smpl chunk by whoever reads them.
+*/
+bool soundfont_verify_pdta(SoundFontPdtaData *pdta) {
+    pdta->verified = false;
+    if (0 == pdta->presetHeaderSize || 0 == pdta->presetIndexSize || 0 == pdta->presetModSize || 0 == pdta->presetGenSize || 0 == pdta->presetInstSize ||
+        0 == pdta->presetIbagSize || 0 == pdta->iModSize || 0 == pdta->iGenSize || 0 == pdta->shdrSize) {
+        printf("Missing terminal record in pdta.\n");
+        return false;
     }
-    if (NULL != pdta->iGen) {
-        free(pdta->iGen);
+
+    bool ok = verify_links(&pdta->presetHeader->presetBagNdx, sizeof(SoundFontPresetHeader), pdta->presetHeaderSize, pdta->presetIndexSize, "phdr");
+    ok = ok && verify_links(&pdta->presetIndex->genNdx, sizeof(SoundFontPresetIndex), pdta->presetIndexSize, pdta->presetGenSize, "pbag");
+    ok = ok && verify_links(&pdta->presetIndex->modNdx, sizeof(SoundFontPresetIndex), pdta->presetIndexSize, pdta->presetModSize, "pbag");
+    ok = ok && verify_links(&pdta->presetInst->index, sizeof(SoundFontPresetInst), pdta->presetInstSize, pdta->presetIbagSize, "inst");
+    ok = ok && verify_links(&pdta->presetIbag->genNdx, sizeof(SoundFontPresetIbag), pdta->presetIbagSize, pdta->iGenSize, "ibag");
+    ok = ok && verify_links(&pdta->presetIbag->modNdx, sizeof(SoundFontPresetIbag), pdta->presetIbagSize, pdta->iModSize, "ibag");
+    ok = ok && verify_gens(pdta->presetGen, pdta->presetGenSize, SOUNDFONT_GEN_INSTRUMENT, pdta->presetInstSize, "pgen");
+    ok = ok && verify_gens(pdta->iGen, pdta->iGenSize, SOUNDFONT_GEN_SAMPLE_ID, pdta->shdrSize, "igen");
+    ok = ok && verify_terminal(pdta->presetHeader[pdta->presetHeaderSize - 1].name, "EOP", "phdr");
+    ok = ok && verify_terminal(pdta->presetInst[pdta->presetInstSize - 1].name, "EOI", "inst");
+    ok = ok && verify_terminal(pdta->shdr[pdta->shdrSize - 1].name, "EOS", "shdr");
+    if (!ok) {
+        return false;
     }
-    if (NULL != pdta->shdr) {
-        free(pdta->shdr);
+
+    // right, left and linked samples name their partner, mono and ROM samples may leave the link unset
+    for (uint32_t i = 0; i + 1 < pdta->shdrSize; i++) {
+        const SoundFontSample *sample = pdta->shdr + i;
+        if (0 != (sample->sampleType & 0x0E) && sample->sampleLink + 1 >= pdta->shdrSize) {
+            printf("Broken sample link in shdr.\n");
+            return false;
+        }
     }
+    pdta->verified = true;
+
+    return true;
 }
 
 void soundfont_print_pdta(SoundFontPdtaData *pdta) {
@@ -287,7 +606,83 @@ void soundfont_print_pdta(SoundFontPdtaData *pdta) {
     print_pdta_shdr(pdta);
 }
 
+/*
+    A fast 64-bit content hash: four independent multiply-xorshift lanes over 64-bit words, so
+    hashing runs at memory speed, with the tail folded in byte by byte. Not for adversarial input.
+*/
+uint64_t soundfont_hash(const void *data, size_t size) {
+    const uint8_t *bytes = (const uint8_t *)data;
+    const uint64_t prime = 0x9E3779B97F4A7C15ull;
+    uint64_t lanes[4] = {size, prime, prime << 1, prime >> 1};
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (int l = 0; l < 4; l++) {
+            uint64_t word;
+            memcpy(&word, bytes + i + l * 8, 8);
+            lanes[l] = (lanes[l] ^ word) * prime;
+            lanes[l] ^= lanes[l] >> 29;
+        }
+    }
+    uint64_t hash = lanes[0] ^ lanes[1] * 3 ^ lanes[2] * 5 ^ lanes[3] * 7;
+    for (; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    }
+    return hash ^ hash >> 32;
+}
+
+SoundFontRecordType soundfont_record_type(const char *fourcc) {
+    for (int i = 0; i < PDTA_TABLE_COUNT; i++) {
+        if (0 == memcmp(fourcc, *PDTA_TABLES[i].fourcc, 4)) {
+            return (SoundFontRecordType)i;
+        }
+    }
+    return SOUNDFONT_RECORD_TYPES;
+}
+
+uint32_t soundfont_record_size(SoundFontRecordType type) {
+    return PDTA_TABLES[type].recordSize;
+}
+
+/*
+    Decodes one record of the given type from its file layout into the matching struct, the same
+    way the whole tables are decoded by soundfont_decode_pdta.
+*/
+void soundfont_decode_record(SoundFontRecordType type, void *record, const uint8_t *data) {
+    switch (type) {
+        case SOUNDFONT_RECORD_PHDR:
+            decode_preset_header((SoundFontPresetHeader *)record, data);
+            break;
+        case SOUNDFONT_RECORD_SHDR:
+            decode_sample((SoundFontSample *)record, data);
+            break;
+        case SOUNDFONT_RECORD_INST: {
+            SoundFontPresetInst *inst = (SoundFontPresetInst *)record;
+            memcpy(inst->name, data, 20);
+            inst->index = soundfont_read_u16(data + 20);
+            break;
+        }
+        default:
+            decode_u16_records((uint16_t *)record, data, PDTA_TABLES[type].recordSize / 2);
+            break;
+    }
+}
+
+void soundfont_init_sdta(SoundFontSdtaData *sdta) {
+    sdta->data = NULL;
+    sdta->size = 0;
+    sdta->sm24 = NULL;
+    sdta->sm24Size = 0;
+    sdta->samples = NULL;
+    sdta->samplesMemory = NULL;
+    sdta->mapping.base = NULL;
+    sdta->mapping.size = 0;
+    sdta->mapping.data = NULL;
+}
+
 bool soundfont_read_sdta(SoundFontSdtaData *sdta, FILE *file) {
+    SOUNDFONT_STATS_BEGIN(timer);
+    soundfont_init_sdta(sdta);
+
     char fourcc[5];
     fourcc[4] = '\0';
     if (soundfont_read_fourcc(fourcc, file)) {
@@ -297,7 +692,14 @@ bool soundfont_read_sdta(SoundFontSdtaData *sdta, FILE *file) {
             sdta->size = chunkSize;
             sdta->data = (uint8_t *)malloc(chunkSize);
             if (NULL != sdta->data) {
-                fread(sdta->data, 1, chunkSize, file);
+                size_t got = fread(sdta->data, 1, chunkSize, file);
+                SOUNDFONT_STATS_ADD(SOUNDFONT_COUNT_BYTES_READ, got);
+                if (got != chunkSize) {
+                    printf("Failed to read smpl chunk.\n");
+                    soundfont_release_sdta(sdta);
+
+                    return false;
+                }
             } else {
                 printf("Not enough memory for reading sdta.\n");
 
@@ -308,17 +710,216 @@ bool soundfont_read_sdta(SoundFontSdtaData *sdta, FILE *file) {
 
             return false;
         }
+
+        // as in soundfont_map_sdta, an sm24 chunk running past the end of the file is ignored
+        uint32_t sm24Size = find_sm24(file, chunkSize);
+        int64_t sm24Offset = soundfont_os_tell(file);
+        if (sm24Size > 0 && soundfont_os_file_size(file) - sm24Offset < (int64_t)sm24Size) {
+            sm24Size = 0;
+        }
+        if (sm24Size > 0) {
+            sdta->sm24 = (uint8_t *)malloc(sm24Size);
+            if (NULL == sdta->sm24) {
+                printf("Not enough memory for reading sm24.\n");
+                soundfont_release_sdta(sdta);
+
+                return false;
+            }
+            size_t got = fread(sdta->sm24, 1, sm24Size, file);
+            SOUNDFONT_STATS_ADD(SOUNDFONT_COUNT_BYTES_READ, got);
+            // a short read would mix uninitialised bytes into every point, the 16 bit samples are kept alone
+            if (got != sm24Size) {
+                free(sdta->sm24);
+                sdta->sm24 = NULL;
+            } else {
+                sdta->sm24Size = sm24Size;
+            }
+        }
     } else {
         printf("Failed to read stda chunk.\n");
 
         return false;
     }
+    SOUNDFONT_STATS_END(SOUNDFONT_PHASE_SDTA_READ, timer);
+
+    return true;
+}
+
+/*
+    Zero-copy alternative to soundfont_read_sdta. The smpl payload is mapped read-only and
+    sdta->data points straight into the mapping, so the load cost no longer depends on the
+    sample size and every process opening the same font shares its page cache. A following
+    sm24 chunk is covered by the same mapping.
+*/
+bool soundfont_map_sdta(SoundFontSdtaData *sdta, FILE *file, SoundFontAdvice advice) {
+    soundfont_init_sdta(sdta);
+
+    char fourcc[5];
+    fourcc[4] = '\0';
+    if (!soundfont_read_fourcc(fourcc, file)) {
+        printf("Failed to read stda chunk.\n");
+
+        return false;
+    }
+    uint32_t chunkSize = soundfont_read_size(file);
+    if (0 != strcmp(fourcc, "smpl")) {
+        printf("Invalid chunk type for sdta.\n");
+
+        return false;
+    }
+
+    SoundFontSdtaLocation location;
+    location.smplOffset = soundfont_os_tell(file);
+    location.smplSize = chunkSize;
+    location.sm24Offset = 0;
+    location.sm24Size = 0;
+    int64_t end = location.smplOffset + chunkSize;
+    if (location.smplOffset >= 0 && soundfont_os_seek(file, end)) {
+        location.sm24Size = find_sm24(file, chunkSize);
+        location.sm24Offset = soundfont_os_tell(file);
+    }
+    if (!soundfont_map_sdta_at(sdta, file, &location, advice)) {
+        return false;
+    }
+
+    // leave the stream positioned after the chunks, as soundfont_read_sdta does
+    if (NULL != sdta->sm24) {
+        end = location.sm24Offset + location.sm24Size;
+    }
+    if (!soundfont_os_seek(file, end)) {
+        soundfont_release_sdta(sdta);
+
+        return false;
+    }
+
+    return true;
+}
+
+/*
+    Finds the smpl chunk, and sm24 when there is one, from the chunk headers of the file. The
+    stream position is left undefined.
+*/
+bool soundfont_locate_sdta(FILE *file, SoundFontSdtaLocation *location) {
+    SoundFontChunkDirectory directory;
+    soundfont_init_chunks(&directory);
+    bool ok = soundfont_scan_chunks(&directory, file) && soundfont_find_sdta(&directory, location);
+    soundfont_release_chunks(&directory);
+
+    return ok;
+}
+
+bool soundfont_find_sdta(const SoundFontChunkDirectory *directory, SoundFontSdtaLocation *location) {
+    const SoundFontChunk *smpl = soundfont_find_chunk(directory, STR_TYPE_SDTA, "smpl");
+    if (NULL == smpl) {
+        return false;
+    }
+    location->smplOffset = smpl->offset;
+    location->smplSize = smpl->size;
+    location->sm24Offset = 0;
+    location->sm24Size = 0;
+
+    const SoundFontChunk *sm24 = soundfont_find_chunk(directory, STR_TYPE_SDTA, "sm24");
+    if (NULL != sm24 && sm24->size < smpl->size / 2) {
+        printf("Ignored a sm24 chunk shorter than the sample data.\n");
+    } else if (NULL != sm24) {
+        location->sm24Offset = sm24->offset;
+        location->sm24Size = sm24->size;
+    }
+
+    return true;
+}
+
+// maps the chunks soundfont_locate_sdta found, the stream position is not used
+bool soundfont_map_sdta_at(SoundFontSdtaData *sdta, FILE *file, const SoundFontSdtaLocation *location, SoundFontAdvice advice) {
+    SOUNDFONT_STATS_BEGIN(timer);
+    soundfont_init_sdta(sdta);
+
+    int64_t offset = location->smplOffset;
+    int64_t fileSize = soundfont_os_file_size(file);
+    if (offset < 0 || fileSize < offset + location->smplSize) {
+        printf("Broken data for sdta.\n");
+
+        return false;
+    }
+
+    // the mapping runs from smpl to the end of sm24 when the font has one
+    int64_t end = offset + location->smplSize;
+    bool sm24 = location->sm24Size > 0 && location->sm24Offset >= end && fileSize >= location->sm24Offset + location->sm24Size;
+    if (sm24) {
+        end = location->sm24Offset + location->sm24Size;
+    }
+
+    if (!soundfont_os_map(&sdta->mapping, file, offset, (size_t)(end - offset))) {
+        printf("Failed to map sdta.\n");
+
+        return false;
+    }
+    sdta->data = sdta->mapping.data;
+    sdta->size = location->smplSize;
+    if (sm24) {
+        sdta->sm24 = sdta->mapping.data + (location->sm24Offset - offset);
+        sdta->sm24Size = location->sm24Size;
+    }
+    soundfont_os_advise(sdta->data, (size_t)(end - offset), advice);
+    SOUNDFONT_STATS_END(SOUNDFONT_PHASE_SDTA_MAP, timer);
+
+    return true;
+}
+
+void soundfont_advise_sdta(SoundFontSdtaData *sdta, SoundFontAdvice advice) {
+    if (NULL != sdta->mapping.base) {
+        soundfont_os_advise(sdta->data, sdta->size, advice);
+        if (NULL != sdta->sm24) {
+            soundfont_os_advise(sdta->sm24, sdta->sm24Size, advice);
+        }
+    }
+}
+
+/*
+    Converts every sample point to float32 in [-1, 1) once at load time, so renderers read floats
+    and never widen or scale integers per voice and sample. With merge24 the low bytes of an sm24
+    chunk are merged in first; the spec ignores sm24 in fonts older than version 2.04, whose
+    callers pass false. The integer data stays available.
+*/
+bool soundfont_convert_sdta(SoundFontSdtaData *sdta, bool merge24) {
+    uint32_t count = sdta->size / 2;
+    if (NULL == sdta->data || 0 == count) {
+        printf("No sample data to convert.\n");
+
+        return false;
+    }
+    if (NULL != sdta->samplesMemory) {
+        free(sdta->samplesMemory);
+    }
+    sdta->samples = NULL;
+    sdta->samplesMemory = malloc(sizeof(float) * (size_t)count + SOUNDFONT_SIMD_ALIGN);
+    if (NULL == sdta->samplesMemory) {
+        printf("Not enough memory for converting sdta.\n");
+
+        return false;
+    }
+    sdta->samples = (float *)(((uintptr_t)sdta->samplesMemory + SOUNDFONT_SIMD_ALIGN - 1) & ~(uintptr_t)(SOUNDFONT_SIMD_ALIGN - 1));
+    convert_points(sdta->samples, sdta->data, merge24 ? sdta->sm24 : NULL, count);
 
     return true;
 }
 
 void soundfont_release_sdta(SoundFontSdtaData *sdta) {
-    free(sdta->data);
+    if (NULL != sdta->mapping.base) {
+        soundfont_os_unmap(&sdta->mapping);
+    } else {
+        free(sdta->data);
+        free(sdta->sm24);
+    }
+    if (NULL != sdta->samplesMemory) {
+        free(sdta->samplesMemory);
+    }
+    sdta->data = NULL;
+    sdta->size = 0;
+    sdta->sm24 = NULL;
+    sdta->sm24Size = 0;
+    sdta->samples = NULL;
+    sdta->samplesMemory = NULL;
 }
 
 void soundfont_init_info(SoundFontInfo *info) {
@@ -392,6 +993,9 @@ void soundfont_release_info(SoundFontInfo *info) {
     if (NULL != info->engine) {
         free(info->engine);
     }
+    if (NULL != info->name) {
+        free(info->name);
+    }
     if (NULL != info->author) {
         free(info->author);
     }
@@ -429,169 +1033,54 @@ void soundfont_print_info(SoundFontInfo *info) {
     printf("tools : %s\n", info->tools);
 }
 
-static bool read_pdta_preset_header(SoundFontPdtaData *pdta, uint32_t *pdtaSize, FILE *file) {
-    uint32_t chunkSize = soundfont_read_size(file);
-    if (chunkSize <= 0) {
-        printf("Failed to fetch the size of preset header.");
-        return false;
+static void read_pdta_preset_header(SoundFontPdtaData *pdta, const uint8_t *data) {
+    for (int i = 0; i < pdta->presetHeaderSize; i++, data += 38) {
+        decode_preset_header(pdta->presetHeader + i, data);
     }
-    *pdtaSize -= 4;
+}
 
-    uint16_t HEADER_SIZE = 38;
-    if (chunkSize % HEADER_SIZE != 0) {
-        printf("Broken data for preset header.");
-        return false;
-    }
-    pdta->presetHeaderSize = chunkSize / HEADER_SIZE;
-    pdta->presetHeader = (SoundFontPresetHeader *)malloc(sizeof(SoundFontPresetHeader) * pdta->presetHeaderSize);
+static void decode_preset_header(SoundFontPresetHeader *header, const uint8_t *data) {
+    memcpy(header->name, data, 20);
+    header->preset = soundfont_read_u16(data + 20);
+    header->bank = soundfont_read_u16(data + 22);
+    header->presetBagNdx = soundfont_read_u16(data + 24);
+    header->library = soundfont_read_u32(data + 26);
+    header->genre = soundfont_read_u32(data + 30);
+    header->morphology = soundfont_read_u32(data + 34);
+}
 
-    uint8_t buffer[4];
+static void print_pdta_preset_header(SoundFontPdtaData *pdta) {
+    printf("\n=== PDTA PRESET HEADER START ===\n");
     for (int i = 0; i < pdta->presetHeaderSize; i++) {
         SoundFontPresetHeader *header = pdta->presetHeader + i;
+        printf("name : %s ", header->name);
+        printf("preset : %d ", header->preset);
+        printf("bank : %d ", header->bank);
+        printf("presetBagNdx : %d ", header->presetBagNdx);
+        printf("library : %d ", header->library);
+        printf("genre : %d ", header->genre);
+        printf("morphology : %d ", header->morphology);
+        printf("\n");
+    }
+    printf("=== PDTA PRESET HEADER END   ===\n");
+}
 
-        if (20 != fread(header->name, 1, 20, file)) {
-            return false;
-        }
+static void read_pdta_preset_index(SoundFontPdtaData *pdta, const uint8_t *data) {
+    decode_u16_records((uint16_t *)pdta->presetIndex, data, pdta->presetIndexSize * (sizeof(SoundFontPresetIndex) / 2));
+}
 
-        if (2 == fread(&buffer, 1, 2, file)) {
-            header->preset = buffer[0] | buffer[1] << 8;
-        } else {
-            return false;
-        }
+static void print_pdta_preset_index(SoundFontPdtaData *pdta) {
+    printf("\n=== PDTA PRESET INDEX START ===\n");
+    for (int i = 0; i < pdta->presetIndexSize; i++) {
+        SoundFontPresetIndex *index = pdta->presetIndex + i;
+        printf("genNdx : %d modNdx : %d\n", index->genNdx, index->modNdx);
+    }
+    printf("=== PDTA PRESET INDEX END   ===\n");
+}
 
-        if (2 == fread(&buffer, 1, 2, file)) {
-            header->bank = buffer[0] | buffer[1] << 8;
-        } else {
-            return false;
-        }
-
-        if (2 == fread(&buffer, 1, 2, file)) {
-            header->presetBagNdx = buffer[0] | buffer[1] << 8;
-        } else {
-            return false;
-        }
-
-        if (4 == fread(&buffer, 1, 4, file)) {
-            header->library = buffer[0] | buffer[1] << 8 | buffer[2] << 16 | buffer[3] << 24;
-        } else {
-            return false;
-        }
-
-        if (4 == fread(&buffer, 1, 4, file)) {
-            header->genre = buffer[0] | buffer[1] << 8 | buffer[2] << 16 | buffer[3] << 24;
-        } else {
-            return false;
-        }
-
-        if (4 == fread(&buffer, 1, 4, file)) {
-            header->morphology = buffer[0] | buffer[1] << 8 | buffer[2] << 16 | buffer[3] << 24;
-        } else {
-            return false;
-        }
-    }
-
-    *pdtaSize -= chunkSize;
-
-    return true;
-}
-
-static void print_pdta_preset_header(SoundFontPdtaData *pdta) {
-    printf("\n=== PDTA PRESET HEADER START ===\n");
-    for (int i = 0; i < pdta->presetHeaderSize; i++) {
-        SoundFontPresetHeader *header = pdta->presetHeader + i;
-        printf("name : %s ", header->name);
-        printf("preset : %d ", header->preset);
-        printf("bank : %d ", header->bank);
-        printf("presetBagNdx : %d ", header->presetBagNdx);
-        printf("library : %d ", header->library);
-        printf("genre : %d ", header->genre);
-        printf("morphology : %d ", header->morphology);
-        printf("\n");
-    }
-    printf("=== PDTA PRESET HEADER END   ===\n");
-}
-
-static bool read_pdta_preset_index(SoundFontPdtaData *pdta, uint32_t *pdtaSize, FILE *file) {
-    uint32_t chunkSize = soundfont_read_size(file);
-    if (chunkSize <= 0) {
-        printf("Failed to fetch the size of preset index.");
-        return false;
-    }
-    *pdtaSize -= 4;
-
-    uint16_t INDEX_SIZE = 4;
-    if (chunkSize % INDEX_SIZE != 0) {
-        printf("Broken data for preset index.");
-        return false;
-    }
-    pdta->presetIndexSize = chunkSize / INDEX_SIZE;
-    pdta->presetIndex = (SoundFontPresetIndex *)malloc(sizeof(SoundFontPresetIndex) * pdta->presetIndexSize);
-
-    uint8_t buffer[2];
-    for (int i = 0; i < pdta->presetIndexSize; i++) {
-        SoundFontPresetIndex *index = pdta->presetIndex + i;
-
-        fread(&buffer, 1, 2, file);
-        index->genNdx = buffer[0] | buffer[1] << 8;
-
-        fread(&buffer, 1, 2, file);
-        index->modNdx = buffer[0] | buffer[1] << 8;
-    }
-
-    *pdtaSize -= chunkSize;
-
-    return true;
-}
-
-static void print_pdta_preset_index(SoundFontPdtaData *pdta) {
-    printf("\n=== PDTA PRESET INDEX START ===\n");
-    for (int i = 0; i < pdta->presetIndexSize; i++) {
-        SoundFontPresetIndex *index = pdta->presetIndex + i;
-        printf("genNdx : %d modNdx : %d\n", index->genNdx, index->modNdx);
-    }
-    printf("=== PDTA PRESET INDEX END   ===\n");
-}
-
-static bool read_pdta_preset_mod(SoundFontPdtaData *pdta, uint32_t *pdtaSize, FILE *file) {
-    uint32_t chunkSize = soundfont_read_size(file);
-    if (chunkSize <= 0) {
-        printf("Failed to fetch the size of preset mod.");
-        return false;
-    }
-    *pdtaSize -= 4;
-
-    uint16_t MOD_SIZE = 10;
-    if (chunkSize % MOD_SIZE != 0) {
-        printf("Broken data for preset mod.");
-        return false;
-    }
-    pdta->presetModSize = chunkSize / MOD_SIZE;
-    pdta->presetMod = (SoundFontMod *)malloc(sizeof(SoundFontMod) * pdta->presetModSize);
-
-    uint8_t buffer[2];
-    for (int i = 0; i < pdta->presetModSize; i++) {
-        SoundFontMod *mod = pdta->presetMod + i;
-
-        fread(&buffer, 1, 2, file);
-        mod->srcOperator = buffer[0] | buffer[1] << 8;
-
-        fread(&buffer, 1, 2, file);
-        mod->destOperator = buffer[0] | buffer[1] << 8;
-
-        fread(&buffer, 1, 2, file);
-        mod->amount = buffer[0] | buffer[1] << 8;
-
-        fread(&buffer, 1, 2, file);
-        mod->amtSrcOperator = buffer[0] | buffer[1] << 8;
-
-        fread(&buffer, 1, 2, file);
-        mod->transOperator = buffer[0] | buffer[1] << 8;
-    }
-
-    *pdtaSize -= chunkSize;
-
-    return true;
-}
+static void read_pdta_preset_mod(SoundFontPdtaData *pdta, const uint8_t *data) {
+    decode_u16_records((uint16_t *)pdta->presetMod, data, pdta->presetModSize * (sizeof(SoundFontMod) / 2));
+}
 
 static void print_pdta_preset_mod(SoundFontPdtaData *pdta) {
     printf("\n=== PDTA PRESET MOD START ===\n");
@@ -606,36 +1095,8 @@ static void print_pdta_preset_mod(SoundFontPdtaData *pdta) {
     printf("=== PDTA PRESET MOD END   ===\n");
 }
 
-static bool read_pdta_preset_gen(SoundFontPdtaData *pdta, uint32_t *pdtaSize, FILE *file) {
-    uint32_t chunkSize = soundfont_read_size(file);
-    if (chunkSize <= 0) {
-        printf("Failed to fetch the size of preset generator.");
-        return false;
-    }
-    *pdtaSize -= 4;
-
-    uint16_t GEN_SIZE = 4;
-    if (chunkSize % GEN_SIZE != 0) {
-        printf("Broken data for preset generator.");
-        return false;
-    }
-    pdta->presetGenSize = chunkSize / GEN_SIZE;
-    pdta->presetGen = (SoundFontGen *)malloc(sizeof(SoundFontGen) * pdta->presetGenSize);
-
-    uint8_t buffer[2];
-    for (int i = 0; i < pdta->presetGenSize; i++) {
-        SoundFontGen *gen = pdta->presetGen + i;
-
-        fread(&buffer, 1, 2, file);
-        gen->operator= buffer[0] | buffer[1] << 8;
-
-        fread(&buffer, 1, 2, file);
-        gen->amount = buffer[0] | buffer[1] << 8;
-    }
-
-    *pdtaSize -= chunkSize;
-
-    return true;
+static void read_pdta_preset_gen(SoundFontPdtaData *pdta, const uint8_t *data) {
+    decode_u16_records((uint16_t *)pdta->presetGen, data, pdta->presetGenSize * (sizeof(SoundFontGen) / 2));
 }
 
 static void print_pdta_preset_gen(SoundFontPdtaData *pdta) {
@@ -647,37 +1108,16 @@ static void print_pdta_preset_gen(SoundFontPdtaData *pdta) {
     printf("=== PDTA PRESET GENERATOR END   ===\n");
 }
 
-static bool read_pdta_preset_inst(SoundFontPdtaData *pdta, uint32_t *pdtaSize, FILE *file) {
-    uint32_t chunkSize = soundfont_read_size(file);
-    if (chunkSize <= 0) {
-        printf("Failed to fetch the size of preset instructment names and indices.");
-        return false;
-    }
-    *pdtaSize -= 4;
-
-    uint16_t INST_SIZE = 22;
-    if (chunkSize % INST_SIZE != 0) {
-        printf("Broken data for preset instructment names and indices.");
-        return false;
-    }
-    pdta->presetInstSize = chunkSize / INST_SIZE;
-    pdta->presetInst = (SoundFontPresetInst *)malloc(sizeof(SoundFontPresetInst) * pdta->presetInstSize);
-
-    uint8_t buffer[2];
-    for (int i = 0; i < pdta->presetInstSize; i++) {
+static void read_pdta_preset_inst(SoundFontPdtaData *pdta, const uint8_t *data) {
+#ifdef SOUNDFONT_LITTLE_ENDIAN
+    memcpy(pdta->presetInst, data, pdta->presetInstSize * 22);
+#else
+    for (int i = 0; i < pdta->presetInstSize; i++, data += 22) {
         SoundFontPresetInst *inst = pdta->presetInst + i;
-
-        if (20 != fread(inst->name, 1, 20, file)) {
-            return false;
-        }
-
-        fread(&buffer, 1, 2, file);
-        inst->index = buffer[0] | buffer[1] << 8;
+        memcpy(inst->name, data, 20);
+        inst->index = soundfont_read_u16(data + 20);
     }
-
-    *pdtaSize -= chunkSize;
-
-    return true;
+#endif
 }
 
 static void print_pdta_preset_inst(SoundFontPdtaData *pdta) {
@@ -689,36 +1129,8 @@ static void print_pdta_preset_inst(SoundFontPdtaData *pdta) {
     printf("=== PDTA PRESET INSTRUMENT NAME AND INDICES END   ===\n");
 }
 
-static bool read_pdta_preset_ibag(SoundFontPdtaData *pdta, uint32_t *pdtaSize, FILE *file) {
-    uint32_t chunkSize = soundfont_read_size(file);
-    if (chunkSize <= 0) {
-        printf("Failed to fetch the size of preset instrument index list.");
-        return false;
-    }
-    *pdtaSize -= 4;
-
-    uint16_t IBAG_SIZE = 4;
-    if (chunkSize % IBAG_SIZE != 0) {
-        printf("Broken data for preset instrument index list.");
-        return false;
-    }
-    pdta->presetIbagSize = chunkSize / IBAG_SIZE;
-    pdta->presetIbag = (SoundFontPresetIbag *)malloc(sizeof(SoundFontPresetIbag) * pdta->presetIbagSize);
-
-    uint8_t buffer[2];
-    for (int i = 0; i < pdta->presetIbagSize; i++) {
-        SoundFontPresetIbag *ibag = pdta->presetIbag + i;
-
-        fread(&buffer, 1, 2, file);
-        ibag->genNdx = buffer[0] | buffer[1] << 8;
-
-        fread(&buffer, 1, 2, file);
-        ibag->modNdx = buffer[0] | buffer[1] << 8;
-    }
-
-    *pdtaSize -= chunkSize;
-
-    return true;
+static void read_pdta_preset_ibag(SoundFontPdtaData *pdta, const uint8_t *data) {
+    decode_u16_records((uint16_t *)pdta->presetIbag, data, pdta->presetIbagSize * (sizeof(SoundFontPresetIbag) / 2));
 }
 
 static void print_pdta_preset_ibag(SoundFontPdtaData *pdta) {
@@ -730,45 +1142,8 @@ static void print_pdta_preset_ibag(SoundFontPdtaData *pdta) {
     printf("=== PDTA PRESET INSTRUMENT INDEX END   ===\n");
 }
 
-static bool read_pdta_inst_mod(SoundFontPdtaData *pdta, uint32_t *pdtaSize, FILE *file) {
-    uint32_t chunkSize = soundfont_read_size(file);
-    if (chunkSize <= 0) {
-        printf("Failed to fetch the size of instrument mod.");
-        return false;
-    }
-    *pdtaSize -= 4;
-
-    uint16_t MOD_SIZE = 10;
-    if (chunkSize % MOD_SIZE != 0) {
-        printf("Broken data for instrument mod.");
-        return false;
-    }
-    pdta->iModSize = chunkSize / MOD_SIZE;
-    pdta->iMod = (SoundFontMod *)malloc(sizeof(SoundFontMod) * pdta->iModSize);
-
-    uint8_t buffer[2];
-    for (int i = 0; i < pdta->iModSize; i++) {
-        SoundFontMod *mod = pdta->iMod + i;
-
-        fread(&buffer, 1, 2, file);
-        mod->srcOperator = buffer[0] | buffer[1] << 8;
-
-        fread(&buffer, 1, 2, file);
-        mod->destOperator = buffer[0] | buffer[1] << 8;
-
-        fread(&buffer, 1, 2, file);
-        mod->amount = buffer[0] | buffer[1] << 8;
-
-        fread(&buffer, 1, 2, file);
-        mod->amtSrcOperator = buffer[0] | buffer[1] << 8;
-
-        fread(&buffer, 1, 2, file);
-        mod->transOperator = buffer[0] | buffer[1] << 8;
-    }
-
-    *pdtaSize -= chunkSize;
-
-    return true;
+static void read_pdta_inst_mod(SoundFontPdtaData *pdta, const uint8_t *data) {
+    decode_u16_records((uint16_t *)pdta->iMod, data, pdta->iModSize * (sizeof(SoundFontMod) / 2));
 }
 
 static void print_pdta_inst_mod(SoundFontPdtaData *pdta) {
@@ -784,146 +1159,426 @@ static void print_pdta_inst_mod(SoundFontPdtaData *pdta) {
     printf("=== PDTA INSTRUMENT MOD END   ===\n");
 }
 
-static bool read_pdta_inst_gen(SoundFontPdtaData *pdta, uint32_t *pdtaSize, FILE *file) {
-    uint32_t chunkSize = soundfont_read_size(file);
-    if (chunkSize <= 0) {
-        printf("Failed to fetch the size of instrument generator.");
-        return false;
+static void read_pdta_inst_gen(SoundFontPdtaData *pdta, const uint8_t *data) {
+    decode_u16_records((uint16_t *)pdta->iGen, data, pdta->iGenSize * (sizeof(SoundFontGen) / 2));
+}
+
+static void print_pdta_inst_gen(SoundFontPdtaData *pdta) {
+    printf("\n=== PDTA PRESET INSTRUMENT START ===\n");
+    for (int i = 0; i < pdta->iGenSize; i++) {
+        SoundFontGen *gen = pdta->iGen + i;
+        printf("operator : %d amount : %d\n", gen->operator, gen->amount);
     }
-    *pdtaSize -= 4;
+    printf("=== PDTA PRESET INSTRUMENT END   ===\n");
+}
 
-    uint16_t GEN_SIZE = 4;
-    if (chunkSize % GEN_SIZE != 0) {
-        printf("Broken data for instrument generator.");
-        return false;
+static void read_pdta_shdr(SoundFontPdtaData *pdta, const uint8_t *data) {
+    for (int i = 0; i < pdta->shdrSize; i++, data += 46) {
+        decode_sample(pdta->shdr + i, data);
     }
-    pdta->iGenSize = chunkSize / GEN_SIZE;
-    pdta->iGen = (SoundFontGen *)malloc(sizeof(SoundFontGen) * pdta->presetGenSize);
+}
 
-    uint8_t buffer[2];
-    for (int i = 0; i < pdta->iGenSize; i++) {
-        SoundFontGen *gen = pdta->iGen + i;
+static void decode_sample(SoundFontSample *header, const uint8_t *data) {
+    memcpy(header->name, data, 20);
+    header->start = soundfont_read_u32(data + 20);
+    header->end = soundfont_read_u32(data + 24);
+    header->startLoop = soundfont_read_u32(data + 28);
+    header->endLoop = soundfont_read_u32(data + 32);
+    header->sampleRate = soundfont_read_u32(data + 36);
+    header->originalPitch = data[40];
+    header->pitchCorrection = (char)data[41];
+    header->sampleLink = soundfont_read_u16(data + 42);
+    header->sampleType = soundfont_read_u16(data + 44);
+}
 
-        fread(&buffer, 1, 2, file);
-        gen->operator= buffer[0] | buffer[1] << 8;
+static void print_pdta_shdr(SoundFontPdtaData *pdta) {
+    printf("\n=== PDTA SAMPLE HEADER START ===\n");
+    for (int i = 0; i < pdta->shdrSize; i++) {
+        SoundFontSample *header = pdta->shdr + i;
+        printf("name : %s ", header->name);
+        printf("start : %d ", header->start);
+        printf("end : %d ", header->end);
+        printf("startLoop : %d ", header->startLoop);
+        printf("endLoop : %d ", header->endLoop);
+        printf("sampleRate : %d ", header->sampleRate);
+        printf("originalPitch : %d ", header->originalPitch);
+        printf("pitchCorrection : %c ", header->pitchCorrection);
+        printf("sampleLink : %d ", header->sampleLink);
+        printf("sampleType : %d ", header->sampleType);
+        printf("\n");
+    }
+    printf("=== PDTA SAMPLE HEADER END   ===\n");
+}
 
-        fread(&buffer, 1, 2, file);
-        gen->amount = buffer[0] | buffer[1] << 8;
+static void decode_pdta_range(SoundFontPdtaData *pdta, PdtaTableId id, uint32_t first, uint32_t count, const uint8_t *data) {
+    switch (id) {
+        case PDTA_PHDR:
+            for (uint32_t i = 0; i < count; i++, data += 38) {
+                decode_preset_header(pdta->presetHeader + first + i, data);
+            }
+            break;
+        case PDTA_PBAG:
+            decode_u16_records((uint16_t *)(pdta->presetIndex + first), data, count * (sizeof(SoundFontPresetIndex) / 2));
+            break;
+        case PDTA_PMOD:
+            decode_u16_records((uint16_t *)(pdta->presetMod + first), data, count * (sizeof(SoundFontMod) / 2));
+            break;
+        case PDTA_PGEN:
+            decode_u16_records((uint16_t *)(pdta->presetGen + first), data, count * (sizeof(SoundFontGen) / 2));
+            break;
+        case PDTA_INST:
+            for (uint32_t i = 0; i < count; i++, data += 22) {
+                soundfont_decode_record(SOUNDFONT_RECORD_INST, pdta->presetInst + first + i, data);
+            }
+            break;
+        case PDTA_IBAG:
+            decode_u16_records((uint16_t *)(pdta->presetIbag + first), data, count * (sizeof(SoundFontPresetIbag) / 2));
+            break;
+        case PDTA_IMOD:
+            decode_u16_records((uint16_t *)(pdta->iMod + first), data, count * (sizeof(SoundFontMod) / 2));
+            break;
+        case PDTA_IGEN:
+            decode_u16_records((uint16_t *)(pdta->iGen + first), data, count * (sizeof(SoundFontGen) / 2));
+            break;
+        case PDTA_SHDR:
+            for (uint32_t i = 0; i < count; i++, data += 46) {
+                decode_sample(pdta->shdr + first + i, data);
+            }
+            break;
+        default:
+            break;
     }
+}
 
-    *pdtaSize -= chunkSize;
+static void pdta_worker(void *arg) {
+    PdtaJob *job = (PdtaJob *)arg;
+    uint8_t *buffer = (uint8_t *)malloc(SOUNDFONT_PDTA_TASK_BYTES);
+    if (NULL == buffer) {
+        __atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+        return;
+    }
 
-    return true;
+    for (;;) {
+        uint32_t index = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+        if (index >= job->taskCount || __atomic_load_n(&job->failed, __ATOMIC_RELAXED)) {
+            break;
+        }
+        const PdtaTask *task = job->tasks + index;
+        if (!soundfont_os_read_at(job->file, buffer, (size_t)task->count * PDTA_TABLES[task->id].recordSize, task->offset)) {
+            __atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+            break;
+        }
+        decode_pdta_range(job->pdta, task->id, task->first, task->count, buffer);
+        SOUNDFONT_STATS_ADD(SOUNDFONT_COUNT_RECORDS_DECODED, task->count);
+        // acquire-release, so the last worker sees every header the others decoded
+        if (PDTA_PHDR == task->id && 0 == __atomic_sub_fetch(&job->phdrLeft, 1, __ATOMIC_ACQ_REL)) {
+            build_preset_map(job->pdta);
+        }
+    }
+    free(buffer);
 }
 
-static void print_pdta_inst_gen(SoundFontPdtaData *pdta) {
-    printf("\n=== PDTA PRESET INSTRUMENT START ===\n");
-    for (int i = 0; i < pdta->iGenSize; i++) {
-        SoundFontGen *gen = pdta->iGen + i;
-        printf("operator : %d amount : %d\n", gen->operator, gen->amount);
+static int32_t count_pdta_records(uint32_t chunkSize, uint32_t recordSize, const char *name) {
+    if (chunkSize == 0) {
+        printf("Failed to fetch the size of %s.", name);
+        return -1;
     }
-    printf("=== PDTA PRESET INSTRUMENT END   ===\n");
+    if (chunkSize % recordSize != 0 || chunkSize / recordSize > UINT16_MAX) {
+        printf("Broken data for %s.", name);
+        return -1;
+    }
+
+    return chunkSize / recordSize;
 }
 
-static bool read_pdta_shdr(SoundFontPdtaData *pdta, uint32_t *pdtaSize, FILE *file) {
-    uint32_t chunkSize = soundfont_read_size(file);
-    if (chunkSize <= 0) {
-        printf("Failed to fetch the size of the sample header.");
+/*
+    Places the nine tables in one cache line aligned block, in PDTA_ARENA_ORDER, each table
+    starting on its own cache line.
+*/
+static bool alloc_pdta_arena(SoundFontPdtaData *pdta, const int32_t *counts) {
+    size_t offsets[PDTA_TABLE_COUNT];
+    size_t total = 0;
+    for (int i = 0; i < PDTA_TABLE_COUNT; i++) {
+        PdtaTableId id = PDTA_ARENA_ORDER[i];
+        offsets[id] = total;
+        total += (PDTA_TABLES[id].structSize * counts[id] + SOUNDFONT_CACHE_LINE - 1) & ~(size_t)(SOUNDFONT_CACHE_LINE - 1);
+    }
+
+    // the preset map is kept at most half full so probes stay short
+    uint32_t slotCount = 16;
+    while (slotCount < (uint32_t)counts[PDTA_PHDR] * 2) {
+        slotCount <<= 1;
+    }
+    size_t mapOffset = total;
+    total += sizeof(SoundFontPresetSlot) * slotCount;
+
+    pdta->arena = malloc(total + SOUNDFONT_CACHE_LINE);
+    if (NULL == pdta->arena) {
+        printf("Not enough memory for reading pdta.\n");
         return false;
     }
-    *pdtaSize -= 4;
+    pdta->arenaSize = total;
+
+    uintptr_t base = ((uintptr_t)pdta->arena + SOUNDFONT_CACHE_LINE - 1) & ~(uintptr_t)(SOUNDFONT_CACHE_LINE - 1);
+    pdta->presetHeader = (SoundFontPresetHeader *)(base + offsets[PDTA_PHDR]);
+    pdta->presetHeaderSize = counts[PDTA_PHDR];
+    pdta->presetIndex = (SoundFontPresetIndex *)(base + offsets[PDTA_PBAG]);
+    pdta->presetIndexSize = counts[PDTA_PBAG];
+    pdta->presetMod = (SoundFontMod *)(base + offsets[PDTA_PMOD]);
+    pdta->presetModSize = counts[PDTA_PMOD];
+    pdta->presetGen = (SoundFontGen *)(base + offsets[PDTA_PGEN]);
+    pdta->presetGenSize = counts[PDTA_PGEN];
+    pdta->presetInst = (SoundFontPresetInst *)(base + offsets[PDTA_INST]);
+    pdta->presetInstSize = counts[PDTA_INST];
+    pdta->presetIbag = (SoundFontPresetIbag *)(base + offsets[PDTA_IBAG]);
+    pdta->presetIbagSize = counts[PDTA_IBAG];
+    pdta->iMod = (SoundFontMod *)(base + offsets[PDTA_IMOD]);
+    pdta->iModSize = counts[PDTA_IMOD];
+    pdta->iGen = (SoundFontGen *)(base + offsets[PDTA_IGEN]);
+    pdta->iGenSize = counts[PDTA_IGEN];
+    pdta->shdr = (SoundFontSample *)(base + offsets[PDTA_SHDR]);
+    pdta->shdrSize = counts[PDTA_SHDR];
+    pdta->presetMap.slots = (SoundFontPresetSlot *)(base + mapOffset);
+    pdta->presetMap.mask = slotCount - 1;
 
-    uint16_t HEADER_SIZE = 46;
-    if (chunkSize % HEADER_SIZE != 0) {
-        printf("Broken data for the sample header.");
-        return false;
+    return true;
+}
+
+static uint32_t hash_preset_key(uint32_t key) {
+    return key * 2654435761u;
+}
+
+/*
+    Open addressing with linear probing, keyed by bank << 7 | program. The last preset header is
+    the EOP terminal record and only bounds the bag range of the one before it.
+*/
+static void build_preset_map(SoundFontPdtaData *pdta) {
+    SoundFontPresetMap *map = &pdta->presetMap;
+    for (uint32_t i = 0; i <= map->mask; i++) {
+        map->slots[i].key = SOUNDFONT_PRESET_EMPTY;
     }
-    pdta->shdrSize = chunkSize / HEADER_SIZE;
-    pdta->shdr = (SoundFontSample *)malloc(sizeof(SoundFontSample) * pdta->shdrSize);
 
-    uint8_t buffer[4];
-    for (int i = 0; i < pdta->shdrSize; i++) {
-        SoundFontSample *header = pdta->shdr + i;
+    for (int i = 0; i + 1 < pdta->presetHeaderSize; i++) {
+        SoundFontPresetHeader *header = pdta->presetHeader + i;
+        uint32_t key = (uint32_t)header->bank << 7 | (header->preset & 0x7F);
 
-        if (20 != fread(header->name, 1, 20, file)) {
-            return false;
+        uint32_t index = hash_preset_key(key) & map->mask;
+        while (map->slots[index].key != SOUNDFONT_PRESET_EMPTY && map->slots[index].key != key) {
+            index = (index + 1) & map->mask;
         }
-
-        if (4 == fread(&buffer, 1, 4, file)) {
-            header->start = buffer[0] | buffer[1] << 8 | buffer[2] << 16 | buffer[3] << 24;
-        } else {
-            return false;
+        // the first of duplicated bank/program pairs wins
+        if (map->slots[index].key == key) {
+            continue;
         }
 
-        if (4 == fread(&buffer, 1, 4, file)) {
-            header->end = buffer[0] | buffer[1] << 8 | buffer[2] << 16 | buffer[3] << 24;
-        } else {
+        SoundFontPresetSlot *slot = map->slots + index;
+        slot->key = key;
+        slot->presetNdx = i;
+        slot->bagStart = header->presetBagNdx;
+        slot->bagEnd = header[1].presetBagNdx < header->presetBagNdx ? header->presetBagNdx : header[1].presetBagNdx;
+    }
+}
+
+/*
+    The index fields of count records, stride bytes apart, never decrease and reach at most the
+    terminal record of their table, which the terminal record of theirs names exactly; so the
+    last zone ends where the indexed table ends.
+*/
+static bool verify_links(const uint16_t *links, size_t stride, uint32_t count, uint32_t targetSize, const char *name) {
+    uint32_t previous = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t index = *(const uint16_t *)((const uint8_t *)links + stride * i);
+        if (index < previous || index >= targetSize) {
+            printf("Broken index %u of %s record %u.\n", index, name, i);
             return false;
         }
+        previous = index;
+    }
+    if (previous + 1 != targetSize) {
+        printf("Terminal %s record indexes %u of %u records.\n", name, previous, targetSize);
+        return false;
+    }
 
-        if (4 == fread(&buffer, 1, 4, file)) {
-            header->startLoop = buffer[0] | buffer[1] << 8 | buffer[2] << 16 | buffer[3] << 24;
-        } else {
+    return true;
+}
+
+// the terminal record of phdr, inst and shdr carries the name the specification gives it
+static bool verify_terminal(const char *recordName, const char *expected, const char *name) {
+    if (0 != strncmp(recordName, expected, 20)) {
+        printf("Missing %s terminal record of %s.\n", expected, name);
+        return false;
+    }
+
+    return true;
+}
+
+// every generator of the given operator names a record before the terminal one of its table
+static bool verify_gens(const SoundFontGen *gens, uint16_t genCount, uint16_t operator, uint32_t targetSize, const char *name) {
+    for (uint32_t i = 0; i < genCount; i++) {
+        if (gens[i].operator == operator && gens[i].amount + 1u >= targetSize) {
+            printf("Broken link %u of %s record %u.\n", gens[i].amount, name, i);
             return false;
         }
+    }
 
-        if (4 == fread(&buffer, 1, 4, file)) {
-            header->endLoop = buffer[0] | buffer[1] << 8 | buffer[2] << 16 | buffer[3] << 24;
-        } else {
-            return false;
+    return true;
+}
+
+static const SoundFontPresetSlot *probe_preset_map(const SoundFontPresetMap *map, uint32_t key) {
+    uint32_t index = hash_preset_key(key) & map->mask;
+    while (map->slots[index].key != SOUNDFONT_PRESET_EMPTY) {
+        if (map->slots[index].key == key) {
+            return map->slots + index;
         }
+        index = (index + 1) & map->mask;
+    }
 
-        if (4 == fread(&buffer, 1, 4, file)) {
-            header->sampleRate = buffer[0] | buffer[1] << 8 | buffer[2] << 16 | buffer[3] << 24;
-        } else {
+    return NULL;
+}
+
+/*
+    Every bag, modulator and generator record is a plain run of little endian words, so the
+    tables are filled as flat uint16_t arrays. On little endian hosts that is a single copy.
+*/
+static void decode_u16_records(uint16_t *dest, const uint8_t *data, uint32_t count) {
+#ifdef SOUNDFONT_LITTLE_ENDIAN
+    memcpy(dest, data, count * 2);
+#else
+    for (uint32_t i = 0; i < count; i++, data += 2) {
+        dest[i] = data[0] | data[1] << 8;
+    }
+#endif
+}
+
+// lists the chunks between position and end, descending into the LISTs of the RIFF form
+static bool scan_chunks(SoundFontChunkDirectory *directory, FILE *file, const char *list, int64_t position, int64_t end) {
+    while (end - position >= 8) {
+        uint8_t header[8];
+        if (!soundfont_os_seek(file, position) || 8 != fread(header, 1, 8, file)) {
+            printf("Failed to read the chunk headers.\n");
             return false;
         }
 
-        if (1 == fread(&buffer, 1, 1, file)) {
-            header->originalPitch = buffer[0];
-        } else {
+        SoundFontChunk chunk;
+        memcpy(chunk.fourcc, header, 4);
+        chunk.fourcc[4] = '\0';
+        chunk.size = soundfont_read_u32(header + 4);
+        strcpy(chunk.list, list);
+        chunk.offset = position + 8;
+        if (chunk.size > end - chunk.offset) {
+            printf("Broken %s chunk.\n", chunk.fourcc);
             return false;
         }
 
-        if (1 == fread(&buffer, 1, 1, file)) {
-            header->pitchCorrection = buffer[0];
-        } else {
+        bool isList = '\0' == list[0] && 0 == strcmp(chunk.fourcc, STR_FORMAT_LIST) && chunk.size >= 4;
+        if (isList) {
+            if (4 != fread(chunk.fourcc, 1, 4, file)) {
+                printf("Failed to read the chunk headers.\n");
+                return false;
+            }
+            chunk.offset += 4;
+            chunk.size -= 4;
+        }
+        if (!add_chunk(directory, &chunk)) {
             return false;
         }
-
-        if (2 == fread(&buffer, 1, 2, file)) {
-            header->sampleLink = buffer[0] | buffer[1] << 8;
-        } else {
+        if (isList && !scan_chunks(directory, file, chunk.fourcc, chunk.offset, chunk.offset + chunk.size)) {
             return false;
         }
 
-        if (2 == fread(&buffer, 1, 2, file)) {
-            header->sampleType = buffer[0] | buffer[1] << 8;
-        } else {
+        // RIFF pads odd sized chunks to a word boundary
+        uint32_t size = soundfont_read_u32(header + 4);
+        position += 8 + (int64_t)size + (size & 1);
+    }
+
+    return true;
+}
+
+static bool add_chunk(SoundFontChunkDirectory *directory, const SoundFontChunk *chunk) {
+    if (directory->count == directory->capacity) {
+        uint32_t capacity = directory->capacity > 0 ? directory->capacity * 2 : 32;
+        SoundFontChunk *chunks = (SoundFontChunk *)realloc(directory->chunks, sizeof(SoundFontChunk) * capacity);
+        if (NULL == chunks) {
+            printf("Not enough memory for the chunk directory.\n");
             return false;
         }
+        directory->chunks = chunks;
+        directory->capacity = capacity;
     }
-
-    *pdtaSize -= chunkSize;
+    directory->chunks[directory->count++] = *chunk;
 
     return true;
 }
 
-static void print_pdta_shdr(SoundFontPdtaData *pdta) {
-    printf("\n=== PDTA SAMPLE HEADER START ===\n");
-    for (int i = 0; i < pdta->shdrSize; i++) {
-        SoundFontSample *header = pdta->shdr + i;
-        printf("name : %s ", header->name);
-        printf("start : %d ", header->start);
-        printf("end : %d ", header->end);
-        printf("startLoop : %d ", header->startLoop);
-        printf("endLoop : %d ", header->endLoop);
-        printf("sampleRate : %d ", header->sampleRate);
-        printf("originalPitch : %d ", header->originalPitch);
-        printf("pitchCorrection : %c ", header->pitchCorrection);
-        printf("sampleLink : %d ", header->sampleLink);
-        printf("sampleType : %d ", header->sampleType);
-        printf("\n");
+/*
+    Looks for the sm24 chunk an SF2.04 font places after smpl. With the stream just past the smpl
+    payload, returns the sm24 payload size and leaves the stream at the payload; otherwise returns
+    0 and leaves the stream where it was. An sm24 chunk shorter than one byte per point is ignored.
+*/
+static uint32_t find_sm24(FILE *file, uint32_t smplSize) {
+    int64_t position = soundfont_os_tell(file);
+    uint8_t header[8];
+    uint32_t size = 0;
+    if (position >= 0 && soundfont_os_seek(file, position + (smplSize & 1)) && 8 == fread(header, 1, 8, file) && 0 == memcmp(header, "sm24", 4)) {
+        size = soundfont_read_u32(header + 4);
+    }
+    if (0 == size || size < smplSize / 2) {
+        if (size > 0) {
+            printf("Ignored a sm24 chunk shorter than the sample data.\n");
+        }
+        clearerr(file);
+        soundfont_os_seek(file, position);
+
+        return 0;
     }
-    printf("=== PDTA SAMPLE HEADER END   ===\n");
-}
\ No newline at end of file
+
+    return size;
+}
+
+// little-endian 16-bit points, with their sm24 low bytes when low is set, to float32
+static void convert_points(float *out, const uint8_t *data, const uint8_t *low, uint32_t count) {
+    const float scale = NULL != low ? 1.0f / 8388608.0f : 1.0f / 32768.0f;
+    uint32_t i = 0;
+#if defined(SOUNDFONT_LITTLE_ENDIAN) && defined(SOUNDFONT_SIMD_AVX2)
+    for (; i + 8 <= count; i += 8) {
+        __m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(data + 2 * i)));
+        if (NULL != low) {
+            x = _mm256_or_si256(_mm256_slli_epi32(x, 8), _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(low + i))));
+        }
+        _mm256_store_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(x), _mm256_set1_ps(scale)));
+    }
+#elif defined(SOUNDFONT_LITTLE_ENDIAN) && defined(SOUNDFONT_SIMD_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8) {
+        // points into the high halves, then an arithmetic shift sign-extends them
+        __m128i x = _mm_loadu_si128((const __m128i *)(data + 2 * i));
+        __m128i a = _mm_srai_epi32(_mm_unpacklo_epi16(zero, x), 16);
+        __m128i b = _mm_srai_epi32(_mm_unpackhi_epi16(zero, x), 16);
+        if (NULL != low) {
+            __m128i bytes = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(low + i)), zero);
+            a = _mm_or_si128(_mm_slli_epi32(a, 8), _mm_unpacklo_epi16(bytes, zero));
+            b = _mm_or_si128(_mm_slli_epi32(b, 8), _mm_unpackhi_epi16(bytes, zero));
+        }
+        _mm_store_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(a), _mm_set1_ps(scale)));
+        _mm_store_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(b), _mm_set1_ps(scale)));
+    }
+#elif defined(SOUNDFONT_LITTLE_ENDIAN) && defined(SOUNDFONT_SIMD_NEON)
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t x = vld1q_s16((const int16_t *)(data + 2 * i));
+        int32x4_t a = vmovl_s16(vget_low_s16(x));
+        int32x4_t b = vmovl_s16(vget_high_s16(x));
+        if (NULL != low) {
+            uint16x8_t bytes = vmovl_u8(vld1_u8(low + i));
+            a = vorrq_s32(vshlq_n_s32(a, 8), vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(bytes))));
+            b = vorrq_s32(vshlq_n_s32(b, 8), vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(bytes))));
+        }
+        vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(a), scale));
+        vst1q_f32(out + i + 4, vmulq_n_f32(vcvtq_f32_s32(b), scale));
+    }
+#endif
+    // the tail, and every point on targets without a kernel
+    for (; i < count; i++) {
+        int32_t value = (int16_t)(data[2 * i] | data[2 * i + 1] << 8);
+        out[i] = (float)(NULL != low ? value * 256 | low[i] : value) * scale;
+    }
+}
@@ -31,6 +31,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "soundfont_os.h"
+
 typedef enum SoundFontListType {
     SOUNDFONT_TYPE_INFO,
     SOUNDFONT_TYPE_SDTA,
@@ -38,6 +40,72 @@ typedef enum SoundFontListType {
     SOUNDFONT_TYPE_UNKNOW
 } SoundFontListType;
 
+// generator operators, SoundFont 2.01 specification section 8.1.2
+typedef enum SoundFontGenerator {
+    SOUNDFONT_GEN_START_ADDRS_OFFSET = 0,
+    SOUNDFONT_GEN_END_ADDRS_OFFSET,
+    SOUNDFONT_GEN_STARTLOOP_ADDRS_OFFSET,
+    SOUNDFONT_GEN_ENDLOOP_ADDRS_OFFSET,
+    SOUNDFONT_GEN_START_ADDRS_COARSE_OFFSET,
+    SOUNDFONT_GEN_MOD_LFO_TO_PITCH,
+    SOUNDFONT_GEN_VIB_LFO_TO_PITCH,
+    SOUNDFONT_GEN_MOD_ENV_TO_PITCH,
+    SOUNDFONT_GEN_INITIAL_FILTER_FC,
+    SOUNDFONT_GEN_INITIAL_FILTER_Q,
+    SOUNDFONT_GEN_MOD_LFO_TO_FILTER_FC,
+    SOUNDFONT_GEN_MOD_ENV_TO_FILTER_FC,
+    SOUNDFONT_GEN_END_ADDRS_COARSE_OFFSET,
+    SOUNDFONT_GEN_MOD_LFO_TO_VOLUME,
+    SOUNDFONT_GEN_UNUSED1,
+    SOUNDFONT_GEN_CHORUS_EFFECTS_SEND,
+    SOUNDFONT_GEN_REVERB_EFFECTS_SEND,
+    SOUNDFONT_GEN_PAN,
+    SOUNDFONT_GEN_UNUSED2,
+    SOUNDFONT_GEN_UNUSED3,
+    SOUNDFONT_GEN_UNUSED4,
+    SOUNDFONT_GEN_DELAY_MOD_LFO,
+    SOUNDFONT_GEN_FREQ_MOD_LFO,
+    SOUNDFONT_GEN_DELAY_VIB_LFO,
+    SOUNDFONT_GEN_FREQ_VIB_LFO,
+    SOUNDFONT_GEN_DELAY_MOD_ENV,
+    SOUNDFONT_GEN_ATTACK_MOD_ENV,
+    SOUNDFONT_GEN_HOLD_MOD_ENV,
+    SOUNDFONT_GEN_DECAY_MOD_ENV,
+    SOUNDFONT_GEN_SUSTAIN_MOD_ENV,
+    SOUNDFONT_GEN_RELEASE_MOD_ENV,
+    SOUNDFONT_GEN_KEYNUM_TO_MOD_ENV_HOLD,
+    SOUNDFONT_GEN_KEYNUM_TO_MOD_ENV_DECAY,
+    SOUNDFONT_GEN_DELAY_VOL_ENV,
+    SOUNDFONT_GEN_ATTACK_VOL_ENV,
+    SOUNDFONT_GEN_HOLD_VOL_ENV,
+    SOUNDFONT_GEN_DECAY_VOL_ENV,
+    SOUNDFONT_GEN_SUSTAIN_VOL_ENV,
+    SOUNDFONT_GEN_RELEASE_VOL_ENV,
+    SOUNDFONT_GEN_KEYNUM_TO_VOL_ENV_HOLD,
+    SOUNDFONT_GEN_KEYNUM_TO_VOL_ENV_DECAY,
+    SOUNDFONT_GEN_INSTRUMENT,
+    SOUNDFONT_GEN_RESERVED1,
+    SOUNDFONT_GEN_KEY_RANGE,
+    SOUNDFONT_GEN_VEL_RANGE,
+    SOUNDFONT_GEN_STARTLOOP_ADDRS_COARSE_OFFSET,
+    SOUNDFONT_GEN_KEYNUM,
+    SOUNDFONT_GEN_VELOCITY,
+    SOUNDFONT_GEN_INITIAL_ATTENUATION,
+    SOUNDFONT_GEN_RESERVED2,
+    SOUNDFONT_GEN_ENDLOOP_ADDRS_COARSE_OFFSET,
+    SOUNDFONT_GEN_COARSE_TUNE,
+    SOUNDFONT_GEN_FINE_TUNE,
+    SOUNDFONT_GEN_SAMPLE_ID,
+    SOUNDFONT_GEN_SAMPLE_MODES,
+    SOUNDFONT_GEN_RESERVED3,
+    SOUNDFONT_GEN_SCALE_TUNING,
+    SOUNDFONT_GEN_EXCLUSIVE_CLASS,
+    SOUNDFONT_GEN_OVERRIDING_ROOT_KEY,
+    SOUNDFONT_GEN_UNUSED5,
+    SOUNDFONT_GEN_END_OPER,
+    SOUNDFONT_GEN_COUNT
+} SoundFontGenerator;
+
 typedef struct SoundFontInfo {
     uint32_t size;
     uint16_t major;  // major version of the sound font file
@@ -58,6 +126,11 @@ typedef struct SoundFontInfo {
 typedef struct SoundFontSdtaData {
     uint8_t *data;
     uint32_t size;
+    uint8_t *sm24;  // low byte of every sample point of a 24-bit font, NULL for 16-bit fonts
+    uint32_t sm24Size;
+    float *samples;  // float32 copy of every point from soundfont_convert_sdta, 32-byte aligned, or NULL
+    void *samplesMemory;
+    SoundFontMapping mapping;  // set when data points into a read-only mapping of the file
 } SoundFontSdtaData;
 
 typedef struct SoundFontPresetHeader {
@@ -111,7 +184,24 @@ typedef struct SoundFontSample {
     uint16_t sampleType;
 } SoundFontSample;
 
+#define SOUNDFONT_PERCUSSION_BANK 128
+#define SOUNDFONT_PRESET_EMPTY 0xFFFFFFFF
+
+typedef struct SoundFontPresetSlot {
+    uint32_t key;        // bank << 7 | program, SOUNDFONT_PRESET_EMPTY for a free slot
+    uint16_t presetNdx;  // index into presetHeader
+    uint16_t bagStart;   // first preset zone in presetIndex
+    uint16_t bagEnd;     // one past the last preset zone
+} SoundFontPresetSlot;
+
+typedef struct SoundFontPresetMap {
+    SoundFontPresetSlot *slots;
+    uint32_t mask;  // slot count - 1, the slot count is a power of two
+} SoundFontPresetMap;
+
 typedef struct SoundFontPdtaData {
+    void *arena;       // the single allocation backing all nine tables
+    size_t arenaSize;  // bytes used by the tables inside the arena
     SoundFontPresetHeader *presetHeader;
     uint16_t presetHeaderSize;
     SoundFontPresetIndex *presetIndex;
@@ -130,20 +220,60 @@ typedef struct SoundFontPdtaData {
     uint16_t iGenSize;   // the size of the instrument generator list
     SoundFontSample *shdr;  // the sample header list
     uint16_t shdrSize;   // the size of the sample header list
+    SoundFontPresetMap presetMap;  // (bank, program) lookup built at load time
+    bool verified;  // set by soundfont_verify_pdta, the unchecked accessors below rely on it
 } SoundFontPdtaData;
 
+// where the sample chunks of a font are, found without reading them
+typedef struct SoundFontSdtaLocation {
+    int64_t smplOffset;  // file offset of the smpl payload
+    uint32_t smplSize;
+    int64_t sm24Offset;  // file offset of the sm24 payload, valid when sm24Size is not 0
+    uint32_t sm24Size;
+} SoundFontSdtaLocation;
+
+// the nine pdta sub-chunks in specification order, each a list of fixed size records
+typedef enum SoundFontRecordType {
+    SOUNDFONT_RECORD_PHDR,  // SoundFontPresetHeader
+    SOUNDFONT_RECORD_PBAG,  // SoundFontPresetIndex
+    SOUNDFONT_RECORD_PMOD,  // SoundFontMod
+    SOUNDFONT_RECORD_PGEN,  // SoundFontGen
+    SOUNDFONT_RECORD_INST,  // SoundFontPresetInst
+    SOUNDFONT_RECORD_IBAG,  // SoundFontPresetIbag
+    SOUNDFONT_RECORD_IMOD,  // SoundFontMod
+    SOUNDFONT_RECORD_IGEN,  // SoundFontGen
+    SOUNDFONT_RECORD_SHDR,  // SoundFontSample
+    SOUNDFONT_RECORD_TYPES
+} SoundFontRecordType;
+
+#define SOUNDFONT_PDTA_TASK_BYTES (128 * 1024)  // file bytes of records one parallel pdta decode task reads
+#define SOUNDFONT_PDTA_MAX_THREADS 16
+
 typedef struct SoundFontChunk {
-    char fourcc[5];
-    uint32_t size;
+    char fourcc[5];  // the list type for a LIST chunk
+    uint32_t size;   // of the payload, without the list type for a LIST chunk
+    char list[5];    // type of the enclosing LIST, empty at the top level of the RIFF form
+    int64_t offset;  // file offset of the payload
 } SoundFontChunk;
 
+// every chunk of a file, found by reading the chunk headers only
+typedef struct SoundFontChunkDirectory {
+    SoundFontChunk *chunks;  // in file order, each LIST followed by its sub-chunks
+    uint32_t count;
+    uint32_t capacity;
+} SoundFontChunkDirectory;
+
 bool soundfont_read_fourcc(char *fourcc, FILE *file);
 
 uint32_t soundfont_read_size(FILE *file);
 
 SoundFontChunk soundfont_read_chunk_info(FILE *file);
 
-SoundFontChunk soundfont_read_chunk(FILE *file);
+void soundfont_init_chunks(SoundFontChunkDirectory *directory);
+bool soundfont_scan_chunks(SoundFontChunkDirectory *directory, FILE *file);
+const SoundFontChunk *soundfont_find_chunk(const SoundFontChunkDirectory *directory, const char *list, const char *fourcc);
+uint8_t *soundfont_read_chunk(FILE *file, const SoundFontChunk *chunk);
+void soundfont_release_chunks(SoundFontChunkDirectory *directory);
 
 SoundFontListType soundfont_fetch_list_type(FILE *file, uint32_t *size);
 
@@ -152,12 +282,78 @@ void soundfont_read_info(SoundFontInfo *info, FILE *file);
 void soundfont_release_info(SoundFontInfo *info);
 void soundfont_print_info(SoundFontInfo *info);
 
+void soundfont_init_sdta(SoundFontSdtaData *sdta);
 bool soundfont_read_sdta(SoundFontSdtaData *sdta, FILE *file);
+bool soundfont_map_sdta(SoundFontSdtaData *sdta, FILE *file, SoundFontAdvice advice);
+bool soundfont_locate_sdta(FILE *file, SoundFontSdtaLocation *location);
+bool soundfont_find_sdta(const SoundFontChunkDirectory *directory, SoundFontSdtaLocation *location);
+bool soundfont_map_sdta_at(SoundFontSdtaData *sdta, FILE *file, const SoundFontSdtaLocation *location, SoundFontAdvice advice);
+void soundfont_advise_sdta(SoundFontSdtaData *sdta, SoundFontAdvice advice);
+bool soundfont_convert_sdta(SoundFontSdtaData *sdta, bool merge24);
 void soundfont_release_sdta(SoundFontSdtaData *sdta);
 
 void soundfont_init_pdta(SoundFontPdtaData *pdta);
 bool soundfont_read_pdta(SoundFontPdtaData *pdta, uint32_t size, FILE *file);
+bool soundfont_decode_pdta(SoundFontPdtaData *pdta, const uint8_t *data, uint32_t size);
+bool soundfont_read_pdta_parallel(SoundFontPdtaData *pdta, const SoundFontChunkDirectory *directory, FILE *file, uint32_t threads);
 void soundfont_release_pdta(SoundFontPdtaData *pdta);
+const SoundFontPresetSlot *soundfont_find_preset(const SoundFontPdtaData *pdta, uint16_t bank, uint8_t program);
 void soundfont_print_pdta(SoundFontPdtaData *info);
+bool soundfont_verify_pdta(SoundFontPdtaData *pdta);
+
+uint64_t soundfont_hash(const void *data, size_t size);
+
+SoundFontRecordType soundfont_record_type(const char *fourcc);  // SOUNDFONT_RECORD_TYPES for anything but a pdta sub-chunk
+uint32_t soundfont_record_size(SoundFontRecordType type);        // bytes of one record in the file
+void soundfont_decode_record(SoundFontRecordType type, void *record, const uint8_t *data);
+
+// little-endian fields of the file, whatever the byte order of the host
+static inline uint16_t soundfont_read_u16(const uint8_t *data) {
+    return data[0] | data[1] << 8;
+}
+
+static inline uint32_t soundfont_read_u32(const uint8_t *data) {
+    return (uint32_t)data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+/*
+    Unchecked accessors for a verified pdta. preset, inst, zone and sample count the records
+    before the terminal one of phdr, inst, pbag or ibag and shdr; on a verified pdta every range
+    they return lies inside the table it indexes, so whatever walks a preset down to its samples
+    reads without a single bounds check. On a pdta that was not verified they are undefined.
+*/
+static inline void soundfont_pdta_preset_zones(const SoundFontPdtaData *pdta, uint32_t preset, uint32_t *first, uint32_t *last) {
+    *first = pdta->presetHeader[preset].presetBagNdx;
+    *last = pdta->presetHeader[preset + 1].presetBagNdx;
+}
+
+static inline void soundfont_pdta_preset_gens(const SoundFontPdtaData *pdta, uint32_t zone, uint32_t *first, uint32_t *last) {
+    *first = pdta->presetIndex[zone].genNdx;
+    *last = pdta->presetIndex[zone + 1].genNdx;
+}
+
+static inline void soundfont_pdta_preset_mods(const SoundFontPdtaData *pdta, uint32_t zone, uint32_t *first, uint32_t *last) {
+    *first = pdta->presetIndex[zone].modNdx;
+    *last = pdta->presetIndex[zone + 1].modNdx;
+}
+
+static inline void soundfont_pdta_inst_zones(const SoundFontPdtaData *pdta, uint32_t inst, uint32_t *first, uint32_t *last) {
+    *first = pdta->presetInst[inst].index;
+    *last = pdta->presetInst[inst + 1].index;
+}
+
+static inline void soundfont_pdta_inst_gens(const SoundFontPdtaData *pdta, uint32_t zone, uint32_t *first, uint32_t *last) {
+    *first = pdta->presetIbag[zone].genNdx;
+    *last = pdta->presetIbag[zone + 1].genNdx;
+}
+
+static inline void soundfont_pdta_inst_mods(const SoundFontPdtaData *pdta, uint32_t zone, uint32_t *first, uint32_t *last) {
+    *first = pdta->presetIbag[zone].modNdx;
+    *last = pdta->presetIbag[zone + 1].modNdx;
+}
+
+static inline const SoundFontSample *soundfont_pdta_sample(const SoundFontPdtaData *pdta, uint32_t sample) {
+    return pdta->shdr + sample;
+}
 
 #endif
\ No newline at end of file
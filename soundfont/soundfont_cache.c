@@ -0,0 +1,543 @@
+/*
+    RIFF file process library
+
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#include "soundfont_cache.h"
+
+#include "soundfont_stats.h"
+
+#define CACHE_ALIGN 64
+#define CACHE_BYTE_ORDER 0x01020304
+#define CACHE_INFO_STRINGS 9
+#define CACHE_PATH_MAX 4096
+
+static const char CACHE_MAGIC[8] = {'S', 'F', '2', 'C', 'A', 'C', 'H', 'E'};
+
+typedef struct CacheBlock {
+    uint64_t offset;  // from the start of the cache file, a multiple of CACHE_ALIGN
+    uint64_t size;
+} CacheBlock;
+
+/*
+    Written in the byte order and struct layout of the host; the fields below byteOrder are only
+    trusted once byteOrder and structSizes match.
+*/
+typedef struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t structSizes[8];
+    uint64_t fontSize;
+    int64_t fontTime;
+    uint64_t cacheSize;
+    uint64_t checksum;  // of the header, with this field zero, and every byte after it
+    SoundFontSdtaLocation sdta;
+    uint16_t major;
+    uint16_t minor;
+    uint16_t romMajor;
+    uint16_t romMinor;
+    CacheBlock info;  // the INFO strings back to back, each terminated, empty when absent
+    CacheBlock pdta;
+    CacheBlock regions;
+    CacheBlock zones;
+    CacheBlock mods;
+    uint64_t pdtaTables[10];  // offsets into the pdta block, the nine tables in soundfont2.h order and the preset map
+    uint32_t pdtaCounts[9];
+    uint32_t presetMapMask;
+    uint64_t keyOffsets;  // offsets into the regions block, the regions start it
+    uint64_t keyRegions;
+    uint32_t regionCount;
+    uint32_t keyRegionCount;
+    uint32_t presetCount;
+    uint32_t presetZoneCount;  // the preset zones start the zones block
+    uint64_t instZones;
+    uint32_t instZoneCount;
+    uint32_t programCount;
+    uint64_t programs;  // offsets into the mods block, the curves start it
+    uint64_t ops;
+    uint32_t opCount;
+    uint32_t padding;
+} CacheHeader;
+
+static void cache_path(char *out, const char *fontPath);
+static void layout_sizes(uint32_t *sizes);
+static uint64_t at(const void *base, const void *pointer);
+static void table_end(size_t *end, const void *base, const void *table, size_t bytes);
+static bool write_block(FILE *file, CacheBlock *block, const void *data, size_t size, uint64_t *position);
+static uint64_t cache_checksum(const CacheHeader *header, const uint8_t *body, size_t bodySize);
+static bool fits(const CacheBlock *block, uint64_t offset, uint64_t count, size_t size);
+static bool tables_fit(const CacheHeader *header, const uint8_t *data);
+static bool tables_valid(const SoundFontFont *font);
+static char *copy_string(const char *text);
+
+/*
+    Writes the cache of the font loaded from fontPath. The file is written under a temporary name
+    and renamed into place, so a reader never sees a partial cache.
+*/
+bool soundfont_write_cache(const SoundFontFont *font, const char *fontPath) {
+    const SoundFontPdtaData *pdta = &font->pdta;
+    if (NULL == pdta->presetHeader || NULL == font->regions.regions || NULL == font->zones.presetZones || NULL == font->mods.curves) {
+        printf("The font has no compiled tables to cache.\n");
+        return false;
+    }
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(CacheHeader));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = SOUNDFONT_CACHE_VERSION;
+    header.byteOrder = CACHE_BYTE_ORDER;
+    layout_sizes(header.structSizes);
+
+    FILE *fontFile = fopen(fontPath, "rb");
+    if (NULL == fontFile) {
+        printf("Can't open the sound font %s.\n", fontPath);
+        return false;
+    }
+    header.fontSize = (uint64_t)soundfont_os_file_size(fontFile);
+    header.fontTime = soundfont_os_file_time(fontFile);
+    bool located = soundfont_locate_sdta(fontFile, &header.sdta);
+    fclose(fontFile);
+    if (!located) {
+        printf("No sample data in %s.\n", fontPath);
+        return false;
+    }
+    header.major = font->info.major;
+    header.minor = font->info.minor;
+    header.romMajor = font->info.romMajor;
+    header.romMinor = font->info.romMinor;
+
+    // INFO strings
+    const char *strings[CACHE_INFO_STRINGS] = {font->info.engine, font->info.name, font->info.romName, font->info.createDate, font->info.author,
+                                               font->info.product, font->info.copyright, font->info.comments, font->info.tools};
+    size_t infoSize = 0;
+    for (int i = 0; i < CACHE_INFO_STRINGS; i++) {
+        infoSize += (NULL != strings[i] ? strlen(strings[i]) : 0) + 1;
+    }
+    char *info = (char *)malloc(infoSize);
+    if (NULL == info) {
+        printf("Not enough memory for writing the cache.\n");
+        return false;
+    }
+    char *cursor = info;
+    for (int i = 0; i < CACHE_INFO_STRINGS; i++) {
+        size_t length = NULL != strings[i] ? strlen(strings[i]) : 0;
+        memcpy(cursor, NULL != strings[i] ? strings[i] : "", length + 1);
+        cursor += length + 1;
+    }
+
+    // every table block keeps its in-memory layout, phdr opens the pdta arena
+    const uint8_t *pdtaBase = (const uint8_t *)pdta->presetHeader;
+    const void *pdtaTables[10] = {pdta->presetHeader, pdta->presetIndex, pdta->presetMod, pdta->presetGen, pdta->presetInst,
+                                  pdta->presetIbag, pdta->iMod, pdta->iGen, pdta->shdr, pdta->presetMap.slots};
+    uint32_t pdtaCounts[9] = {pdta->presetHeaderSize, pdta->presetIndexSize, pdta->presetModSize, pdta->presetGenSize, pdta->presetInstSize,
+                              pdta->presetIbagSize, pdta->iModSize, pdta->iGenSize, pdta->shdrSize};
+    for (int i = 0; i < 10; i++) {
+        header.pdtaTables[i] = at(pdtaBase, pdtaTables[i]);
+    }
+    memcpy(header.pdtaCounts, pdtaCounts, sizeof(pdtaCounts));
+    header.presetMapMask = pdta->presetMap.mask;
+
+    const SoundFontRegionIndex *regions = &font->regions;
+    size_t regionsSize = 0;
+    table_end(&regionsSize, regions->regions, regions->regions, sizeof(SoundFontRegion) * regions->regionCount);
+    table_end(&regionsSize, regions->regions, regions->keyOffsets, sizeof(uint32_t) * ((size_t)regions->presetCount * 129 + 1));
+    table_end(&regionsSize, regions->regions, regions->keyRegions, sizeof(uint32_t) * regions->keyRegionCount);
+    header.keyOffsets = at(regions->regions, regions->keyOffsets);
+    header.keyRegions = at(regions->regions, regions->keyRegions);
+    header.regionCount = regions->regionCount;
+    header.keyRegionCount = regions->keyRegionCount;
+    header.presetCount = regions->presetCount;
+
+    const SoundFontZoneTable *zones = &font->zones;
+    size_t zonesSize = 0;
+    table_end(&zonesSize, zones->presetZones, zones->presetZones, sizeof(SoundFontZone) * zones->presetZoneCount);
+    table_end(&zonesSize, zones->presetZones, zones->instZones, sizeof(SoundFontZone) * zones->instZoneCount);
+    header.presetZoneCount = zones->presetZoneCount;
+    header.instZones = at(zones->presetZones, zones->instZones);
+    header.instZoneCount = zones->instZoneCount;
+
+    const SoundFontModTable *mods = &font->mods;
+    size_t modsSize = 0;
+    table_end(&modsSize, mods->curves, mods->curves, sizeof(float) * SOUNDFONT_MOD_CURVES * SOUNDFONT_MOD_CURVE_SIZE);
+    table_end(&modsSize, mods->curves, mods->programs, sizeof(SoundFontModProgram) * mods->programCount);
+    table_end(&modsSize, mods->curves, mods->ops, sizeof(SoundFontModOp) * mods->opCount);
+    header.programs = at(mods->curves, mods->programs);
+    header.ops = at(mods->curves, mods->ops);
+    header.programCount = mods->programCount;
+    header.opCount = mods->opCount;
+
+    char path[CACHE_PATH_MAX];
+    char temporary[CACHE_PATH_MAX + 4];
+    cache_path(path, fontPath);
+    snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+    FILE *file = fopen(temporary, "wb+");
+    if (NULL == file) {
+        printf("Can't create the cache %s.\n", temporary);
+        free(info);
+        return false;
+    }
+    uint64_t position = sizeof(CacheHeader);
+    bool ok = 0 == fseek(file, (long)position, SEEK_SET);
+    ok = ok && write_block(file, &header.info, info, infoSize, &position);
+    ok = ok && write_block(file, &header.pdta, pdtaBase, pdta->arenaSize, &position);
+    ok = ok && write_block(file, &header.regions, regions->regions, regionsSize, &position);
+    ok = ok && write_block(file, &header.zones, zones->presetZones, zonesSize, &position);
+    ok = ok && write_block(file, &header.mods, mods->curves, modsSize, &position);
+    free(info);
+    header.cacheSize = position;
+
+    // the checksum covers the blocks as written, so it is computed from the file
+    if (ok) {
+        SoundFontMapping mapping;
+        ok = 0 == fflush(file) && soundfont_os_map(&mapping, file, 0, (size_t)position);
+        if (ok) {
+            header.checksum = cache_checksum(&header, mapping.data + sizeof(CacheHeader), (size_t)position - sizeof(CacheHeader));
+            soundfont_os_unmap(&mapping);
+        }
+    }
+    ok = ok && 0 == fseek(file, 0, SEEK_SET) && 1 == fwrite(&header, sizeof(CacheHeader), 1, file);
+    ok = 0 == fclose(file) && ok;
+    if (ok) {
+        remove(path);
+        ok = 0 == rename(temporary, path);
+    }
+    if (!ok) {
+        printf("Failed to write the cache %s.\n", path);
+        remove(temporary);
+    }
+
+    return ok;
+}
+
+/*
+    Loads the font behind fontPath from its cache: one mapping of the cache file for every table,
+    one of the font for the sample data. Returns false, leaving the font empty, when there is no
+    usable cache; the caller then loads the font the usual way.
+*/
+bool soundfont_open_cache(SoundFontFont *font, const char *fontPath) {
+    soundfont_init_font(font);
+
+    char path[CACHE_PATH_MAX];
+    cache_path(path, fontPath);
+    FILE *file = fopen(path, "rb");
+    if (NULL == file) {
+        return false;
+    }
+    int64_t cacheSize = soundfont_os_file_size(file);
+    bool ok = cacheSize >= (int64_t)sizeof(CacheHeader) && soundfont_os_map(&font->cache, file, 0, (size_t)cacheSize);
+    fclose(file);
+    if (!ok) {
+        return false;
+    }
+
+    const CacheHeader *header = (const CacheHeader *)font->cache.data;
+    uint32_t sizes[8];
+    layout_sizes(sizes);
+    ok = 0 == memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) && header->version == SOUNDFONT_CACHE_VERSION;
+    ok = ok && header->byteOrder == CACHE_BYTE_ORDER && 0 == memcmp(header->structSizes, sizes, sizeof(sizes));
+    ok = ok && header->cacheSize == (uint64_t)cacheSize;
+    const CacheBlock *blocks[5] = {&header->info, &header->pdta, &header->regions, &header->zones, &header->mods};
+    for (int i = 0; i < 5 && ok; i++) {
+        ok = blocks[i]->offset >= sizeof(CacheHeader) && blocks[i]->offset % CACHE_ALIGN == 0 && blocks[i]->size <= (uint64_t)cacheSize - blocks[i]->offset;
+    }
+    ok = ok && header->checksum == cache_checksum(header, font->cache.data + sizeof(CacheHeader), (size_t)cacheSize - sizeof(CacheHeader));
+    ok = ok && tables_fit(header, font->cache.data);
+
+    FILE *fontFile = ok ? fopen(fontPath, "rb") : NULL;
+    ok = NULL != fontFile;
+    ok = ok && (uint64_t)soundfont_os_file_size(fontFile) == header->fontSize && soundfont_os_file_time(fontFile) == header->fontTime;
+    ok = ok && soundfont_map_sdta_at(&font->sdta, fontFile, &header->sdta, SOUNDFONT_ADVICE_RANDOM);
+    if (NULL != fontFile) {
+        fclose(fontFile);
+    }
+    if (!ok) {
+        soundfont_release_font(font);
+        return false;
+    }
+
+    font->info.major = header->major;
+    font->info.minor = header->minor;
+    font->info.romMajor = header->romMajor;
+    font->info.romMinor = header->romMinor;
+    char **strings[CACHE_INFO_STRINGS] = {&font->info.engine, &font->info.name, &font->info.romName, &font->info.createDate, &font->info.author,
+                                          &font->info.product, &font->info.copyright, &font->info.comments, &font->info.tools};
+    const char *text = (const char *)font->cache.data + header->info.offset;
+    for (int i = 0; i < CACHE_INFO_STRINGS; i++) {
+        *strings[i] = '\0' != *text ? copy_string(text) : NULL;
+        text += strlen(text) + 1;
+    }
+
+    // the tables point into the mapping and own no memory, their release functions leave it alone
+    uint8_t *base = font->cache.data + header->pdta.offset;
+    SoundFontPdtaData *pdta = &font->pdta;
+    pdta->arenaSize = (size_t)header->pdta.size;
+    pdta->presetHeader = (SoundFontPresetHeader *)(base + header->pdtaTables[0]);
+    pdta->presetHeaderSize = (uint16_t)header->pdtaCounts[0];
+    pdta->presetIndex = (SoundFontPresetIndex *)(base + header->pdtaTables[1]);
+    pdta->presetIndexSize = (uint16_t)header->pdtaCounts[1];
+    pdta->presetMod = (SoundFontMod *)(base + header->pdtaTables[2]);
+    pdta->presetModSize = (uint16_t)header->pdtaCounts[2];
+    pdta->presetGen = (SoundFontGen *)(base + header->pdtaTables[3]);
+    pdta->presetGenSize = (uint16_t)header->pdtaCounts[3];
+    pdta->presetInst = (SoundFontPresetInst *)(base + header->pdtaTables[4]);
+    pdta->presetInstSize = (uint16_t)header->pdtaCounts[4];
+    pdta->presetIbag = (SoundFontPresetIbag *)(base + header->pdtaTables[5]);
+    pdta->presetIbagSize = (uint16_t)header->pdtaCounts[5];
+    pdta->iMod = (SoundFontMod *)(base + header->pdtaTables[6]);
+    pdta->iModSize = (uint16_t)header->pdtaCounts[6];
+    pdta->iGen = (SoundFontGen *)(base + header->pdtaTables[7]);
+    pdta->iGenSize = (uint16_t)header->pdtaCounts[7];
+    pdta->shdr = (SoundFontSample *)(base + header->pdtaTables[8]);
+    pdta->shdrSize = (uint16_t)header->pdtaCounts[8];
+    pdta->presetMap.slots = (SoundFontPresetSlot *)(base + header->pdtaTables[9]);
+    pdta->presetMap.mask = header->presetMapMask;
+    // the checksum only proves the file is the one written, not that a correct writer wrote it for this font
+    if (!soundfont_verify_pdta(pdta)) {
+        soundfont_release_font(font);
+        return false;
+    }
+
+    base = font->cache.data + header->regions.offset;
+    font->regions.regions = (SoundFontRegion *)base;
+    font->regions.regionCount = header->regionCount;
+    font->regions.keyOffsets = (uint32_t *)(base + header->keyOffsets);
+    font->regions.keyRegions = (uint32_t *)(base + header->keyRegions);
+    font->regions.keyRegionCount = header->keyRegionCount;
+    font->regions.presetCount = (uint16_t)header->presetCount;
+
+    base = font->cache.data + header->zones.offset;
+    font->zones.presetZones = (SoundFontZone *)base;
+    font->zones.presetZoneCount = (uint16_t)header->presetZoneCount;
+    font->zones.instZones = (SoundFontZone *)(base + header->instZones);
+    font->zones.instZoneCount = (uint16_t)header->instZoneCount;
+
+    base = font->cache.data + header->mods.offset;
+    font->mods.curves = (float (*)[SOUNDFONT_MOD_CURVE_SIZE])base;
+    font->mods.programs = (SoundFontModProgram *)(base + header->programs);
+    font->mods.programCount = header->programCount;
+    font->mods.ops = (SoundFontModOp *)(base + header->ops);
+    font->mods.opCount = header->opCount;
+    if (!tables_valid(font)) {
+        printf("Broken compiled tables in the cache %s.\n", path);
+        soundfont_release_font(font);
+        return false;
+    }
+
+    return true;
+}
+
+bool soundfont_load_font_cached(SoundFontFont *font, const char *path) {
+    if (soundfont_open_cache(font, path)) {
+        SOUNDFONT_STATS_ADD(SOUNDFONT_COUNT_CACHE_HITS, 1);
+        return true;
+    }
+    SOUNDFONT_STATS_ADD(SOUNDFONT_COUNT_CACHE_MISSES, 1);
+    if (!soundfont_load_font(font, path)) {
+        return false;
+    }
+    soundfont_write_cache(font, path);
+
+    return true;
+}
+
+static void cache_path(char *out, const char *fontPath) {
+    snprintf(out, CACHE_PATH_MAX, "%s%s", fontPath, SOUNDFONT_CACHE_SUFFIX);
+}
+
+// changes to any cached struct change its size in practice, and the pointer size covers the ABI
+static void layout_sizes(uint32_t *sizes) {
+    sizes[0] = sizeof(void *);
+    sizes[1] = sizeof(SoundFontPresetHeader);
+    sizes[2] = sizeof(SoundFontSample);
+    sizes[3] = sizeof(SoundFontPresetSlot);
+    sizes[4] = sizeof(SoundFontRegion);
+    sizes[5] = sizeof(SoundFontZone);
+    sizes[6] = sizeof(SoundFontModProgram);
+    sizes[7] = sizeof(SoundFontModOp) << 16 | SOUNDFONT_MOD_CURVE_SIZE;
+}
+
+static uint64_t at(const void *base, const void *pointer) {
+    return (uint64_t)((const uint8_t *)pointer - (const uint8_t *)base);
+}
+
+// grows end to cover a table of bytes inside the block starting at base
+static void table_end(size_t *end, const void *base, const void *table, size_t bytes) {
+    size_t tableEnd = (size_t)at(base, table) + bytes;
+    if (tableEnd > *end) {
+        *end = tableEnd;
+    }
+}
+
+// appends a block at the next aligned position, zero filling the gap
+static bool write_block(FILE *file, CacheBlock *block, const void *data, size_t size, uint64_t *position) {
+    static const uint8_t zeros[CACHE_ALIGN] = {0};
+    size_t gap = (size_t)((CACHE_ALIGN - *position % CACHE_ALIGN) % CACHE_ALIGN);
+    if (gap > 0 && 1 != fwrite(zeros, gap, 1, file)) {
+        return false;
+    }
+    block->offset = *position + gap;
+    block->size = size;
+    *position = block->offset + size;
+
+    return 0 == size || 1 == fwrite(data, size, 1, file);
+}
+
+// the header takes part with its checksum field zero, so a damaged offset or count is caught as well
+static uint64_t cache_checksum(const CacheHeader *header, const uint8_t *body, size_t bodySize) {
+    CacheHeader copy = *header;
+    copy.checksum = 0;
+    uint64_t hashes[2] = {soundfont_hash(&copy, sizeof(CacheHeader)), soundfont_hash(body, bodySize)};
+
+    return soundfont_hash(hashes, sizeof(hashes));
+}
+
+// count records of size bytes from offset lie inside the block
+static bool fits(const CacheBlock *block, uint64_t offset, uint64_t count, size_t size) {
+    return offset <= block->size && count * size <= block->size - offset;
+}
+
+/*
+    Every table the header places must lie inside its block and every INFO string must end inside
+    the info block, before anything is read through them. The blocks themselves are already known
+    to lie inside the file.
+*/
+static bool tables_fit(const CacheHeader *header, const uint8_t *data) {
+    static const size_t PDTA_SIZES[9] = {sizeof(SoundFontPresetHeader), sizeof(SoundFontPresetIndex), sizeof(SoundFontMod), sizeof(SoundFontGen),
+                                         sizeof(SoundFontPresetInst), sizeof(SoundFontPresetIbag), sizeof(SoundFontMod), sizeof(SoundFontGen),
+                                         sizeof(SoundFontSample)};
+    for (int i = 0; i < 9; i++) {
+        if (header->pdtaCounts[i] > UINT16_MAX || !fits(&header->pdta, header->pdtaTables[i], header->pdtaCounts[i], PDTA_SIZES[i])) {
+            return false;
+        }
+    }
+    // the preset map is probed with mask, its slot count has to be a power of two
+    uint64_t slots = (uint64_t)header->presetMapMask + 1;
+    if (0 != (slots & (slots - 1)) || !fits(&header->pdta, header->pdtaTables[9], slots, sizeof(SoundFontPresetSlot))) {
+        return false;
+    }
+
+    bool ok = header->presetCount <= UINT16_MAX && fits(&header->regions, 0, header->regionCount, sizeof(SoundFontRegion));
+    ok = ok && fits(&header->regions, header->keyOffsets, (uint64_t)header->presetCount * 129 + 1, sizeof(uint32_t));
+    ok = ok && fits(&header->regions, header->keyRegions, header->keyRegionCount, sizeof(uint32_t));
+    ok = ok && header->presetZoneCount <= UINT16_MAX && header->instZoneCount <= UINT16_MAX;
+    ok = ok && fits(&header->zones, 0, header->presetZoneCount, sizeof(SoundFontZone));
+    ok = ok && fits(&header->zones, header->instZones, header->instZoneCount, sizeof(SoundFontZone));
+    ok = ok && fits(&header->mods, 0, (uint64_t)SOUNDFONT_MOD_CURVES * SOUNDFONT_MOD_CURVE_SIZE, sizeof(float));
+    ok = ok && fits(&header->mods, header->programs, header->programCount, sizeof(SoundFontModProgram));
+    ok = ok && fits(&header->mods, header->ops, header->opCount, sizeof(SoundFontModOp));
+    if (!ok) {
+        return false;
+    }
+
+    const char *text = (const char *)data + header->info.offset;
+    size_t left = (size_t)header->info.size;
+    for (int i = 0; i < CACHE_INFO_STRINGS; i++) {
+        const char *end = (const char *)memchr(text, '\0', left);
+        if (NULL == end) {
+            return false;
+        }
+        left -= end + 1 - text;
+        text = end + 1;
+    }
+
+    return true;
+}
+
+/*
+    Every index the compiled tables hold, and which the voices follow without checking, names an
+    entry of the table it indexes, as building them from a verified pdta guarantees. The preset
+    map also keeps a free slot, so probing it stops.
+*/
+static bool tables_valid(const SoundFontFont *font) {
+    const SoundFontPdtaData *pdta = &font->pdta;
+    const SoundFontRegionIndex *regions = &font->regions;
+    const SoundFontModTable *mods = &font->mods;
+    if (regions->presetCount != pdta->presetHeaderSize - 1 || font->zones.presetZoneCount != pdta->presetIndexSize ||
+        font->zones.instZoneCount != pdta->presetIbagSize || mods->programCount != regions->regionCount) {
+        return false;
+    }
+
+    bool hasEmpty = false;
+    for (uint32_t i = 0; i <= pdta->presetMap.mask; i++) {
+        const SoundFontPresetSlot *slot = pdta->presetMap.slots + i;
+        if (SOUNDFONT_PRESET_EMPTY == slot->key) {
+            hasEmpty = true;
+        } else if (slot->presetNdx >= regions->presetCount || slot->bagStart > slot->bagEnd || slot->bagEnd >= pdta->presetIndexSize) {
+            return false;
+        }
+    }
+    if (!hasEmpty) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < regions->regionCount; i++) {
+        const SoundFontRegion *region = regions->regions + i;
+        if (region->presetZone + 1 >= pdta->presetIndexSize || region->instZone + 1 >= pdta->presetIbagSize ||
+            (SOUNDFONT_NO_ZONE != region->presetGlobalZone && region->presetGlobalZone + 1 >= pdta->presetIndexSize) ||
+            (SOUNDFONT_NO_ZONE != region->instGlobalZone && region->instGlobalZone + 1 >= pdta->presetIbagSize) ||
+            region->instrument + 1 >= pdta->presetInstSize || region->sample + 1 >= pdta->shdrSize) {
+            return false;
+        }
+    }
+
+    uint32_t previous = 0;
+    for (uint32_t i = 0; i < (uint32_t)regions->presetCount * 129 + 1; i++) {
+        if (regions->keyOffsets[i] < previous || regions->keyOffsets[i] > regions->keyRegionCount) {
+            return false;
+        }
+        previous = regions->keyOffsets[i];
+    }
+    for (uint32_t i = 0; i < regions->keyRegionCount; i++) {
+        if (regions->keyRegions[i] >= regions->regionCount) {
+            return false;
+        }
+    }
+
+    for (uint32_t i = 0; i < mods->programCount; i++) {
+        const SoundFontModProgram *program = mods->programs + i;
+        if (program->count > SOUNDFONT_MOD_MAX_OPS || program->first > mods->opCount || program->count > mods->opCount - program->first) {
+            return false;
+        }
+        // a link feeds another op of the same program, anything else a generator
+        for (uint32_t j = 0; j < program->count; j++) {
+            const SoundFontModOp *op = mods->ops + program->first + j;
+            uint32_t targets = (op->flags & SOUNDFONT_MOD_LINKED) ? program->count : SOUNDFONT_GEN_COUNT;
+            if (op->dest >= targets || op->srcCurve >= SOUNDFONT_MOD_CURVES || op->amtCurve >= SOUNDFONT_MOD_CURVES) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static char *copy_string(const char *text) {
+    size_t size = strlen(text) + 1;
+    char *copy = (char *)malloc(size);
+    if (NULL != copy) {
+        memcpy(copy, text, size);
+    }
+    return copy;
+}
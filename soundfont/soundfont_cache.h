@@ -0,0 +1,53 @@
+/*
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#ifndef CMANLH_SOUNDFONT_CACHE
+#define CMANLH_SOUNDFONT_CACHE
+
+#include "soundfont_synth.h"
+
+#define SOUNDFONT_CACHE_VERSION 2
+#define SOUNDFONT_CACHE_SUFFIX ".cache"  // the cache of font.sf2 is font.sf2.cache
+
+/*
+    The compiled tables of a font saved next to it: the pdta tables with the preset map, the
+    regions, zones and modulator programs, the INFO strings and where the sample chunks are. The
+    tables are stored exactly as they sit in memory, so opening the cache maps it once and points
+    the font's tables into the mapping without decoding a single record.
+
+    A cache is used only if its version, byte order and struct layout match this build, its
+    checksum is intact and the font still has the size and modification time it was built from.
+    Opening it then verifies the pdta as a decoded one is, and checks every index the regions,
+    zones, modulator programs and preset map hold against the table it names.
+*/
+bool soundfont_write_cache(const SoundFontFont *font, const char *fontPath);
+bool soundfont_open_cache(SoundFontFont *font, const char *fontPath);
+
+/*
+    Opens the cache of the font at path, or loads the font and writes its cache for the next time.
+    Failing to write the cache does not fail the load.
+*/
+bool soundfont_load_font_cached(SoundFontFont *font, const char *path);
+
+#endif
@@ -0,0 +1,396 @@
+/*
+    RIFF file process library
+
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#include "soundfont_envelope.h"
+
+#include <math.h>
+
+#include "soundfont_simd.h"
+
+#define ENV_FLOOR_DB 96.0  // the volume envelope's full scale, a release ends this far down
+#define ENV_NO_TARGET (-1.0f)
+#define ENV_UNTIMED INT32_MAX
+
+typedef struct EnvelopeGens {
+    int16_t delay;
+    int16_t attack;
+    int16_t hold;
+    int16_t decay;
+    int16_t sustain;
+    int16_t release;
+    int16_t keynumToHold;
+    int16_t keynumToDecay;
+} EnvelopeGens;
+
+static int16_t clamp_gen(int32_t value, int32_t lo, int32_t hi);
+static int32_t timecents_ticks(int32_t timecents, float tickRate);
+static void enter_stage(SoundFontEnvelopes *envelopes, uint32_t slot, int32_t stage);
+static void *alloc_columns(uint32_t *capacity, size_t columns, size_t slotExtra, uint8_t **first, size_t *column);
+
+/*
+    Converts the seven envelope generators of a zone, with the key scaling of hold and decay, into
+    per-tick coefficients. The two envelopes use the same generator order from their delay on.
+*/
+void soundfont_envelope_segments(SoundFontEnvelopeSegments *segments, const SoundFontZone *zone, uint8_t key, SoundFontEnvelopeKind kind, float tickRate) {
+    const SoundFontGenAmount *gen = zone->gen + (kind == SOUNDFONT_ENV_VOLUME ? SOUNDFONT_GEN_DELAY_VOL_ENV : SOUNDFONT_GEN_DELAY_MOD_ENV);
+    EnvelopeGens g;
+    g.delay = clamp_gen(gen[0].value, -12000, 5000);
+    g.attack = clamp_gen(gen[1].value, -12000, 8000);
+    g.keynumToHold = clamp_gen(gen[6].value, -1200, 1200);
+    g.keynumToDecay = clamp_gen(gen[7].value, -1200, 1200);
+    g.hold = clamp_gen(gen[2].value + g.keynumToHold * (60 - key), -12000, 5000);
+    g.decay = clamp_gen(gen[3].value + g.keynumToDecay * (60 - key), -12000, 8000);
+    g.sustain = clamp_gen(gen[4].value, 0, kind == SOUNDFONT_ENV_VOLUME ? 1440 : 1000);
+    g.release = clamp_gen(gen[5].value, -12000, 8000);
+
+    // delays round down, so the shortest delay does not hold a note back to the next tick
+    segments->delayTicks = (int32_t)(exp2(g.delay / 1200.0) * tickRate);
+    segments->attackTicks = timecents_ticks(g.attack, tickRate);
+    segments->holdTicks = timecents_ticks(g.hold, tickRate);
+    segments->attackAdd = segments->attackTicks > 0 ? 1.0f / segments->attackTicks : 1.0f;
+
+    // decay and release times are for the full scale, whatever level the segment starts from
+    double decayTicks = fmax(1.0, exp2(g.decay / 1200.0) * tickRate);
+    double releaseTicks = fmax(1.0, exp2(g.release / 1200.0) * tickRate);
+    if (kind == SOUNDFONT_ENV_VOLUME) {
+        segments->sustain = (float)pow(10.0, -g.sustain / 200.0);
+        segments->decayMul = (float)pow(10.0, -ENV_FLOOR_DB / 20.0 / decayTicks);
+        segments->decayAdd = 0.0f;
+        segments->releaseMul = (float)pow(10.0, -ENV_FLOOR_DB / 20.0 / releaseTicks);
+        segments->releaseAdd = 0.0f;
+        segments->floor = (float)pow(10.0, -ENV_FLOOR_DB / 20.0);
+    } else {
+        segments->sustain = 1.0f - g.sustain / 1000.0f;
+        segments->decayMul = 1.0f;
+        segments->decayAdd = (float)(-1.0 / decayTicks);
+        segments->releaseMul = 1.0f;
+        segments->releaseAdd = (float)(-1.0 / releaseTicks);
+        segments->floor = 0.0f;
+    }
+}
+
+void soundfont_init_envelopes(SoundFontEnvelopes *envelopes) {
+    memset(envelopes, 0, sizeof(SoundFontEnvelopes));
+}
+
+bool soundfont_create_envelopes(SoundFontEnvelopes *envelopes, uint32_t capacity, float tickRate) {
+    soundfont_init_envelopes(envelopes);
+
+    uint8_t *p;
+    size_t column;
+    envelopes->memory = alloc_columns(&capacity, 7, sizeof(SoundFontEnvelopeSegments), &p, &column);
+    if (NULL == envelopes->memory) {
+        printf("Not enough memory for the envelopes.\n");
+        return false;
+    }
+    envelopes->stage = (int32_t *)p, p += column;
+    envelopes->remaining = (int32_t *)p, p += column;
+    envelopes->level = (float *)p, p += column;
+    envelopes->previous = (float *)p, p += column;
+    envelopes->mul = (float *)p, p += column;
+    envelopes->add = (float *)p, p += column;
+    envelopes->target = (float *)p, p += column;
+    envelopes->segments = (SoundFontEnvelopeSegments *)p;
+    envelopes->capacity = capacity;
+    envelopes->tickRate = tickRate;
+
+    for (uint32_t i = 0; i < capacity; i++) {
+        soundfont_envelope_stop(envelopes, i);
+    }
+
+    return true;
+}
+
+void soundfont_release_envelopes(SoundFontEnvelopes *envelopes) {
+    if (NULL != envelopes->memory) {
+        free(envelopes->memory);
+    }
+    soundfont_init_envelopes(envelopes);
+}
+
+void soundfont_envelope_start(SoundFontEnvelopes *envelopes, uint32_t slot, const SoundFontEnvelopeSegments *segments) {
+    if (slot < envelopes->capacity) {
+        envelopes->segments[slot] = *segments;
+        envelopes->level[slot] = 0.0f;
+        envelopes->previous[slot] = 0.0f;
+        enter_stage(envelopes, slot, SOUNDFONT_ENV_DELAY);
+    }
+}
+
+// the release starts from whatever level the envelope has reached
+void soundfont_envelope_release(SoundFontEnvelopes *envelopes, uint32_t slot) {
+    if (slot < envelopes->capacity && envelopes->stage[slot] < SOUNDFONT_ENV_RELEASE) {
+        enter_stage(envelopes, slot, SOUNDFONT_ENV_RELEASE);
+    }
+}
+
+void soundfont_envelope_stop(SoundFontEnvelopes *envelopes, uint32_t slot) {
+    if (slot < envelopes->capacity) {
+        envelopes->level[slot] = 0.0f;
+        envelopes->previous[slot] = 0.0f;
+        enter_stage(envelopes, slot, SOUNDFONT_ENV_DONE);
+    }
+}
+
+bool soundfont_envelope_done(const SoundFontEnvelopes *envelopes, uint32_t slot) {
+    return slot >= envelopes->capacity || envelopes->stage[slot] == SOUNDFONT_ENV_DONE;
+}
+
+/*
+    Advances every slot by one tick. The segment arithmetic runs on whole vectors; only lanes whose
+    stage ran out this tick go through the scalar stage switch.
+*/
+void soundfont_advance_envelopes(SoundFontEnvelopes *envelopes) {
+    const sf_vi one = sf_vi_set1(1);
+    for (uint32_t slot = 0; slot < envelopes->capacity; slot += SOUNDFONT_SIMD_WIDTH) {
+        sf_vf level = sf_vf_load(envelopes->level + slot);
+        sf_vi remaining = sf_vi_sub(sf_vi_load(envelopes->remaining + slot), one);
+        sf_vf_store(envelopes->previous + slot, level);
+
+        level = sf_vf_add(sf_vf_mul(level, sf_vf_load(envelopes->mul + slot)), sf_vf_load(envelopes->add + slot));
+        sf_vf_store(envelopes->level + slot, level);
+        sf_vi_store(envelopes->remaining + slot, remaining);
+
+        sf_vi due = sf_vi_or(sf_vi_cmpgt(one, remaining), sf_vf_cmpge(sf_vf_load(envelopes->target + slot), level));
+        if (sf_vi_any(due)) {
+            for (uint32_t i = slot; i < slot + SOUNDFONT_SIMD_WIDTH; i++) {
+                if (envelopes->remaining[i] <= 0 || envelopes->level[i] <= envelopes->target[i]) {
+                    int32_t stage = envelopes->stage[i];
+                    // sustain and done only come due when their tick count wraps, they stay put
+                    enter_stage(envelopes, i, stage == SOUNDFONT_ENV_SUSTAIN || stage == SOUNDFONT_ENV_DONE ? stage : stage + 1);
+                }
+            }
+        }
+    }
+}
+
+// one slot by one tick, for a note that starts between two calls of soundfont_advance_envelopes
+void soundfont_envelope_step(SoundFontEnvelopes *envelopes, uint32_t slot) {
+    if (slot >= envelopes->capacity) {
+        return;
+    }
+    envelopes->previous[slot] = envelopes->level[slot];
+    envelopes->level[slot] = envelopes->level[slot] * envelopes->mul[slot] + envelopes->add[slot];
+    envelopes->remaining[slot]--;
+    if (envelopes->remaining[slot] <= 0 || envelopes->level[slot] <= envelopes->target[slot]) {
+        int32_t stage = envelopes->stage[slot];
+        enter_stage(envelopes, slot, stage == SOUNDFONT_ENV_SUSTAIN || stage == SOUNDFONT_ENV_DONE ? stage : stage + 1);
+    }
+}
+
+// per sample values across the last tick, from previous at out[0] towards level
+void soundfont_envelope_ramp(const SoundFontEnvelopes *envelopes, uint32_t slot, float *out, uint32_t frames) {
+    float from = envelopes->previous[slot];
+    float step = (envelopes->level[slot] - from) / (float)frames;
+    for (uint32_t i = 0; i < frames; i++) {
+        out[i] = from + step * (float)i;
+    }
+}
+
+void soundfont_init_lfos(SoundFontLfos *lfos) {
+    memset(lfos, 0, sizeof(SoundFontLfos));
+}
+
+bool soundfont_create_lfos(SoundFontLfos *lfos, uint32_t capacity, float tickRate) {
+    soundfont_init_lfos(lfos);
+
+    uint8_t *p;
+    size_t column;
+    lfos->memory = alloc_columns(&capacity, 5, 0, &p, &column);
+    if (NULL == lfos->memory) {
+        printf("Not enough memory for the LFOs.\n");
+        return false;
+    }
+    lfos->delay = (int32_t *)p, p += column;
+    lfos->phase = (float *)p, p += column;
+    lfos->step = (float *)p, p += column;
+    lfos->value = (float *)p, p += column;
+    lfos->previous = (float *)p;
+    lfos->capacity = capacity;
+    lfos->tickRate = tickRate;
+
+    for (uint32_t i = 0; i < capacity; i++) {
+        soundfont_lfo_stop(lfos, i);
+    }
+
+    return true;
+}
+
+void soundfont_release_lfos(SoundFontLfos *lfos) {
+    if (NULL != lfos->memory) {
+        free(lfos->memory);
+    }
+    soundfont_init_lfos(lfos);
+}
+
+void soundfont_lfo_start(SoundFontLfos *lfos, uint32_t slot, const SoundFontZone *zone, SoundFontLfoKind kind) {
+    if (slot >= lfos->capacity) {
+        return;
+    }
+    const SoundFontGenAmount *gen = zone->gen + (kind == SOUNDFONT_LFO_VIBRATO ? SOUNDFONT_GEN_DELAY_VIB_LFO : SOUNDFONT_GEN_DELAY_MOD_LFO);
+    int16_t delay = clamp_gen(gen[0].value, -12000, 5000);
+    int16_t frequency = clamp_gen(gen[1].value, -16000, 4500);
+
+    // the frequency is in absolute cents, 0 being 8.176 Hz
+    lfos->delay[slot] = timecents_ticks(delay, lfos->tickRate);
+    lfos->step[slot] = (float)(8.176 * exp2(frequency / 1200.0) / lfos->tickRate);
+    lfos->phase[slot] = 0.0f;
+    lfos->value[slot] = 0.0f;
+    lfos->previous[slot] = 0.0f;
+}
+
+void soundfont_lfo_stop(SoundFontLfos *lfos, uint32_t slot) {
+    if (slot < lfos->capacity) {
+        lfos->delay[slot] = ENV_UNTIMED;
+        lfos->phase[slot] = 0.0f;
+        lfos->step[slot] = 0.0f;
+        lfos->value[slot] = 0.0f;
+        lfos->previous[slot] = 0.0f;
+    }
+}
+
+void soundfont_advance_lfos(SoundFontLfos *lfos) {
+    const sf_vi zero = sf_vi_set1(0);
+    const sf_vi one = sf_vi_set1(1);
+    const sf_vf unit = sf_vf_set1(1.0f);
+    for (uint32_t slot = 0; slot < lfos->capacity; slot += SOUNDFONT_SIMD_WIDTH) {
+        sf_vi delay = sf_vi_load(lfos->delay + slot);
+        sf_vi running = sf_vi_cmpgt(one, delay);
+        sf_vi_store(lfos->delay + slot, sf_vi_sub(delay, sf_vi_and(sf_vi_cmpgt(delay, zero), one)));
+        sf_vf_store(lfos->previous + slot, sf_vf_load(lfos->value + slot));
+
+        sf_vf phase = sf_vf_add(sf_vf_load(lfos->phase + slot), sf_vf_and(running, sf_vf_load(lfos->step + slot)));
+        phase = sf_vf_sub(phase, sf_vf_and(sf_vf_cmpge(phase, unit), unit));
+        sf_vf_store(lfos->phase + slot, phase);
+
+        // a quarter cycle ahead, 1 - 4 |q - 1/2| rises from zero at phase zero
+        sf_vf q = sf_vf_add(phase, sf_vf_set1(0.25f));
+        q = sf_vf_sub(q, sf_vf_and(sf_vf_cmpge(q, unit), unit));
+        sf_vf triangle = sf_vf_sub(unit, sf_vf_mul(sf_vf_set1(4.0f), sf_vf_abs(sf_vf_sub(q, sf_vf_set1(0.5f)))));
+        sf_vf_store(lfos->value + slot, sf_vf_and(running, triangle));
+    }
+}
+
+void soundfont_lfo_ramp(const SoundFontLfos *lfos, uint32_t slot, float *out, uint32_t frames) {
+    float from = lfos->previous[slot];
+    float step = (lfos->value[slot] - from) / (float)frames;
+    for (uint32_t i = 0; i < frames; i++) {
+        out[i] = from + step * (float)i;
+    }
+}
+
+static int16_t clamp_gen(int32_t value, int32_t lo, int32_t hi) {
+    return (int16_t)(value < lo ? lo : (value > hi ? hi : value));
+}
+
+static int32_t timecents_ticks(int32_t timecents, float tickRate) {
+    return (int32_t)lrint(exp2(timecents / 1200.0) * tickRate);
+}
+
+/*
+    Moves a slot into stage, skipping stages that take no time, and loads the segment the vector
+    loop runs until the stage's tick count or target level is reached.
+*/
+static void enter_stage(SoundFontEnvelopes *envelopes, uint32_t slot, int32_t stage) {
+    const SoundFontEnvelopeSegments *s = envelopes->segments + slot;
+    float *level = envelopes->level + slot;
+    float mul, add, target;
+    int32_t remaining;
+
+    for (bool entered = false; !entered;) {
+        entered = true;
+        mul = 1.0f;
+        add = 0.0f;
+        target = ENV_NO_TARGET;
+        remaining = ENV_UNTIMED;
+        switch (stage) {
+            case SOUNDFONT_ENV_DELAY:
+                *level = 0.0f;
+                remaining = s->delayTicks;
+                break;
+            case SOUNDFONT_ENV_ATTACK:
+                add = s->attackAdd;
+                remaining = s->attackTicks;
+                break;
+            case SOUNDFONT_ENV_HOLD:
+                *level = 1.0f;
+                remaining = s->holdTicks;
+                break;
+            case SOUNDFONT_ENV_DECAY:
+                if (*level > s->sustain) {
+                    mul = s->decayMul;
+                    add = s->decayAdd;
+                    target = s->sustain;
+                } else {
+                    stage = SOUNDFONT_ENV_SUSTAIN;
+                    entered = false;
+                }
+                break;
+            case SOUNDFONT_ENV_SUSTAIN:
+                *level = s->sustain;
+                break;
+            case SOUNDFONT_ENV_RELEASE:
+                if (*level > s->floor) {
+                    mul = s->releaseMul;
+                    add = s->releaseAdd;
+                    target = s->floor;
+                } else {
+                    stage = SOUNDFONT_ENV_DONE;
+                    entered = false;
+                }
+                break;
+            default:
+                stage = SOUNDFONT_ENV_DONE;
+                *level = 0.0f;
+                break;
+        }
+        if (entered && remaining <= 0) {
+            stage++;
+            entered = false;
+        }
+    }
+
+    envelopes->stage[slot] = stage;
+    envelopes->mul[slot] = mul;
+    envelopes->add[slot] = add;
+    envelopes->target[slot] = target;
+    envelopes->remaining[slot] = remaining;
+}
+
+/*
+    One allocation of columns arrays of capacity 32-bit values, each starting on a vector
+    boundary, followed by slotExtra bytes per slot. capacity is rounded up to whole vectors.
+*/
+static void *alloc_columns(uint32_t *capacity, size_t columns, size_t slotExtra, uint8_t **first, size_t *column) {
+    *capacity = (*capacity + SOUNDFONT_SIMD_WIDTH - 1) / SOUNDFONT_SIMD_WIDTH * SOUNDFONT_SIMD_WIDTH;
+    *column = (sizeof(float) * *capacity + SOUNDFONT_SIMD_ALIGN - 1) & ~(size_t)(SOUNDFONT_SIMD_ALIGN - 1);
+
+    void *memory = malloc(*column * columns + slotExtra * *capacity + SOUNDFONT_SIMD_ALIGN);
+    if (NULL != memory) {
+        *first = (uint8_t *)(((uintptr_t)memory + SOUNDFONT_SIMD_ALIGN - 1) & ~(uintptr_t)(SOUNDFONT_SIMD_ALIGN - 1));
+    }
+    return memory;
+}
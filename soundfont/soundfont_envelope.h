@@ -0,0 +1,120 @@
+/*
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#ifndef CMANLH_SOUNDFONT_ENVELOPE
+#define CMANLH_SOUNDFONT_ENVELOPE
+
+#include "soundfont_zone.h"
+
+typedef enum SoundFontEnvelopeKind {
+    SOUNDFONT_ENV_VOLUME,     // attack linear in amplitude, decay and release linear in dB
+    SOUNDFONT_ENV_MODULATION  // every segment linear
+} SoundFontEnvelopeKind;
+
+typedef enum SoundFontEnvelopeStage {
+    SOUNDFONT_ENV_DELAY,
+    SOUNDFONT_ENV_ATTACK,
+    SOUNDFONT_ENV_HOLD,
+    SOUNDFONT_ENV_DECAY,
+    SOUNDFONT_ENV_SUSTAIN,
+    SOUNDFONT_ENV_RELEASE,
+    SOUNDFONT_ENV_DONE
+} SoundFontEnvelopeStage;
+
+typedef enum SoundFontLfoKind {
+    SOUNDFONT_LFO_MODULATION,
+    SOUNDFONT_LFO_VIBRATO
+} SoundFontLfoKind;
+
+/*
+    One envelope converted from generator units, times in control ticks. Every segment is
+    level = level * mul + add per tick, so the coefficients are computed once per note.
+*/
+typedef struct SoundFontEnvelopeSegments {
+    int32_t delayTicks;
+    int32_t attackTicks;
+    int32_t holdTicks;
+    float attackAdd;
+    float decayMul;
+    float decayAdd;
+    float sustain;  // level the decay stops at
+    float releaseMul;
+    float releaseAdd;
+    float floor;  // level at which the release ends
+} SoundFontEnvelopeSegments;
+
+/*
+    Envelopes of many voices advanced together at control rate, one tick per call of
+    soundfont_advance_envelopes. Slots are addressed like the mixer's handles; idle slots stay at
+    zero. previous and level hold the values before and after the last tick, for interpolating
+    across the samples of a tick.
+*/
+typedef struct SoundFontEnvelopes {
+    void *memory;
+    uint32_t capacity;
+    float tickRate;  // ticks per second
+    int32_t *stage;
+    int32_t *remaining;  // ticks left in a timed stage
+    float *level;
+    float *previous;
+    float *mul;
+    float *add;
+    float *target;  // a falling stage ends at or below this level
+    SoundFontEnvelopeSegments *segments;
+} SoundFontEnvelopes;
+
+// triangle oscillators in [-1, 1] starting at zero and rising, silent for their delay
+typedef struct SoundFontLfos {
+    void *memory;
+    uint32_t capacity;
+    float tickRate;
+    int32_t *delay;  // ticks left before the oscillator starts
+    float *phase;    // [0, 1) cycles
+    float *step;     // cycles per tick
+    float *value;
+    float *previous;
+} SoundFontLfos;
+
+void soundfont_envelope_segments(SoundFontEnvelopeSegments *segments, const SoundFontZone *zone, uint8_t key, SoundFontEnvelopeKind kind, float tickRate);
+
+void soundfont_init_envelopes(SoundFontEnvelopes *envelopes);
+bool soundfont_create_envelopes(SoundFontEnvelopes *envelopes, uint32_t capacity, float tickRate);
+void soundfont_release_envelopes(SoundFontEnvelopes *envelopes);
+void soundfont_envelope_start(SoundFontEnvelopes *envelopes, uint32_t slot, const SoundFontEnvelopeSegments *segments);
+void soundfont_envelope_release(SoundFontEnvelopes *envelopes, uint32_t slot);
+void soundfont_envelope_stop(SoundFontEnvelopes *envelopes, uint32_t slot);
+bool soundfont_envelope_done(const SoundFontEnvelopes *envelopes, uint32_t slot);
+void soundfont_advance_envelopes(SoundFontEnvelopes *envelopes);
+void soundfont_envelope_step(SoundFontEnvelopes *envelopes, uint32_t slot);
+void soundfont_envelope_ramp(const SoundFontEnvelopes *envelopes, uint32_t slot, float *out, uint32_t frames);
+
+void soundfont_init_lfos(SoundFontLfos *lfos);
+bool soundfont_create_lfos(SoundFontLfos *lfos, uint32_t capacity, float tickRate);
+void soundfont_release_lfos(SoundFontLfos *lfos);
+void soundfont_lfo_start(SoundFontLfos *lfos, uint32_t slot, const SoundFontZone *zone, SoundFontLfoKind kind);
+void soundfont_lfo_stop(SoundFontLfos *lfos, uint32_t slot);
+void soundfont_advance_lfos(SoundFontLfos *lfos);
+void soundfont_lfo_ramp(const SoundFontLfos *lfos, uint32_t slot, float *out, uint32_t frames);
+
+#endif
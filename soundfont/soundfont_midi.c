@@ -0,0 +1,313 @@
+/*
+    RIFF file process library
+
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#include "soundfont_midi.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MIDI_DEFAULT_TEMPO 500000  // microseconds per quarter note, 120 bpm
+
+typedef enum RawKind {
+    RAW_CHANNEL,
+    RAW_TEMPO,
+    RAW_END
+} RawKind;
+
+// an event before the tempo map is applied; seq keeps the file order of events at the same tick
+typedef struct RawEvent {
+    uint64_t tick;
+    uint32_t seq;
+    uint32_t tempo;
+    uint8_t kind;
+    uint8_t status;
+    uint8_t data1;
+    uint8_t data2;
+} RawEvent;
+
+typedef struct RawList {
+    RawEvent *items;
+    uint32_t count;
+    uint32_t capacity;
+} RawList;
+
+static uint32_t read_be(const uint8_t *data, int bytes);
+static bool read_vlq(const uint8_t **cursor, const uint8_t *end, uint32_t *value);
+static bool push_raw(RawList *list, const RawEvent *event);
+static bool parse_track(RawList *list, const uint8_t *data, const uint8_t *end);
+static int compare_raw(const void *a, const void *b);
+
+void soundfont_init_midi(SoundFontMidiFile *midi) {
+    midi->events = NULL;
+    midi->eventCount = 0;
+    midi->format = 0;
+    midi->trackCount = 0;
+    midi->division = 0;
+    midi->duration = 0.0;
+}
+
+bool soundfont_read_midi(SoundFontMidiFile *midi, const char *path) {
+    soundfont_init_midi(midi);
+
+    FILE *file = fopen(path, "rb");
+    if (NULL == file) {
+        printf("Can't open the MIDI file %s.\n", path);
+        return false;
+    }
+    int64_t size = soundfont_os_file_size(file);
+    uint8_t *data = size > 0 ? (uint8_t *)malloc((size_t)size) : NULL;
+    if (NULL == data) {
+        printf("Can't read the MIDI file %s.\n", path);
+        fclose(file);
+        return false;
+    }
+    size_t bytesRead = fread(data, 1, (size_t)size, file);
+    fclose(file);
+
+    bool ok = bytesRead == (size_t)size && soundfont_parse_midi(midi, data, (size_t)size);
+    free(data);
+
+    return ok;
+}
+
+/*
+    Parses a format 0, 1 or 2 file held in memory. Format 2 tracks are independent songs; they are
+    merged like format 1 tracks, which is what a single pass renderer can do with them.
+*/
+bool soundfont_parse_midi(SoundFontMidiFile *midi, const uint8_t *data, size_t size) {
+    soundfont_init_midi(midi);
+
+    if (size < 14 || 0 != memcmp(data, "MThd", 4) || read_be(data + 4, 4) < 6) {
+        printf("Not a Standard MIDI File.\n");
+        return false;
+    }
+    uint32_t headerSize = read_be(data + 4, 4);
+    midi->format = (uint16_t)read_be(data + 8, 2);
+    midi->trackCount = (uint16_t)read_be(data + 10, 2);
+    midi->division = (int16_t)read_be(data + 12, 2);
+    if (0 == midi->division) {
+        printf("Invalid MIDI time division.\n");
+        return false;
+    }
+
+    RawList list = {NULL, 0, 0};
+    const uint8_t *cursor = data + 8 + headerSize;
+    const uint8_t *end = data + size;
+    uint16_t tracks = 0;
+    while (cursor + 8 <= end && tracks < midi->trackCount) {
+        uint32_t chunkSize = read_be(cursor + 4, 4);
+        const uint8_t *chunk = cursor + 8;
+        const uint8_t *chunkEnd = (size_t)(end - chunk) < chunkSize ? end : chunk + chunkSize;
+        if (0 == memcmp(cursor, "MTrk", 4)) {
+            if (!parse_track(&list, chunk, chunkEnd)) {
+                free(list.items);
+                printf("Not enough memory for the MIDI events.\n");
+                return false;
+            }
+            tracks++;
+        }
+        cursor = chunkEnd;
+    }
+
+    qsort(list.items, list.count, sizeof(RawEvent), compare_raw);
+
+    uint32_t channelEvents = 0;
+    for (uint32_t i = 0; i < list.count; i++) {
+        channelEvents += list.items[i].kind == RAW_CHANNEL;
+    }
+    midi->events = (SoundFontMidiEvent *)malloc(sizeof(SoundFontMidiEvent) * (channelEvents > 0 ? channelEvents : 1));
+    if (NULL == midi->events) {
+        free(list.items);
+        printf("Not enough memory for the MIDI events.\n");
+        return false;
+    }
+
+    // SMPTE divisions count ticks per frame at a fixed frame rate and ignore the tempo
+    double smpteTick = midi->division < 0 ? 1.0 / ((double)-(int8_t)(midi->division >> 8) * (midi->division & 0xFF)) : 0.0;
+    uint32_t tempo = MIDI_DEFAULT_TEMPO;
+    uint64_t lastTick = 0;
+    double time = 0.0;
+    for (uint32_t i = 0; i < list.count; i++) {
+        const RawEvent *raw = list.items + i;
+        double tickSeconds = midi->division < 0 ? smpteTick : tempo * 1e-6 / midi->division;
+        time += (double)(raw->tick - lastTick) * tickSeconds;
+        lastTick = raw->tick;
+
+        if (raw->kind == RAW_TEMPO) {
+            tempo = raw->tempo > 0 ? raw->tempo : MIDI_DEFAULT_TEMPO;
+        } else if (raw->kind == RAW_CHANNEL) {
+            SoundFontMidiEvent *event = midi->events + midi->eventCount++;
+            event->time = time;
+            event->status = raw->status;
+            event->data1 = raw->data1;
+            event->data2 = raw->data2;
+        }
+        midi->duration = time;
+    }
+    free(list.items);
+
+    return true;
+}
+
+void soundfont_release_midi(SoundFontMidiFile *midi) {
+    if (NULL != midi->events) {
+        free(midi->events);
+    }
+    soundfont_init_midi(midi);
+}
+
+static uint32_t read_be(const uint8_t *data, int bytes) {
+    uint32_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value = value << 8 | data[i];
+    }
+    return value;
+}
+
+// variable length quantity, at most four bytes
+static bool read_vlq(const uint8_t **cursor, const uint8_t *end, uint32_t *value) {
+    *value = 0;
+    for (int i = 0; i < 4; i++) {
+        if (*cursor >= end) {
+            return false;
+        }
+        uint8_t byte = *(*cursor)++;
+        *value = *value << 7 | (byte & 0x7F);
+        if (0 == (byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool push_raw(RawList *list, const RawEvent *event) {
+    if (list->count == list->capacity) {
+        uint32_t capacity = list->capacity > 0 ? list->capacity * 2 : 1024;
+        RawEvent *items = (RawEvent *)realloc(list->items, sizeof(RawEvent) * capacity);
+        if (NULL == items) {
+            return false;
+        }
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count] = *event;
+    list->items[list->count].seq = list->count;
+    list->count++;
+
+    return true;
+}
+
+/*
+    Collects the channel, tempo and end of track events of one track. A truncated or malformed
+    track keeps the events read so far; only running out of memory fails.
+*/
+static bool parse_track(RawList *list, const uint8_t *data, const uint8_t *end) {
+    RawEvent event;
+    uint64_t tick = 0;
+    uint8_t running = 0;
+    const uint8_t *cursor = data;
+
+    memset(&event, 0, sizeof(RawEvent));
+    while (cursor < end) {
+        uint32_t delta;
+        if (!read_vlq(&cursor, end, &delta) || cursor >= end) {
+            break;
+        }
+        tick += delta;
+        event.tick = tick;
+
+        uint8_t status = *cursor;
+        if (status & 0x80) {
+            cursor++;
+        } else if (0 != running) {
+            status = running;  // running status, the byte read is already data
+        } else {
+            break;
+        }
+
+        if (status < 0xF0) {
+            running = status;
+            uint8_t type = status & 0xF0;
+            int length = (type == SOUNDFONT_MIDI_PROGRAM_CHANGE || type == SOUNDFONT_MIDI_CHANNEL_PRESSURE) ? 1 : 2;
+            if (end - cursor < length) {
+                break;
+            }
+            event.kind = RAW_CHANNEL;
+            event.status = status;
+            event.data1 = cursor[0] & 0x7F;
+            event.data2 = length > 1 ? cursor[1] & 0x7F : 0;
+            cursor += length;
+            // a note-on with velocity zero is a note-off
+            if (type == SOUNDFONT_MIDI_NOTE_ON && 0 == event.data2) {
+                event.status = SOUNDFONT_MIDI_NOTE_OFF | (status & 0x0F);
+            }
+            if (!push_raw(list, &event)) {
+                return false;
+            }
+        } else if (status == 0xFF) {
+            if (cursor >= end) {
+                break;
+            }
+            uint8_t type = *cursor++;
+            uint32_t length;
+            if (!read_vlq(&cursor, end, &length) || (uint32_t)(end - cursor) < length) {
+                break;
+            }
+            if (type == 0x51 && length == 3) {
+                event.kind = RAW_TEMPO;
+                event.tempo = read_be(cursor, 3);
+                if (!push_raw(list, &event)) {
+                    return false;
+                }
+            }
+            cursor += length;
+            if (type == 0x2F) {
+                break;
+            }
+        } else if (status == 0xF0 || status == 0xF7) {
+            uint32_t length;
+            if (!read_vlq(&cursor, end, &length) || (uint32_t)(end - cursor) < length) {
+                break;
+            }
+            cursor += length;
+        } else {
+            break;  // system common and real time messages have no place in a file
+        }
+    }
+
+    event.kind = RAW_END;
+    event.tick = tick;
+    return push_raw(list, &event);
+}
+
+static int compare_raw(const void *a, const void *b) {
+    const RawEvent *x = (const RawEvent *)a;
+    const RawEvent *y = (const RawEvent *)b;
+    if (x->tick != y->tick) {
+        return x->tick < y->tick ? -1 : 1;
+    }
+    return x->seq < y->seq ? -1 : (x->seq > y->seq ? 1 : 0);
+}
@@ -0,0 +1,66 @@
+/*
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#ifndef CMANLH_SOUNDFONT_MIDI
+#define CMANLH_SOUNDFONT_MIDI
+
+#include "soundfont_os.h"
+
+// channel voice messages, the high nibble of a status byte
+typedef enum SoundFontMidiStatus {
+    SOUNDFONT_MIDI_NOTE_OFF = 0x80,
+    SOUNDFONT_MIDI_NOTE_ON = 0x90,
+    SOUNDFONT_MIDI_POLY_PRESSURE = 0xA0,
+    SOUNDFONT_MIDI_CONTROL_CHANGE = 0xB0,
+    SOUNDFONT_MIDI_PROGRAM_CHANGE = 0xC0,
+    SOUNDFONT_MIDI_CHANNEL_PRESSURE = 0xD0,
+    SOUNDFONT_MIDI_PITCH_BEND = 0xE0
+} SoundFontMidiStatus;
+
+typedef struct SoundFontMidiEvent {
+    double time;  // seconds from the start of the file, after the tempo map
+    uint8_t status;
+    uint8_t data1;
+    uint8_t data2;
+} SoundFontMidiEvent;
+
+/*
+    The channel events of every track of a Standard MIDI File, merged into one list in time order.
+    Meta and system exclusive events are consumed while parsing; tempo changes only move times.
+*/
+typedef struct SoundFontMidiFile {
+    SoundFontMidiEvent *events;
+    uint32_t eventCount;
+    uint16_t format;
+    uint16_t trackCount;
+    int16_t division;  // ticks per quarter note, or negative SMPTE frames per second in the high byte
+    double duration;   // time of the last event, end of track markers included
+} SoundFontMidiFile;
+
+void soundfont_init_midi(SoundFontMidiFile *midi);
+bool soundfont_read_midi(SoundFontMidiFile *midi, const char *path);
+bool soundfont_parse_midi(SoundFontMidiFile *midi, const uint8_t *data, size_t size);
+void soundfont_release_midi(SoundFontMidiFile *midi);
+
+#endif
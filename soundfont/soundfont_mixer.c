@@ -0,0 +1,701 @@
+/*
+    RIFF file process library
+
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#include "soundfont_mixer.h"
+
+#include <math.h>
+
+#include "soundfont_simd.h"
+
+#define SAMPLE_SCALE (1.0f / 32768.0f)
+
+// idle slots read these points with a zero step, so a partly used vector needs no lane mask
+static const int16_t SILENCE[4] = {0, 0, 0, 0};
+static const float SILENCE_FLOAT[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+static uint32_t taps_before(const SoundFontMixer *mixer);
+static uint32_t taps_after(const SoundFontMixer *mixer);
+static void clear_slot(SoundFontMixer *mixer, uint32_t slot);
+static void move_slot(SoundFontMixer *mixer, uint32_t from, uint32_t to);
+static void gather_pair(const void *const *src, sf_vi idx, int32_t offset, sf_vf *first, sf_vf *second);
+static void gather_float_pair(const void *const *src, sf_vi idx, int32_t offset, sf_vf *first, sf_vf *second);
+static uint32_t choose_tiers(const SoundFontMixer *mixer, uint32_t slot, bool *sinc);
+static float sinc_dot(const SoundFontSincTable *table, const int16_t *x, float frac);
+static float sinc_dot_float(const SoundFontSincTable *table, const float *x, float frac);
+static void render_group(SoundFontMixer *mixer, uint32_t slot, uint32_t frames);
+
+void soundfont_init_mixer(SoundFontMixer *mixer) {
+    memset(mixer, 0, sizeof(SoundFontMixer));
+}
+
+bool soundfont_create_mixer(SoundFontMixer *mixer, uint32_t capacity, uint32_t blockSize, SoundFontInterp interp, SoundFontSampleFormat format) {
+    soundfont_init_mixer(mixer);
+    if (0 == capacity || 0 == blockSize) {
+        printf("Mixer capacity and block size must not be zero.\n");
+        return false;
+    }
+
+    capacity = (capacity + SOUNDFONT_SIMD_WIDTH - 1) / SOUNDFONT_SIMD_WIDTH * SOUNDFONT_SIMD_WIDTH;
+    blockSize = (blockSize + SOUNDFONT_SIMD_WIDTH - 1) / SOUNDFONT_SIMD_WIDTH * SOUNDFONT_SIMD_WIDTH;
+
+    // every array starts on a vector boundary and gets room for capacity pointers, the widest element
+    size_t lane = ((size_t)capacity * sizeof(void *) + SOUNDFONT_SIMD_ALIGN - 1) & ~(size_t)(SOUNDFONT_SIMD_ALIGN - 1);
+    size_t bus = ((size_t)blockSize * sizeof(float) + SOUNDFONT_SIMD_ALIGN - 1) & ~(size_t)(SOUNDFONT_SIMD_ALIGN - 1);
+    size_t total = lane * 22 + bus * 2 * (1 + SOUNDFONT_SIMD_WIDTH);
+
+    mixer->memory = malloc(total + SOUNDFONT_SIMD_ALIGN);
+    if (NULL == mixer->memory) {
+        printf("Not enough memory for the mixer.\n");
+        return false;
+    }
+    uint8_t *p = (uint8_t *)(((uintptr_t)mixer->memory + SOUNDFONT_SIMD_ALIGN - 1) & ~(uintptr_t)(SOUNDFONT_SIMD_ALIGN - 1));
+    mixer->src = (const void **)p, p += lane;
+    mixer->index = (int32_t *)p, p += lane;
+    mixer->frac = (float *)p, p += lane;
+    mixer->stepInt = (int32_t *)p, p += lane;
+    mixer->stepFrac = (float *)p, p += lane;
+    mixer->end = (int32_t *)p, p += lane;
+    mixer->loopEnd = (int32_t *)p, p += lane;
+    mixer->loopLength = (int32_t *)p, p += lane;
+    mixer->loopShift = (int32_t *)p, p += lane;
+    mixer->loopNext = (int32_t *)p, p += lane;
+    mixer->copyOffset = (int32_t *)p, p += lane;
+    mixer->looping = (int32_t *)p, p += lane;
+    mixer->gainLeft = (float *)p, p += lane;
+    mixer->gainRight = (float *)p, p += lane;
+    mixer->targetLeft = (float *)p, p += lane;
+    mixer->targetRight = (float *)p, p += lane;
+    mixer->filterCoef = (float *)p, p += lane;
+    mixer->filterState = (float *)p, p += lane;
+    mixer->loopMode = (uint8_t *)p, p += lane;
+    mixer->handleOf = (uint32_t *)p, p += lane;
+    mixer->slotOf = (uint32_t *)p, p += lane;
+    mixer->busLeft = (float *)p, p += bus;
+    mixer->busRight = (float *)p, p += bus;
+    mixer->laneLeft = (float *)p, p += bus * SOUNDFONT_SIMD_WIDTH;
+    mixer->laneRight = (float *)p, p += bus * SOUNDFONT_SIMD_WIDTH;
+    mixer->sincOut = (float *)p;
+
+    mixer->capacity = capacity;
+    mixer->blockSize = blockSize;
+    mixer->interp = SOUNDFONT_INTERP_CUBIC;
+    mixer->format = format;
+    mixer->sincQuiet = SOUNDFONT_MIXER_SINC_QUIET;
+    if (interp != SOUNDFONT_INTERP_CUBIC && !soundfont_mixer_set_interp(mixer, interp, SOUNDFONT_SINC_TAPS, SOUNDFONT_SINC_PHASES)) {
+        soundfont_release_mixer(mixer);
+        return false;
+    }
+    for (uint32_t i = 0; i < capacity; i++) {
+        clear_slot(mixer, i);
+        mixer->slotOf[i] = SOUNDFONT_MIXER_NONE;
+    }
+    memset(mixer->busLeft, 0, bus * 2);
+
+    return true;
+}
+
+void soundfont_release_mixer(SoundFontMixer *mixer) {
+    if (NULL != mixer->memory) {
+        free(mixer->memory);
+    }
+    soundfont_release_sinc(&mixer->sinc);
+    soundfont_init_mixer(mixer);
+}
+
+/*
+    Switches the interpolation of an idle mixer; taps and phases size the filter of
+    SOUNDFONT_INTERP_SINC and are ignored otherwise. Fails while voices play, their end positions
+    were bounded by the reach of the old interpolator.
+*/
+bool soundfont_mixer_set_interp(SoundFontMixer *mixer, SoundFontInterp interp, uint32_t taps, uint32_t phases) {
+    if (mixer->count > 0) {
+        printf("The interpolation of a mixer only changes while no voice plays.\n");
+        return false;
+    }
+    soundfont_release_sinc(&mixer->sinc);
+    if (interp == SOUNDFONT_INTERP_SINC && !soundfont_create_sinc(&mixer->sinc, taps, phases)) {
+        mixer->interp = SOUNDFONT_INTERP_CUBIC;
+        return false;
+    }
+    mixer->interp = interp;
+
+    return true;
+}
+
+/*
+    Copies the playback state of a prepared voice into a free slot and returns its handle. The
+    voice's current position, increment, loop points and gains are taken as they are.
+*/
+uint32_t soundfont_mixer_add(SoundFontMixer *mixer, const SoundFontVoice *voice) {
+    if (mixer->count >= mixer->capacity || voice->finished) {
+        return SOUNDFONT_MIXER_NONE;
+    }
+
+    // taps past end stay inside the view: x[end + taps_after] is the furthest a clamped read reaches
+    uint32_t tapsBefore = taps_before(mixer);
+    uint32_t tapsAfter = taps_after(mixer);
+    uint32_t end = voice->end;
+    const void *src = mixer->format == SOUNDFONT_SAMPLE_FLOAT ? (const void *)voice->view.samples : (const void *)voice->view.data;
+    if (NULL == src || voice->view.frames <= tapsAfter) {
+        return SOUNDFONT_MIXER_NONE;
+    }
+    if (end > voice->view.frames - 1 - tapsAfter) {
+        end = voice->view.frames - 1 - tapsAfter;
+    }
+    uint32_t index = (uint32_t)(voice->phase >> 32);
+    if (index < tapsBefore) {
+        index = tapsBefore;
+    }
+    if (index >= end || end > INT32_MAX) {
+        return SOUNDFONT_MIXER_NONE;
+    }
+
+    uint32_t handle = 0;
+    while (mixer->slotOf[handle] != SOUNDFONT_MIXER_NONE) {
+        handle++;
+    }
+    uint32_t slot = mixer->count++;
+    mixer->slotOf[handle] = slot;
+    mixer->handleOf[slot] = handle;
+
+    bool loops = voice->loopMode == SOUNDFONT_LOOP_CONTINUOUS || (voice->loopMode == SOUNDFONT_LOOP_SUSTAIN && !voice->released);
+    mixer->src[slot] = src;
+    mixer->index[slot] = (int32_t)index;
+    mixer->frac[slot] = (float)((uint32_t)voice->phase >> 8) * (1.0f / 16777216.0f);
+    mixer->end[slot] = (int32_t)end;
+    mixer->loopEnd[slot] = (int32_t)voice->loopEnd;
+    mixer->loopLength[slot] = (int32_t)(voice->loopEnd - voice->loopStart);
+    mixer->loopShift[slot] = mixer->loopLength[slot];
+    mixer->loopNext[slot] = mixer->loopEnd[slot];
+    mixer->copyOffset[slot] = 0;
+    mixer->looping[slot] = loops && voice->loopEnd <= end && voice->loopStart >= tapsBefore ? -1 : 0;
+    // a voice that has yet to reach its loop enters the copy there instead of playing the sample's own loop points
+    const SoundFontSampleView *view = &voice->view;
+    if (0 != mixer->looping[slot] && 0 != view->loopCopy && voice->loopStart == view->startLoop && voice->loopEnd == view->endLoop && index < voice->loopStart) {
+        mixer->copyOffset[slot] = (int32_t)(voice->loopStart - view->loopCopy);
+        mixer->loopEnd[slot] = (int32_t)voice->loopStart;
+        mixer->loopShift[slot] = mixer->copyOffset[slot];
+        mixer->loopNext[slot] = (int32_t)view->loopCopy + mixer->loopLength[slot];
+    }
+    mixer->loopMode[slot] = (uint8_t)(voice->loopMode == SOUNDFONT_LOOP_SUSTAIN && voice->released ? SOUNDFONT_LOOP_NONE : voice->loopMode);
+    mixer->gainLeft[slot] = voice->gainLeft;
+    mixer->gainRight[slot] = voice->gainRight;
+    mixer->targetLeft[slot] = voice->gainLeft;
+    mixer->targetRight[slot] = voice->gainRight;
+    mixer->filterCoef[slot] = 1.0f;
+    mixer->filterState[slot] = 0.0f;
+    soundfont_mixer_set_increment(mixer, handle, voice->increment);
+
+    return handle;
+}
+
+void soundfont_mixer_remove(SoundFontMixer *mixer, uint32_t handle) {
+    if (!soundfont_mixer_active(mixer, handle)) {
+        return;
+    }
+    uint32_t slot = mixer->slotOf[handle];
+    uint32_t last = --mixer->count;
+    if (slot != last) {
+        move_slot(mixer, last, slot);
+    }
+    clear_slot(mixer, last);
+    mixer->slotOf[handle] = SOUNDFONT_MIXER_NONE;
+}
+
+// the gains are reached at the end of the next rendered block
+void soundfont_mixer_set_gain(SoundFontMixer *mixer, uint32_t handle, float left, float right) {
+    if (soundfont_mixer_active(mixer, handle)) {
+        mixer->targetLeft[mixer->slotOf[handle]] = left;
+        mixer->targetRight[mixer->slotOf[handle]] = right;
+    }
+}
+
+// 32.32 fixed point, as SoundFontVoice.increment
+void soundfont_mixer_set_increment(SoundFontMixer *mixer, uint32_t handle, uint64_t increment) {
+    if (soundfont_mixer_active(mixer, handle)) {
+        uint32_t slot = mixer->slotOf[handle];
+        mixer->stepInt[slot] = (int32_t)(increment >> 32);
+        mixer->stepFrac[slot] = (float)((uint32_t)increment >> 8) * (1.0f / 16777216.0f);
+    }
+}
+
+void soundfont_mixer_set_cutoff(SoundFontMixer *mixer, uint32_t handle, float cutoffHz, uint32_t outputRate) {
+    if (soundfont_mixer_active(mixer, handle) && outputRate > 0) {
+        float coef = 1.0f - expf(-6.2831853f * cutoffHz / (float)outputRate);
+        mixer->filterCoef[mixer->slotOf[handle]] = coef < 0.0f ? 0.0f : (coef > 1.0f ? 1.0f : coef);
+    }
+}
+
+// a sustain loop stops looping and the voice plays on to its end
+void soundfont_mixer_release(SoundFontMixer *mixer, uint32_t handle) {
+    if (soundfont_mixer_active(mixer, handle)) {
+        uint32_t slot = mixer->slotOf[handle];
+        if (mixer->loopMode[slot] == SOUNDFONT_LOOP_SUSTAIN) {
+            // from the loop copy back to the same point of the sample, which plays on past the loop
+            if (0 != mixer->copyOffset[slot] && mixer->loopEnd[slot] == mixer->loopNext[slot]) {
+                mixer->index[slot] += mixer->copyOffset[slot];
+            }
+            mixer->copyOffset[slot] = 0;
+            mixer->looping[slot] = 0;
+            mixer->loopMode[slot] = SOUNDFONT_LOOP_NONE;  // stays released across soundfont_mixer_set_source
+        }
+    }
+}
+
+/*
+    Moves a voice to the sample data of voice->view, which must hold the same points at the same
+    positions as before over a possibly different number of frames, such as a whole sample taking
+    over from its resident head. Position, gains and filter state carry over; the end and the loop
+    are checked against the new frames again.
+*/
+bool soundfont_mixer_set_source(SoundFontMixer *mixer, uint32_t handle, const SoundFontVoice *voice) {
+    const void *src = mixer->format == SOUNDFONT_SAMPLE_FLOAT ? (const void *)voice->view.samples : (const void *)voice->view.data;
+    uint32_t tapsAfter = taps_after(mixer);
+    if (!soundfont_mixer_active(mixer, handle) || NULL == src || voice->view.frames <= tapsAfter) {
+        return false;
+    }
+    uint32_t slot = mixer->slotOf[handle];
+    uint32_t tapsBefore = taps_before(mixer);
+    uint32_t end = voice->end;
+    if (end > voice->view.frames - 1 - tapsAfter) {
+        end = voice->view.frames - 1 - tapsAfter;
+    }
+    if (end > INT32_MAX) {
+        return false;
+    }
+
+    bool loops = mixer->loopMode[slot] == SOUNDFONT_LOOP_CONTINUOUS || mixer->loopMode[slot] == SOUNDFONT_LOOP_SUSTAIN;
+    mixer->src[slot] = src;
+    mixer->end[slot] = (int32_t)end;
+    mixer->looping[slot] = loops && voice->loopEnd <= end && voice->loopStart >= tapsBefore ? -1 : 0;
+
+    return true;
+}
+
+bool soundfont_mixer_active(const SoundFontMixer *mixer, uint32_t handle) {
+    return handle < mixer->capacity && mixer->slotOf[handle] != SOUNDFONT_MIXER_NONE;
+}
+
+/*
+    Renders frames (at most blockSize) of every active voice into busLeft and busRight, which are
+    overwritten. Voices that ran past their end are removed afterwards and their handles written to
+    finished; the return value is the number of handles written.
+*/
+uint32_t soundfont_mixer_render(SoundFontMixer *mixer, uint32_t frames, uint32_t *finished, uint32_t maxFinished) {
+    if (frames > mixer->blockSize) {
+        frames = mixer->blockSize;
+    }
+    memset(mixer->laneLeft, 0, sizeof(float) * frames * SOUNDFONT_SIMD_WIDTH);
+    memset(mixer->laneRight, 0, sizeof(float) * frames * SOUNDFONT_SIMD_WIDTH);
+
+    mixer->sincVoices = 0;
+    for (uint32_t slot = 0; slot < mixer->count; slot += SOUNDFONT_SIMD_WIDTH) {
+        render_group(mixer, slot, frames);
+    }
+
+    for (uint32_t t = 0; t < frames; t++) {
+        mixer->busLeft[t] = sf_vf_hsum(sf_vf_load(mixer->laneLeft + t * SOUNDFONT_SIMD_WIDTH));
+        mixer->busRight[t] = sf_vf_hsum(sf_vf_load(mixer->laneRight + t * SOUNDFONT_SIMD_WIDTH));
+    }
+
+    uint32_t written = 0;
+    for (uint32_t slot = mixer->count; slot-- > 0;) {
+        if (0 == mixer->looping[slot] && mixer->index[slot] >= mixer->end[slot]) {
+            uint32_t handle = mixer->handleOf[slot];
+            if (written < maxFinished) {
+                finished[written++] = handle;
+            }
+            soundfont_mixer_remove(mixer, handle);
+        }
+    }
+
+    return written;
+}
+
+// points a read at index takes before and after it
+static uint32_t taps_before(const SoundFontMixer *mixer) {
+    if (mixer->interp == SOUNDFONT_INTERP_SINC) {
+        return mixer->sinc.taps / 2 - 1;
+    }
+    return mixer->interp == SOUNDFONT_INTERP_CUBIC ? 1 : 0;
+}
+
+// linear reads are bounded like cubic ones
+static uint32_t taps_after(const SoundFontMixer *mixer) {
+    return mixer->interp == SOUNDFONT_INTERP_SINC ? mixer->sinc.taps / 2 : 2;
+}
+
+static void clear_slot(SoundFontMixer *mixer, uint32_t slot) {
+    mixer->src[slot] = mixer->format == SOUNDFONT_SAMPLE_FLOAT ? (const void *)SILENCE_FLOAT : (const void *)SILENCE;
+    mixer->index[slot] = 1;
+    mixer->frac[slot] = 0.0f;
+    mixer->stepInt[slot] = 0;
+    mixer->stepFrac[slot] = 0.0f;
+    mixer->end[slot] = 2;
+    mixer->loopEnd[slot] = 2;
+    mixer->loopLength[slot] = 1;
+    mixer->loopShift[slot] = 1;
+    mixer->loopNext[slot] = 2;
+    mixer->copyOffset[slot] = 0;
+    mixer->looping[slot] = 0;
+    mixer->gainLeft[slot] = 0.0f;
+    mixer->gainRight[slot] = 0.0f;
+    mixer->targetLeft[slot] = 0.0f;
+    mixer->targetRight[slot] = 0.0f;
+    mixer->filterCoef[slot] = 1.0f;
+    mixer->filterState[slot] = 0.0f;
+    mixer->loopMode[slot] = SOUNDFONT_LOOP_NONE;
+    mixer->handleOf[slot] = SOUNDFONT_MIXER_NONE;
+}
+
+static void move_slot(SoundFontMixer *mixer, uint32_t from, uint32_t to) {
+    mixer->src[to] = mixer->src[from];
+    mixer->index[to] = mixer->index[from];
+    mixer->frac[to] = mixer->frac[from];
+    mixer->stepInt[to] = mixer->stepInt[from];
+    mixer->stepFrac[to] = mixer->stepFrac[from];
+    mixer->end[to] = mixer->end[from];
+    mixer->loopEnd[to] = mixer->loopEnd[from];
+    mixer->loopLength[to] = mixer->loopLength[from];
+    mixer->loopShift[to] = mixer->loopShift[from];
+    mixer->loopNext[to] = mixer->loopNext[from];
+    mixer->copyOffset[to] = mixer->copyOffset[from];
+    mixer->looping[to] = mixer->looping[from];
+    mixer->gainLeft[to] = mixer->gainLeft[from];
+    mixer->gainRight[to] = mixer->gainRight[from];
+    mixer->targetLeft[to] = mixer->targetLeft[from];
+    mixer->targetRight[to] = mixer->targetRight[from];
+    mixer->filterCoef[to] = mixer->filterCoef[from];
+    mixer->filterState[to] = mixer->filterState[from];
+    mixer->loopMode[to] = mixer->loopMode[from];
+    mixer->handleOf[to] = mixer->handleOf[from];
+    mixer->slotOf[mixer->handleOf[to]] = to;
+}
+
+/*
+    Loads x[idx + offset] and x[idx + offset + 1] of every lane, each lane from its own sample
+    data, scaled to [-1, 1).
+*/
+static void gather_pair(const void *const *samples, sf_vi idx, int32_t offset, sf_vf *first, sf_vf *second) {
+    const int16_t *const *src = (const int16_t *const *)samples;
+#if defined(SOUNDFONT_SIMD_AVX2)
+    // two 64-bit address gathers of one 32-bit word each, the word holding both points; AVX2 targets have 64-bit pointers
+    __m256i position = _mm256_add_epi32(idx, _mm256_set1_epi32(offset));
+    __m256i low = _mm256_add_epi64(_mm256_load_si256((const __m256i *)src), _mm256_slli_epi64(_mm256_cvtepi32_epi64(_mm256_castsi256_si128(position)), 1));
+    __m256i high = _mm256_add_epi64(_mm256_load_si256((const __m256i *)(src + 4)), _mm256_slli_epi64(_mm256_cvtepi32_epi64(_mm256_extracti128_si256(position, 1)), 1));
+    __m256i pair = _mm256_set_m128i(_mm256_i64gather_epi32((const int *)0, high, 1), _mm256_i64gather_epi32((const int *)0, low, 1));
+    *first = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(pair, 16), 16)), _mm256_set1_ps(SAMPLE_SCALE));
+    *second = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(pair, 16)), _mm256_set1_ps(SAMPLE_SCALE));
+#elif defined(SOUNDFONT_SIMD_SSE2)
+    int32_t i[4];
+    _mm_storeu_si128((__m128i *)i, _mm_add_epi32(idx, _mm_set1_epi32(offset)));
+    *first = _mm_mul_ps(_mm_setr_ps(src[0][i[0]], src[1][i[1]], src[2][i[2]], src[3][i[3]]), _mm_set1_ps(SAMPLE_SCALE));
+    *second = _mm_mul_ps(_mm_setr_ps(src[0][i[0] + 1], src[1][i[1] + 1], src[2][i[2] + 1], src[3][i[3] + 1]), _mm_set1_ps(SAMPLE_SCALE));
+#elif defined(SOUNDFONT_SIMD_NEON)
+    int32_t i[4];
+    vst1q_s32(i, vaddq_s32(idx, vdupq_n_s32(offset)));
+    float a[4] = {src[0][i[0]], src[1][i[1]], src[2][i[2]], src[3][i[3]]};
+    float b[4] = {src[0][i[0] + 1], src[1][i[1] + 1], src[2][i[2] + 1], src[3][i[3] + 1]};
+    *first = vmulq_n_f32(vld1q_f32(a), SAMPLE_SCALE);
+    *second = vmulq_n_f32(vld1q_f32(b), SAMPLE_SCALE);
+#else
+    *first = src[0][idx + offset] * SAMPLE_SCALE;
+    *second = src[0][idx + offset + 1] * SAMPLE_SCALE;
+#endif
+}
+
+// gather_pair for float32 sample data, which is already scaled
+static void gather_float_pair(const void *const *samples, sf_vi idx, int32_t offset, sf_vf *first, sf_vf *second) {
+    const float *const *src = (const float *const *)samples;
+#if defined(SOUNDFONT_SIMD_AVX2)
+    // one 64-bit gather per four lanes fetches both points, then the pairs are split into even and odd words
+    __m256i position = _mm256_add_epi32(idx, _mm256_set1_epi32(offset));
+    __m256i low = _mm256_add_epi64(_mm256_load_si256((const __m256i *)src), _mm256_slli_epi64(_mm256_cvtepi32_epi64(_mm256_castsi256_si128(position)), 2));
+    __m256i high = _mm256_add_epi64(_mm256_load_si256((const __m256i *)(src + 4)), _mm256_slli_epi64(_mm256_cvtepi32_epi64(_mm256_extracti128_si256(position, 1)), 2));
+    __m256 a = _mm256_castsi256_ps(_mm256_i64gather_epi64((const long long *)0, low, 1));
+    __m256 b = _mm256_castsi256_ps(_mm256_i64gather_epi64((const long long *)0, high, 1));
+    __m256d even = _mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+    __m256d odd = _mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    *first = _mm256_castpd_ps(_mm256_permute4x64_pd(even, _MM_SHUFFLE(3, 1, 2, 0)));
+    *second = _mm256_castpd_ps(_mm256_permute4x64_pd(odd, _MM_SHUFFLE(3, 1, 2, 0)));
+#elif defined(SOUNDFONT_SIMD_SSE2)
+    int32_t i[4];
+    _mm_storeu_si128((__m128i *)i, _mm_add_epi32(idx, _mm_set1_epi32(offset)));
+    *first = _mm_setr_ps(src[0][i[0]], src[1][i[1]], src[2][i[2]], src[3][i[3]]);
+    *second = _mm_setr_ps(src[0][i[0] + 1], src[1][i[1] + 1], src[2][i[2] + 1], src[3][i[3] + 1]);
+#elif defined(SOUNDFONT_SIMD_NEON)
+    int32_t i[4];
+    vst1q_s32(i, vaddq_s32(idx, vdupq_n_s32(offset)));
+    float a[4] = {src[0][i[0]], src[1][i[1]], src[2][i[2]], src[3][i[3]]};
+    float b[4] = {src[0][i[0] + 1], src[1][i[1] + 1], src[2][i[2] + 1], src[3][i[3] + 1]};
+    *first = vld1q_f32(a);
+    *second = vld1q_f32(b);
+#else
+    *first = src[0][idx + offset];
+    *second = src[0][idx + offset + 1];
+#endif
+}
+
+/*
+    Advances the SOUNDFONT_SIMD_WIDTH voices starting at slot through frames output frames. The
+    state stays in registers for the whole block and each lane adds into its own column of the
+    lane buffers, which render folds into the buses afterwards.
+*/
+static void render_group(SoundFontMixer *mixer, uint32_t slot, uint32_t frames) {
+    const void *const *src = mixer->src + slot;
+    sf_vi index = sf_vi_load(mixer->index + slot);
+    sf_vf frac = sf_vf_load(mixer->frac + slot);
+    sf_vi stepInt = sf_vi_load(mixer->stepInt + slot);
+    sf_vf stepFrac = sf_vf_load(mixer->stepFrac + slot);
+    sf_vi end = sf_vi_load(mixer->end + slot);
+    sf_vi lastLoop = sf_vi_sub(sf_vi_load(mixer->loopEnd + slot), sf_vi_set1(1));
+    sf_vi loopLength = sf_vi_load(mixer->loopLength + slot);
+    sf_vi loopShift = sf_vi_load(mixer->loopShift + slot);
+    sf_vi lastNext = sf_vi_sub(sf_vi_load(mixer->loopNext + slot), sf_vi_set1(1));
+    sf_vi looping = sf_vi_load(mixer->looping + slot);
+    sf_vf gainLeft = sf_vf_load(mixer->gainLeft + slot);
+    sf_vf gainRight = sf_vf_load(mixer->gainRight + slot);
+    sf_vf targetLeft = sf_vf_load(mixer->targetLeft + slot);
+    sf_vf targetRight = sf_vf_load(mixer->targetRight + slot);
+    sf_vf coef = sf_vf_load(mixer->filterCoef + slot);
+    sf_vf state = sf_vf_load(mixer->filterState + slot);
+
+    const sf_vf one = sf_vf_set1(1.0f);
+    const sf_vi oneInt = sf_vi_set1(1);
+    sf_vf perFrame = sf_vf_set1(1.0f / (float)frames);
+    sf_vf rampLeft = sf_vf_mul(sf_vf_sub(targetLeft, gainLeft), perFrame);
+    sf_vf rampRight = sf_vf_mul(sf_vf_sub(targetRight, gainRight), perFrame);
+    sf_vi alive = sf_vi_or(looping, sf_vi_cmpgt(end, index));
+    bool cubic = mixer->interp != SOUNDFONT_INTERP_LINEAR;
+    bool floats = mixer->format == SOUNDFONT_SAMPLE_FLOAT;
+    bool sinc[SOUNDFONT_SIMD_WIDTH];
+    uint32_t sincLanes = mixer->interp == SOUNDFONT_INTERP_SINC ? choose_tiers(mixer, slot, sinc) : 0;
+    mixer->sincVoices += sincLanes;
+    const SoundFontSincTable *table = &mixer->sinc;
+    int32_t *laneIndex = mixer->index + slot;
+    float *laneFrac = mixer->frac + slot;
+
+    for (uint32_t t = 0; t < frames; t++) {
+        sf_vf y = sf_vf_set1(0.0f);
+        if (sincLanes == SOUNDFONT_SIMD_WIDTH) {
+            // every lane runs the filter, nothing to blend into
+        } else if (cubic) {
+            sf_vf xm1, x0, x1, x2;
+            if (floats) {
+                gather_float_pair(src, index, -1, &xm1, &x0);
+                gather_float_pair(src, index, 1, &x1, &x2);
+            } else {
+                gather_pair(src, index, -1, &xm1, &x0);
+                gather_pair(src, index, 1, &x1, &x2);
+            }
+            sf_vf c1 = sf_vf_mul(sf_vf_set1(0.5f), sf_vf_sub(x1, xm1));
+            sf_vf c2 = sf_vf_sub(sf_vf_add(sf_vf_sub(xm1, sf_vf_mul(sf_vf_set1(2.5f), x0)), sf_vf_mul(sf_vf_set1(2.0f), x1)), sf_vf_mul(sf_vf_set1(0.5f), x2));
+            sf_vf c3 = sf_vf_add(sf_vf_mul(sf_vf_set1(0.5f), sf_vf_sub(x2, xm1)), sf_vf_mul(sf_vf_set1(1.5f), sf_vf_sub(x0, x1)));
+            y = sf_vf_add(sf_vf_mul(c3, frac), c2);
+            y = sf_vf_add(sf_vf_mul(y, frac), c1);
+            y = sf_vf_add(sf_vf_mul(y, frac), x0);
+        } else {
+            sf_vf x0, x1;
+            if (floats) {
+                gather_float_pair(src, index, 0, &x0, &x1);
+            } else {
+                gather_pair(src, index, 0, &x0, &x1);
+            }
+            y = sf_vf_add(x0, sf_vf_mul(frac, sf_vf_sub(x1, x0)));
+        }
+        if (sincLanes > 0) {
+            // the state arrays of the group take the positions, they are written back after the block anyway
+            sf_vi_store(laneIndex, index);
+            sf_vf_store(laneFrac, frac);
+            sf_vf_store(mixer->sincOut, y);
+            for (uint32_t l = 0; l < SOUNDFONT_SIMD_WIDTH; l++) {
+                if (sinc[l]) {
+                    int32_t first = laneIndex[l] - (int32_t)(table->taps / 2) + 1;
+                    mixer->sincOut[l] = floats ? sinc_dot_float(table, (const float *)src[l] + first, laneFrac[l])
+                                               : sinc_dot(table, (const int16_t *)src[l] + first, laneFrac[l]);
+                }
+            }
+            y = sf_vf_load(mixer->sincOut);
+        }
+
+        state = sf_vf_add(state, sf_vf_mul(coef, sf_vf_sub(y, state)));
+        y = sf_vf_and(alive, state);
+
+        float *laneLeft = mixer->laneLeft + t * SOUNDFONT_SIMD_WIDTH;
+        float *laneRight = mixer->laneRight + t * SOUNDFONT_SIMD_WIDTH;
+        sf_vf_store(laneLeft, sf_vf_add(sf_vf_load(laneLeft), sf_vf_mul(y, gainLeft)));
+        sf_vf_store(laneRight, sf_vf_add(sf_vf_load(laneRight), sf_vf_mul(y, gainRight)));
+        gainLeft = sf_vf_add(gainLeft, rampLeft);
+        gainRight = sf_vf_add(gainRight, rampRight);
+
+        // the fraction stays below two, so one compare yields the carry
+        frac = sf_vf_add(frac, stepFrac);
+        sf_vi carry = sf_vf_cmpge(frac, one);
+        frac = sf_vf_sub(frac, sf_vf_and(carry, one));
+        index = sf_vi_add(index, sf_vi_add(stepInt, sf_vi_and(carry, oneInt)));
+
+        sf_vi wrap = sf_vi_and(looping, sf_vi_cmpgt(index, lastLoop));
+        index = sf_vi_sub(index, sf_vi_and(wrap, loopShift));
+        // the first wrap into a loop copy leaves the voice circling the copy, otherwise this changes nothing
+        lastLoop = sf_vi_select(wrap, lastNext, lastLoop);
+        loopShift = sf_vi_select(wrap, loopLength, loopShift);
+        // finished voices, and loops shorter than one step, park at end where the padding is silent
+        index = sf_vi_select(sf_vi_cmpgt(index, end), end, index);
+        alive = sf_vi_or(looping, sf_vi_cmpgt(end, index));
+    }
+
+    sf_vi_store(mixer->index + slot, index);
+    sf_vf_store(mixer->frac + slot, frac);
+    sf_vi_store(mixer->loopEnd + slot, sf_vi_add(lastLoop, oneInt));
+    sf_vi_store(mixer->loopShift + slot, loopShift);
+    sf_vf_store(mixer->gainLeft + slot, targetLeft);
+    sf_vf_store(mixer->gainRight + slot, targetRight);
+    sf_vf_store(mixer->filterState + slot, state);
+}
+
+/*
+    Picks the tier of each lane of the group for the next block, setting sinc for the lanes that
+    run the filter and returning their number. Idle and finished lanes, voices below sincQuiet
+    over the whole block and voices reading whole points at unity pitch, which cubic plays
+    exactly, stay on the cubic tier.
+*/
+static uint32_t choose_tiers(const SoundFontMixer *mixer, uint32_t slot, bool *sinc) {
+    uint32_t lanes = 0;
+    for (uint32_t l = 0; l < SOUNDFONT_SIMD_WIDTH; l++) {
+        uint32_t s = slot + l;
+        float level = fabsf(mixer->gainLeft[s]);
+        level = fabsf(mixer->gainRight[s]) > level ? fabsf(mixer->gainRight[s]) : level;
+        level = fabsf(mixer->targetLeft[s]) > level ? fabsf(mixer->targetLeft[s]) : level;
+        level = fabsf(mixer->targetRight[s]) > level ? fabsf(mixer->targetRight[s]) : level;
+        bool unity = 1 == mixer->stepInt[s] && 0.0f == mixer->stepFrac[s] && 0.0f == mixer->frac[s];
+        bool alive = 0 != mixer->looping[s] || mixer->index[s] < mixer->end[s];
+        sinc[l] = s < mixer->count && alive && !unity && level >= mixer->sincQuiet;
+        lanes += sinc[l] ? 1 : 0;
+    }
+
+    return lanes;
+}
+
+/*
+    One output point of the filter: the taps points from x on weighed by the rows around frac,
+    taps / 8 vector steps with no branch on the data.
+*/
+static float sinc_dot(const SoundFontSincTable *table, const int16_t *x, float frac) {
+    float position = frac * (float)table->phases;
+    uint32_t row = (uint32_t)position;
+    row = row < table->phases ? row : table->phases - 1;
+    float blend = position - (float)row;
+    const float *a = table->coefs + (size_t)row * table->taps;
+    const float *b = a + table->taps;
+#if defined(SOUNDFONT_SIMD_AVX2)
+    __m256 w = _mm256_set1_ps(blend);
+    __m256 sum = _mm256_setzero_ps();
+    for (uint32_t k = 0; k < table->taps; k += 8) {
+        __m256 c = _mm256_load_ps(a + k);
+        c = _mm256_add_ps(c, _mm256_mul_ps(w, _mm256_sub_ps(_mm256_load_ps(b + k), c)));
+        __m256 v = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(x + k))));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(c, v));
+    }
+    return sf_vf_hsum(sum) * SAMPLE_SCALE;
+#elif defined(SOUNDFONT_SIMD_SSE2)
+    __m128 w = _mm_set1_ps(blend);
+    __m128 sum = _mm_setzero_ps();
+    for (uint32_t k = 0; k < table->taps; k += 8) {
+        // the points widen to 32 bits by pairing each with itself and shifting the copy out
+        __m128i v = _mm_loadu_si128((const __m128i *)(x + k));
+        __m128 low = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+        __m128 high = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+        __m128 c = _mm_load_ps(a + k);
+        c = _mm_add_ps(c, _mm_mul_ps(w, _mm_sub_ps(_mm_load_ps(b + k), c)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(c, low));
+        c = _mm_load_ps(a + k + 4);
+        c = _mm_add_ps(c, _mm_mul_ps(w, _mm_sub_ps(_mm_load_ps(b + k + 4), c)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(c, high));
+    }
+    return sf_vf_hsum(sum) * SAMPLE_SCALE;
+#elif defined(SOUNDFONT_SIMD_NEON)
+    float32x4_t sum = vdupq_n_f32(0.0f);
+    for (uint32_t k = 0; k < table->taps; k += 8) {
+        int16x8_t v = vld1q_s16(x + k);
+        float32x4_t c = vld1q_f32(a + k);
+        c = vmlaq_n_f32(c, vsubq_f32(vld1q_f32(b + k), c), blend);
+        sum = vmlaq_f32(sum, c, vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))));
+        c = vld1q_f32(a + k + 4);
+        c = vmlaq_n_f32(c, vsubq_f32(vld1q_f32(b + k + 4), c), blend);
+        sum = vmlaq_f32(sum, c, vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))));
+    }
+    return sf_vf_hsum(sum) * SAMPLE_SCALE;
+#else
+    float sum = 0.0f;
+    for (uint32_t k = 0; k < table->taps; k++) {
+        sum += (a[k] + blend * (b[k] - a[k])) * x[k];
+    }
+    return sum * SAMPLE_SCALE;
+#endif
+}
+
+// sinc_dot for float32 sample data
+static float sinc_dot_float(const SoundFontSincTable *table, const float *x, float frac) {
+    float position = frac * (float)table->phases;
+    uint32_t row = (uint32_t)position;
+    row = row < table->phases ? row : table->phases - 1;
+    float blend = position - (float)row;
+    const float *a = table->coefs + (size_t)row * table->taps;
+    const float *b = a + table->taps;
+#if defined(SOUNDFONT_SIMD_AVX2)
+    __m256 w = _mm256_set1_ps(blend);
+    __m256 sum = _mm256_setzero_ps();
+    for (uint32_t k = 0; k < table->taps; k += 8) {
+        __m256 c = _mm256_load_ps(a + k);
+        c = _mm256_add_ps(c, _mm256_mul_ps(w, _mm256_sub_ps(_mm256_load_ps(b + k), c)));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(c, _mm256_loadu_ps(x + k)));
+    }
+    return sf_vf_hsum(sum);
+#elif defined(SOUNDFONT_SIMD_SSE2)
+    __m128 w = _mm_set1_ps(blend);
+    __m128 sum = _mm_setzero_ps();
+    for (uint32_t k = 0; k < table->taps; k += 4) {
+        __m128 c = _mm_load_ps(a + k);
+        c = _mm_add_ps(c, _mm_mul_ps(w, _mm_sub_ps(_mm_load_ps(b + k), c)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(c, _mm_loadu_ps(x + k)));
+    }
+    return sf_vf_hsum(sum);
+#elif defined(SOUNDFONT_SIMD_NEON)
+    float32x4_t sum = vdupq_n_f32(0.0f);
+    for (uint32_t k = 0; k < table->taps; k += 4) {
+        float32x4_t c = vld1q_f32(a + k);
+        c = vmlaq_n_f32(c, vsubq_f32(vld1q_f32(b + k), c), blend);
+        sum = vmlaq_f32(sum, c, vld1q_f32(x + k));
+    }
+    return sf_vf_hsum(sum);
+#else
+    float sum = 0.0f;
+    for (uint32_t k = 0; k < table->taps; k++) {
+        sum += (a[k] + blend * (b[k] - a[k])) * x[k];
+    }
+    return sum;
+#endif
+}
@@ -0,0 +1,113 @@
+/*
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#ifndef CMANLH_SOUNDFONT_MIXER
+#define CMANLH_SOUNDFONT_MIXER
+
+#include "soundfont_sinc.h"
+#include "soundfont_voice.h"
+
+#define SOUNDFONT_MIXER_NONE 0xFFFFFFFF  // handle returned when no slot is free
+#define SOUNDFONT_MIXER_SINC_QUIET 0.001f  // -60 dB, quieter voices play cubic under SOUNDFONT_INTERP_SINC
+
+typedef enum SoundFontSampleFormat {
+    SOUNDFONT_SAMPLE_INT16,  // voices play SoundFontSampleView.data
+    SOUNDFONT_SAMPLE_FLOAT   // voices play SoundFontSampleView.samples, see soundfont_convert_sdta
+} SoundFontSampleFormat;
+
+/*
+    Polyphonic mixer keeping the state of every active voice as structure-of-arrays, so one vector
+    lane carries one voice and SOUNDFONT_SIMD_WIDTH voices advance per instruction. Active voices are
+    packed at the front of the arrays; callers address them by a stable handle in [0, capacity).
+
+    Reads rely on the spec guarantees that the points after endLoop repeat the points after
+    startLoop and that each sample is followed by zero valued points, so loops wrap with a single
+    compare and no interpolation tap is fetched through a branch. The sinc filter reads taps / 2
+    points on either side of the position, so its loops rely on that many repeated points. Views
+    with a loop copy (see soundfont_prepare_samples) need no such guarantee: a voice entering its
+    loop moves into the copy, whose neighbours are wrapped, and back to the sample on release.
+
+    Under SOUNDFONT_INTERP_SINC every voice picks its tier at the start of each block: voices
+    whose gains stay below sincQuiet, and voices playing their points unresampled at unity pitch,
+    interpolate cubic for the whole block; the others run the filter through a vector dot product
+    per lane. sincVoices counts the voices of the last block that did, the figure to budget
+    voices per core by.
+*/
+typedef struct SoundFontMixer {
+    void *memory;
+    uint32_t capacity;   // slots, a multiple of SOUNDFONT_SIMD_WIDTH
+    uint32_t count;      // active voices, slots [0, count)
+    uint32_t blockSize;  // most frames one render call produces
+    SoundFontInterp interp;
+    SoundFontSampleFormat format;
+    SoundFontSincTable sinc;  // built while interp is SOUNDFONT_INTERP_SINC
+    float sincQuiet;          // gain below which a voice skips the sinc tier, SOUNDFONT_MIXER_SINC_QUIET
+    uint32_t sincVoices;      // voices the last render played through the sinc tier
+
+    const void **src;     // sample data of each slot
+    int32_t *index;       // integer part of the read position
+    float *frac;          // fractional part of the read position
+    int32_t *stepInt;     // integer part of the increment
+    float *stepFrac;      // fractional part of the increment
+    int32_t *end;         // last readable position plus one
+    int32_t *loopEnd;  // one past the loop being played, where the next wrap happens
+    int32_t *loopLength;
+    int32_t *loopShift;   // subtracted at the next wrap
+    int32_t *loopNext;    // loopEnd after a wrap, differs from it until a voice moves into its loop copy
+    int32_t *copyOffset;  // loop start in the sample less loop start in the copy, 0 without a copy
+    int32_t *looping;  // all ones while the loop is active
+    float *gainLeft;
+    float *gainRight;
+    float *targetLeft;  // reached linearly over the next block
+    float *targetRight;
+    float *filterCoef;  // one-pole low-pass, 1 bypasses the filter
+    float *filterState;
+    uint8_t *loopMode;
+    uint32_t *handleOf;  // slot to handle
+    uint32_t *slotOf;    // handle to slot, SOUNDFONT_MIXER_NONE when free
+
+    float *busLeft;  // stereo output of the last block, blockSize frames
+    float *busRight;
+    float *laneLeft;  // per lane partial sums, blockSize * SOUNDFONT_SIMD_WIDTH
+    float *laneRight;
+    float *sincOut;  // sinc tier results of one frame, SOUNDFONT_SIMD_WIDTH floats
+} SoundFontMixer;
+
+void soundfont_init_mixer(SoundFontMixer *mixer);
+bool soundfont_create_mixer(SoundFontMixer *mixer, uint32_t capacity, uint32_t blockSize, SoundFontInterp interp, SoundFontSampleFormat format);
+void soundfont_release_mixer(SoundFontMixer *mixer);
+bool soundfont_mixer_set_interp(SoundFontMixer *mixer, SoundFontInterp interp, uint32_t taps, uint32_t phases);
+
+uint32_t soundfont_mixer_add(SoundFontMixer *mixer, const SoundFontVoice *voice);
+void soundfont_mixer_remove(SoundFontMixer *mixer, uint32_t handle);
+void soundfont_mixer_set_gain(SoundFontMixer *mixer, uint32_t handle, float left, float right);
+void soundfont_mixer_set_increment(SoundFontMixer *mixer, uint32_t handle, uint64_t increment);
+void soundfont_mixer_set_cutoff(SoundFontMixer *mixer, uint32_t handle, float cutoffHz, uint32_t outputRate);
+void soundfont_mixer_release(SoundFontMixer *mixer, uint32_t handle);
+bool soundfont_mixer_set_source(SoundFontMixer *mixer, uint32_t handle, const SoundFontVoice *voice);
+bool soundfont_mixer_active(const SoundFontMixer *mixer, uint32_t handle);
+
+uint32_t soundfont_mixer_render(SoundFontMixer *mixer, uint32_t frames, uint32_t *finished, uint32_t maxFinished);
+
+#endif
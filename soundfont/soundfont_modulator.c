@@ -0,0 +1,487 @@
+/*
+    RIFF file process library
+
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#include "soundfont_modulator.h"
+
+#include <math.h>
+
+#define MOD_LINK_BIT 0x8000
+#define MOD_LEVEL_PRESET 0x80000000u  // origin of a preset level modulator, the rest is its pmod index
+#define MOD_ORIGIN_DEFAULT 0x7FFFFFFFu
+
+// the default modulators of the spec; the pitch wheel one targets fineTune, which is in cents
+static const SoundFontMod DEFAULT_MODS[] = {
+    {0x0502, SOUNDFONT_GEN_INITIAL_ATTENUATION, 960, 0x0000, 0},  // velocity
+    {0x0102, SOUNDFONT_GEN_INITIAL_FILTER_FC, (uint16_t)-2400, 0x0000, 0},
+    {0x000D, SOUNDFONT_GEN_VIB_LFO_TO_PITCH, 50, 0x0000, 0},  // channel pressure
+    {0x0081, SOUNDFONT_GEN_VIB_LFO_TO_PITCH, 50, 0x0000, 0},  // modulation wheel
+    {0x0587, SOUNDFONT_GEN_INITIAL_ATTENUATION, 960, 0x0000, 0},  // volume
+    {0x028A, SOUNDFONT_GEN_PAN, 1000, 0x0000, 0},
+    {0x058B, SOUNDFONT_GEN_INITIAL_ATTENUATION, 960, 0x0000, 0},  // expression
+    {0x00DB, SOUNDFONT_GEN_REVERB_EFFECTS_SEND, 200, 0x0000, 0},
+    {0x00DD, SOUNDFONT_GEN_CHORUS_EFFECTS_SEND, 200, 0x0000, 0},
+    {0x020E, SOUNDFONT_GEN_FINE_TUNE, 12700, 0x0010, 0}};  // pitch wheel scaled by its sensitivity
+#define DEFAULT_MOD_COUNT (sizeof(DEFAULT_MODS) / sizeof(DEFAULT_MODS[0]))
+
+typedef struct MergedMod {
+    SoundFontMod mod;
+    uint32_t origin;
+    uint32_t zoneFirst;  // first modulator of the origin's zone, links are relative to it
+} MergedMod;
+
+typedef struct MergedList {
+    MergedMod items[SOUNDFONT_MOD_MAX_OPS];
+    uint32_t count;
+} MergedList;
+
+static void build_curves(float (*curves)[SOUNDFONT_MOD_CURVE_SIZE]);
+static void merge_zone(MergedList *list, const SoundFontMod *mods, uint32_t first, uint32_t last, uint32_t level);
+static bool decode_source(uint16_t operator, uint8_t *src, uint8_t *curve);
+static uint16_t compile_program(const MergedList *list, SoundFontModOp *ops, uint32_t *depends);
+static float source_value(const SoundFontModTable *table, uint8_t src, uint8_t curve, const SoundFontModVoice *voice, const SoundFontModInputs *inputs);
+static float evaluate_op(const SoundFontModVoice *voice, const SoundFontModOp *ops, uint16_t i, const SoundFontModInputs *inputs);
+
+void soundfont_init_mods(SoundFontModTable *table) {
+    table->memory = NULL;
+    table->ops = NULL;
+    table->opCount = 0;
+    table->programs = NULL;
+    table->programCount = 0;
+    table->curves = NULL;
+}
+
+/*
+    Compiles the modulators of every region. The instrument level starts from the default
+    modulators; global then local zone modulators replace an identical one (same sources,
+    destination and transform) or are appended. Preset modulators are merged the same way among
+    themselves and then appended, since the preset level only adds to the instrument level.
+*/
+bool soundfont_build_mods(SoundFontModTable *table, const SoundFontPdtaData *pdta, const SoundFontRegionIndex *regions) {
+    soundfont_init_mods(table);
+    if (!pdta->verified) {
+        printf("Modulators are only compiled over a verified pdta.\n");
+        return false;
+    }
+
+    size_t curveBytes = sizeof(float) * SOUNDFONT_MOD_CURVES * SOUNDFONT_MOD_CURVE_SIZE;
+    size_t programBytes = sizeof(SoundFontModProgram) * regions->regionCount;
+    size_t opBytes = sizeof(SoundFontModOp) * SOUNDFONT_MOD_MAX_OPS * regions->regionCount;
+    table->memory = malloc(curveBytes + programBytes + opBytes);
+    if (NULL == table->memory) {
+        printf("Not enough memory for compiling modulators.\n");
+        return false;
+    }
+    table->curves = (float (*)[SOUNDFONT_MOD_CURVE_SIZE])table->memory;
+    table->programs = (SoundFontModProgram *)((uint8_t *)table->memory + curveBytes);
+    table->programCount = regions->regionCount;
+    table->ops = (SoundFontModOp *)((uint8_t *)table->programs + programBytes);
+    build_curves(table->curves);
+
+    MergedList inst, preset;
+    for (uint32_t r = 0; r < regions->regionCount; r++) {
+        const SoundFontRegion *region = regions->regions + r;
+        uint32_t first, last;
+
+        inst.count = 0;
+        for (uint32_t i = 0; i < DEFAULT_MOD_COUNT; i++) {
+            inst.items[inst.count].mod = DEFAULT_MODS[i];
+            inst.items[inst.count].origin = MOD_ORIGIN_DEFAULT;
+            inst.items[inst.count++].zoneFirst = 0;
+        }
+        if (SOUNDFONT_NO_ZONE != region->instGlobalZone) {
+            soundfont_pdta_inst_mods(pdta, region->instGlobalZone, &first, &last);
+            merge_zone(&inst, pdta->iMod, first, last, 0);
+        }
+        soundfont_pdta_inst_mods(pdta, region->instZone, &first, &last);
+        merge_zone(&inst, pdta->iMod, first, last, 0);
+
+        preset.count = 0;
+        if (SOUNDFONT_NO_ZONE != region->presetGlobalZone) {
+            soundfont_pdta_preset_mods(pdta, region->presetGlobalZone, &first, &last);
+            merge_zone(&preset, pdta->presetMod, first, last, MOD_LEVEL_PRESET);
+        }
+        soundfont_pdta_preset_mods(pdta, region->presetZone, &first, &last);
+        merge_zone(&preset, pdta->presetMod, first, last, MOD_LEVEL_PRESET);
+        for (uint32_t i = 0; i < preset.count && inst.count < SOUNDFONT_MOD_MAX_OPS; i++) {
+            inst.items[inst.count++] = preset.items[i];
+        }
+
+        SoundFontModProgram *program = table->programs + r;
+        program->first = table->opCount;
+        program->count = compile_program(&inst, table->ops + table->opCount, program->depends);
+        table->opCount += program->count;
+    }
+
+    // give back the room reserved for lists of the maximum length
+    void *memory = realloc(table->memory, curveBytes + programBytes + sizeof(SoundFontModOp) * table->opCount);
+    if (NULL != memory && memory != table->memory) {
+        table->memory = memory;
+        table->curves = (float (*)[SOUNDFONT_MOD_CURVE_SIZE])memory;
+        table->programs = (SoundFontModProgram *)((uint8_t *)memory + curveBytes);
+        table->ops = (SoundFontModOp *)((uint8_t *)table->programs + programBytes);
+    }
+
+    return true;
+}
+
+void soundfont_release_mods(SoundFontModTable *table) {
+    if (NULL != table->memory) {
+        free(table->memory);
+    }
+    soundfont_init_mods(table);
+}
+
+// the power-on state of the controllers the default modulators read
+void soundfont_mod_inputs_reset(SoundFontModInputs *inputs) {
+    memset(inputs, 0, sizeof(SoundFontModInputs));
+    inputs->cc[7] = 100;
+    inputs->cc[10] = 64;
+    inputs->cc[11] = 127;
+    inputs->pitchSensitivity = 2;
+    inputs->pitchWheel = 8192;
+}
+
+// stores an input and tells whether it changed; key selects the poly pressure entry
+bool soundfont_mod_set_input(SoundFontModInputs *inputs, uint8_t src, uint8_t key, uint16_t value) {
+    uint8_t *byte = NULL;
+    if (src < SOUNDFONT_MOD_SRC_GENERAL) {
+        byte = inputs->cc + src;
+    } else if (SOUNDFONT_MOD_SRC_POLY_PRESSURE == src) {
+        byte = inputs->polyPressure + (key & 0x7F);
+    } else if (SOUNDFONT_MOD_SRC_CHANNEL_PRESSURE == src) {
+        byte = &inputs->channelPressure;
+    } else if (SOUNDFONT_MOD_SRC_PITCH_SENSITIVITY == src) {
+        byte = &inputs->pitchSensitivity;
+    } else if (SOUNDFONT_MOD_SRC_PITCH_WHEEL == src) {
+        value &= 0x3FFF;
+        if (inputs->pitchWheel == value) {
+            return false;
+        }
+        inputs->pitchWheel = value;
+        return true;
+    }
+
+    if (NULL == byte || *byte == (value & 0x7F)) {
+        return false;
+    }
+    *byte = value & 0x7F;
+    return true;
+}
+
+void soundfont_mod_voice_start(SoundFontModVoice *voice, const SoundFontModTable *table, uint32_t region, uint8_t key, uint8_t velocity,
+                               const SoundFontModInputs *inputs) {
+    voice->table = table;
+    voice->program = region < table->programCount ? table->programs + region : NULL;
+    voice->key = key;
+    voice->velocity = velocity;
+    memset(voice->mod, 0, sizeof(voice->mod));
+    voice->dirty = 0;
+    if (NULL == voice->program) {
+        return;
+    }
+
+    const SoundFontModOp *ops = table->ops + voice->program->first;
+    for (uint16_t i = 0; i < voice->program->count; i++) {
+        voice->out[i] = evaluate_op(voice, ops, i, inputs);
+        if (0 == (ops[i].flags & SOUNDFONT_MOD_LINKED)) {
+            voice->mod[ops[i].dest] += voice->out[i];
+            voice->dirty |= (uint64_t)1 << ops[i].dest;
+        }
+    }
+}
+
+/*
+    Re-evaluates only the ops that read src, and the ops their links feed, after the input changed.
+    Returns whether any generator offset moved.
+*/
+bool soundfont_mod_voice_update(SoundFontModVoice *voice, const SoundFontModInputs *inputs, uint8_t src) {
+    const SoundFontModProgram *program = voice->program;
+    if (NULL == program || 0 == (program->depends[src >> 5] & (1u << (src & 31)))) {
+        return false;
+    }
+
+    const SoundFontModOp *ops = voice->table->ops + program->first;
+    bool linkChanged[SOUNDFONT_MOD_MAX_OPS] = {false};
+    bool changed = false;
+    for (uint16_t i = 0; i < program->count; i++) {
+        const SoundFontModOp *op = ops + i;
+        if (op->src != src && op->amtSrc != src && !linkChanged[i]) {
+            continue;
+        }
+        float value = evaluate_op(voice, ops, i, inputs);
+        if (value == voice->out[i]) {
+            continue;
+        }
+        if (op->flags & SOUNDFONT_MOD_LINKED) {
+            linkChanged[op->dest] = true;
+        } else {
+            voice->mod[op->dest] += value - voice->out[i];
+            voice->dirty |= (uint64_t)1 << op->dest;
+            changed = true;
+        }
+        voice->out[i] = value;
+    }
+
+    return changed;
+}
+
+/*
+    Curve c = type * 4 + polarity * 2 + direction at x = i / 128. Concave and convex follow the
+    spec's 96 dB attenuation shape; their bipolar forms mirror the curve around the centre.
+*/
+static void build_curves(float (*curves)[SOUNDFONT_MOD_CURVE_SIZE]) {
+    for (int c = 0; c < SOUNDFONT_MOD_CURVES; c++) {
+        int type = c >> 2;
+        bool bipolar = (c >> 1) & 1;
+        bool negative = c & 1;
+        for (int i = 0; i < SOUNDFONT_MOD_CURVE_SIZE; i++) {
+            double x = i / 128.0;
+            if (negative) {
+                x = 1.0 - x;
+            }
+            double sign = 1.0;
+            if (bipolar) {
+                // fold to a magnitude in [0, 1] and apply the unipolar shape to it
+                x = 2.0 * x - 1.0;
+                sign = x < 0 ? -1.0 : 1.0;
+                x = fabs(x);
+            }
+
+            double y;
+            switch (type) {
+                case 1:  // concave
+                    y = x >= 1.0 ? 1.0 : -40.0 / 96.0 * log10(1.0 - x);
+                    break;
+                case 2:  // convex
+                    y = x <= 0.0 ? 0.0 : 1.0 + 40.0 / 96.0 * log10(x);
+                    break;
+                case 3:  // switch
+                    y = bipolar ? 1.0 : (x >= 0.5 ? 1.0 : 0.0);
+                    break;
+                default:
+                    y = x;
+                    break;
+            }
+            y = y < 0.0 ? 0.0 : (y > 1.0 ? 1.0 : y);
+            curves[c][i] = (float)(sign * y);
+        }
+    }
+}
+
+// a later zone replaces identical modulators, within one zone only the first of identical ones counts
+static void merge_zone(MergedList *list, const SoundFontMod *mods, uint32_t first, uint32_t last, uint32_t level) {
+    for (uint32_t m = first; m < last; m++) {
+        const SoundFontMod *mod = mods + m;
+        uint32_t slot = list->count;
+        for (uint32_t i = 0; i < list->count; i++) {
+            const SoundFontMod *old = &list->items[i].mod;
+            if (old->srcOperator == mod->srcOperator && old->destOperator == mod->destOperator && old->amtSrcOperator == mod->amtSrcOperator &&
+                old->transOperator == mod->transOperator) {
+                slot = i;
+                break;
+            }
+        }
+        if (slot < list->count && list->items[slot].origin != MOD_ORIGIN_DEFAULT && list->items[slot].zoneFirst == first &&
+            (list->items[slot].origin & MOD_LEVEL_PRESET) == level) {
+            continue;
+        }
+        if (slot == list->count) {
+            if (list->count >= SOUNDFONT_MOD_MAX_OPS) {
+                continue;
+            }
+            list->count++;
+        }
+        list->items[slot].mod = *mod;
+        list->items[slot].origin = level | m;
+        list->items[slot].zoneFirst = first;
+    }
+}
+
+// false for controller types and general controllers the spec does not define
+static bool decode_source(uint16_t operator, uint8_t *src, uint8_t *curve) {
+    uint8_t index = operator & 0x7F;
+    uint8_t type = operator >> 10;
+    if (type > 3) {
+        return false;
+    }
+    if (operator & 0x80) {
+        *src = index;
+    } else {
+        switch (index) {
+            case 0:
+            case 2:
+            case 3:
+            case 10:
+            case 13:
+            case 14:
+            case 16:
+            case 127:
+                *src = SOUNDFONT_MOD_SRC_GENERAL + index;
+                break;
+            default:
+                return false;
+        }
+    }
+    *curve = (uint8_t)(type * 4 + ((operator >> 9) & 1) * 2 + ((operator >> 8) & 1));
+
+    return true;
+}
+
+/*
+    Turns a merged list into ops. Invalid modulators and those with a zero amount are dropped,
+    links are resolved to op indices and the ops are ordered so every link runs before its target.
+*/
+static uint16_t compile_program(const MergedList *list, SoundFontModOp *ops, uint32_t *depends) {
+    SoundFontModOp compiled[SOUNDFONT_MOD_MAX_OPS];
+    int32_t target[SOUNDFONT_MOD_MAX_OPS];  // list index a link feeds, -1 for generators
+    int32_t position[SOUNDFONT_MOD_MAX_OPS];
+    uint32_t depth[SOUNDFONT_MOD_MAX_OPS];
+    uint16_t count = 0;
+
+    memset(depends, 0, sizeof(uint32_t) * 8);
+    for (uint32_t i = 0; i < list->count; i++) {
+        const SoundFontMod *mod = &list->items[i].mod;
+        SoundFontModOp *op = compiled + i;
+        position[i] = -1;
+        target[i] = -1;
+        op->flags = 0;
+        op->amount = (int16_t)mod->amount;
+        op->transform = (uint8_t)mod->transOperator;
+        if (0 == op->amount || (0 != op->transform && 2 != op->transform) || !decode_source(mod->srcOperator, &op->src, &op->srcCurve) ||
+            !decode_source(mod->amtSrcOperator, &op->amtSrc, &op->amtCurve) || SOUNDFONT_MOD_SRC_LINK == op->amtSrc) {
+            continue;
+        }
+
+        if (mod->destOperator & MOD_LINK_BIT) {
+            uint32_t origin = list->items[i].zoneFirst + (mod->destOperator & ~MOD_LINK_BIT);
+            uint32_t level = list->items[i].origin & MOD_LEVEL_PRESET;
+            for (uint32_t j = 0; j < list->count; j++) {
+                if (j != i && list->items[j].origin == (level | origin)) {
+                    target[i] = (int32_t)j;
+                }
+            }
+            if (target[i] < 0) {
+                continue;
+            }
+            op->flags = SOUNDFONT_MOD_LINKED;
+        } else if (mod->destOperator >= SOUNDFONT_GEN_COUNT) {
+            continue;
+        } else {
+            op->dest = mod->destOperator;
+        }
+        position[i] = 0;  // valid
+    }
+
+    // depth is the number of link hops down to a generator; chains longer than the list are cycles
+    for (uint32_t i = 0; i < list->count; i++) {
+        depth[i] = 0;
+        int32_t j = (int32_t)i;
+        while (position[j] >= 0 && target[j] >= 0 && depth[i] <= list->count) {
+            j = target[j];
+            depth[i]++;
+        }
+        if (position[j] < 0 || depth[i] > list->count) {
+            position[i] = -1;
+        }
+    }
+    for (uint32_t d = list->count + 1; d-- > 0;) {
+        for (uint32_t i = 0; i < list->count; i++) {
+            if (position[i] >= 0 && depth[i] == d) {
+                position[i] = count;
+                ops[count++] = compiled[i];
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < list->count; i++) {
+        if (position[i] < 0) {
+            continue;
+        }
+        SoundFontModOp *op = ops + position[i];
+        if (op->flags & SOUNDFONT_MOD_LINKED) {
+            op->dest = (uint16_t)position[target[i]];
+        }
+        depends[op->src >> 5] |= 1u << (op->src & 31);
+        depends[op->amtSrc >> 5] |= 1u << (op->amtSrc & 31);
+    }
+
+    return count;
+}
+
+static float source_value(const SoundFontModTable *table, uint8_t src, uint8_t curve, const SoundFontModVoice *voice, const SoundFontModInputs *inputs) {
+    uint8_t value;
+    switch (src) {
+        case SOUNDFONT_MOD_SRC_NONE:
+            return 1.0f;
+        case SOUNDFONT_MOD_SRC_VELOCITY:
+            value = voice->velocity;
+            break;
+        case SOUNDFONT_MOD_SRC_KEY:
+            value = voice->key;
+            break;
+        case SOUNDFONT_MOD_SRC_POLY_PRESSURE:
+            value = inputs->polyPressure[voice->key & 0x7F];
+            break;
+        case SOUNDFONT_MOD_SRC_CHANNEL_PRESSURE:
+            value = inputs->channelPressure;
+            break;
+        case SOUNDFONT_MOD_SRC_PITCH_SENSITIVITY:
+            // a count of semitones rather than a controller position: over 127 so that the
+            // default modulator's amount of 12700 bends 100 cents per semitone
+            return inputs->pitchSensitivity / 127.0f;
+        case SOUNDFONT_MOD_SRC_PITCH_WHEEL: {
+            // 14-bit input, interpolated between the 7-bit points of the curve
+            const float *points = table->curves[curve] + (inputs->pitchWheel >> 7);
+            return points[0] + (points[1] - points[0]) * (float)(inputs->pitchWheel & 0x7F) * (1.0f / 128.0f);
+        }
+        default:
+            value = src < SOUNDFONT_MOD_SRC_GENERAL ? inputs->cc[src] : 0;
+            break;
+    }
+
+    return table->curves[curve][value & 0x7F];
+}
+
+// a link input is the sum of the ops feeding it, taken over the amount range as a bipolar value
+static float evaluate_op(const SoundFontModVoice *voice, const SoundFontModOp *ops, uint16_t i, const SoundFontModInputs *inputs) {
+    const SoundFontModOp *op = ops + i;
+    float x;
+    if (SOUNDFONT_MOD_SRC_LINK == op->src) {
+        x = 0.0f;
+        for (uint16_t j = 0; j < i; j++) {
+            if ((ops[j].flags & SOUNDFONT_MOD_LINKED) && ops[j].dest == i) {
+                x += voice->out[j];
+            }
+        }
+        x /= 32768.0f;
+        x = x < -1.0f ? -1.0f : (x > 1.0f ? 1.0f : x);
+    } else {
+        x = source_value(voice->table, op->src, op->srcCurve, voice, inputs);
+    }
+
+    float y = op->amount * x * source_value(voice->table, op->amtSrc, op->amtCurve, voice, inputs);
+    return 2 == op->transform ? fabsf(y) : y;
+}
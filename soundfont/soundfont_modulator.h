@@ -0,0 +1,118 @@
+/*
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#ifndef CMANLH_SOUNDFONT_MODULATOR
+#define CMANLH_SOUNDFONT_MODULATOR
+
+#include "soundfont_region.h"
+#include "soundfont_zone.h"
+
+#define SOUNDFONT_MOD_MAX_OPS 64  // modulators a voice evaluates, longer merged lists are cut
+
+/*
+    Modulator inputs as one byte: MIDI continuous controllers keep their number, the general
+    controllers of the spec are offset by SOUNDFONT_MOD_SRC_GENERAL.
+*/
+#define SOUNDFONT_MOD_SRC_GENERAL 128
+#define SOUNDFONT_MOD_SRC_NONE (SOUNDFONT_MOD_SRC_GENERAL + 0)
+#define SOUNDFONT_MOD_SRC_VELOCITY (SOUNDFONT_MOD_SRC_GENERAL + 2)
+#define SOUNDFONT_MOD_SRC_KEY (SOUNDFONT_MOD_SRC_GENERAL + 3)
+#define SOUNDFONT_MOD_SRC_POLY_PRESSURE (SOUNDFONT_MOD_SRC_GENERAL + 10)
+#define SOUNDFONT_MOD_SRC_CHANNEL_PRESSURE (SOUNDFONT_MOD_SRC_GENERAL + 13)
+#define SOUNDFONT_MOD_SRC_PITCH_WHEEL (SOUNDFONT_MOD_SRC_GENERAL + 14)
+#define SOUNDFONT_MOD_SRC_PITCH_SENSITIVITY (SOUNDFONT_MOD_SRC_GENERAL + 16)
+#define SOUNDFONT_MOD_SRC_LINK (SOUNDFONT_MOD_SRC_GENERAL + 127)
+
+#define SOUNDFONT_MOD_CURVES 16   // type (4) x polarity (2) x direction (2)
+#define SOUNDFONT_MOD_CURVE_SIZE 129  // x = i / 128, plus one point to interpolate 14-bit inputs against
+
+#define SOUNDFONT_MOD_LINKED 1  // dest is the index of another op of the program, not a generator
+
+// one modulator after merging, with its source operators reduced to an input and a curve table
+typedef struct SoundFontModOp {
+    uint8_t src;
+    uint8_t srcCurve;
+    uint8_t amtSrc;
+    uint8_t amtCurve;
+    uint16_t dest;
+    int16_t amount;
+    uint8_t transform;  // 0 linear, 2 absolute value
+    uint8_t flags;
+} SoundFontModOp;
+
+/*
+    The modulators of one region: the default modulators overridden by the instrument global and
+    local zones, followed by the preset global and local modulators which add on top. Ops are in
+    evaluation order, links before the ops they feed.
+*/
+typedef struct SoundFontModProgram {
+    uint32_t first;  // into ops
+    uint16_t count;
+    uint32_t depends[8];  // bit set of the inputs the program reads
+} SoundFontModProgram;
+
+typedef struct SoundFontModTable {
+    void *memory;
+    SoundFontModOp *ops;
+    uint32_t opCount;
+    SoundFontModProgram *programs;  // indexed like SoundFontRegionIndex.regions
+    uint32_t programCount;
+    float (*curves)[SOUNDFONT_MOD_CURVE_SIZE];
+} SoundFontModTable;
+
+// the controller state of one MIDI channel
+typedef struct SoundFontModInputs {
+    uint8_t cc[128];
+    uint8_t polyPressure[128];
+    uint8_t channelPressure;
+    uint8_t pitchSensitivity;  // semitones
+    uint16_t pitchWheel;       // 14 bits, 8192 is the centre
+} SoundFontModInputs;
+
+/*
+    Modulation of one voice. mod holds the summed offsets per generator in the generator's units;
+    dirty collects the generators whose offset changed since the caller last cleared it.
+*/
+typedef struct SoundFontModVoice {
+    const SoundFontModTable *table;
+    const SoundFontModProgram *program;
+    uint8_t key;
+    uint8_t velocity;
+    float out[SOUNDFONT_MOD_MAX_OPS];
+    float mod[SOUNDFONT_GEN_COUNT];
+    uint64_t dirty;
+} SoundFontModVoice;
+
+void soundfont_init_mods(SoundFontModTable *table);
+bool soundfont_build_mods(SoundFontModTable *table, const SoundFontPdtaData *pdta, const SoundFontRegionIndex *regions);
+void soundfont_release_mods(SoundFontModTable *table);
+
+void soundfont_mod_inputs_reset(SoundFontModInputs *inputs);
+bool soundfont_mod_set_input(SoundFontModInputs *inputs, uint8_t src, uint8_t key, uint16_t value);
+
+void soundfont_mod_voice_start(SoundFontModVoice *voice, const SoundFontModTable *table, uint32_t region, uint8_t key, uint8_t velocity,
+                               const SoundFontModInputs *inputs);
+bool soundfont_mod_voice_update(SoundFontModVoice *voice, const SoundFontModInputs *inputs, uint8_t src);
+
+#endif
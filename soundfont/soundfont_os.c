@@ -0,0 +1,423 @@
+/*
+    RIFF file process library
+
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "soundfont_os.h"
+#include "soundfont_stats.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+static DWORD WINAPI thread_entry(LPVOID arg);
+#else
+static void *thread_entry(void *arg);
+#endif
+
+double soundfont_os_now(void) {
+#ifdef _WIN32
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+int64_t soundfont_os_tell(FILE *file) {
+#ifdef _WIN32
+    return _ftelli64(file);
+#else
+    return ftello(file);
+#endif
+}
+
+bool soundfont_os_seek(FILE *file, int64_t offset) {
+#ifdef _WIN32
+    return 0 == _fseeki64(file, offset, SEEK_SET);
+#else
+    return 0 == fseeko(file, (off_t)offset, SEEK_SET);
+#endif
+}
+
+int64_t soundfont_os_file_size(FILE *file) {
+#ifdef _WIN32
+    struct _stat64 st;
+    if (0 != _fstat64(_fileno(file), &st)) {
+        return -1;
+    }
+#else
+    struct stat st;
+    if (0 != fstat(fileno(file), &st)) {
+        return -1;
+    }
+#endif
+    return (int64_t)st.st_size;
+}
+
+// last modification in the finest unit the system keeps, only ever compared for equality; -1 on failure
+int64_t soundfont_os_file_time(FILE *file) {
+#ifdef _WIN32
+    FILETIME written;
+    if (!GetFileTime((HANDLE)_get_osfhandle(_fileno(file)), NULL, NULL, &written)) {
+        return -1;
+    }
+    return (int64_t)((uint64_t)written.dwHighDateTime << 32 | written.dwLowDateTime);
+#else
+    struct stat st;
+    if (0 != fstat(fileno(file), &st)) {
+        return -1;
+    }
+    return (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+}
+
+/*
+    Reads size bytes at offset, and several threads may read one file at once. pread leaves the
+    stream position alone, but on Windows ReadFile moves the file pointer of the handle under the
+    stream, so a caller going on with sequential reads of the FILE must seek it first. Returns
+    false unless every byte was read.
+*/
+bool soundfont_os_read_at(FILE *file, void *buffer, size_t size, int64_t offset) {
+    uint8_t *out = (uint8_t *)buffer;
+    while (size > 0) {
+#ifdef _WIN32
+        OVERLAPPED overlapped;
+        memset(&overlapped, 0, sizeof(OVERLAPPED));
+        overlapped.Offset = (DWORD)(offset & 0xFFFFFFFF);
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD chunk = size > 0x40000000 ? 0x40000000 : (DWORD)size;
+        DWORD done = 0;
+        if (!ReadFile((HANDLE)_get_osfhandle(_fileno(file)), out, chunk, &done, &overlapped) || 0 == done) {
+            return false;
+        }
+#else
+        ssize_t done = pread(fileno(file), out, size, (off_t)offset);
+        if (done <= 0) {
+            return false;
+        }
+#endif
+        out += done;
+        offset += done;
+        size -= (size_t)done;
+        SOUNDFONT_STATS_ADD(SOUNDFONT_COUNT_BYTES_READ, done);
+    }
+
+    return true;
+}
+
+bool soundfont_os_map(SoundFontMapping *mapping, FILE *file, int64_t offset, size_t size) {
+    mapping->base = NULL;
+    mapping->size = 0;
+    mapping->data = NULL;
+
+    if (offset < 0 || size == 0) {
+        return false;
+    }
+
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    int64_t granularity = info.dwAllocationGranularity;
+    int64_t alignedOffset = offset - offset % granularity;
+    size_t mapSize = (size_t)(offset - alignedOffset) + size;
+
+    HANDLE handle = (HANDLE)_get_osfhandle(_fileno(file));
+    if (INVALID_HANDLE_VALUE == handle) {
+        return false;
+    }
+    HANDLE section = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (NULL == section) {
+        return false;
+    }
+    void *base = MapViewOfFile(section, FILE_MAP_READ, (DWORD)(alignedOffset >> 32), (DWORD)(alignedOffset & 0xFFFFFFFF), mapSize);
+    // the view keeps the section alive on its own
+    CloseHandle(section);
+    if (NULL == base) {
+        return false;
+    }
+#else
+    int64_t granularity = sysconf(_SC_PAGESIZE);
+    int64_t alignedOffset = offset - offset % granularity;
+    size_t mapSize = (size_t)(offset - alignedOffset) + size;
+
+    void *base = mmap(NULL, mapSize, PROT_READ, MAP_SHARED, fileno(file), (off_t)alignedOffset);
+    if (MAP_FAILED == base) {
+        return false;
+    }
+#endif
+
+    mapping->base = base;
+    mapping->size = mapSize;
+    mapping->data = (uint8_t *)base + (offset - alignedOffset);
+
+    return true;
+}
+
+void soundfont_os_unmap(SoundFontMapping *mapping) {
+    if (NULL == mapping->base) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(mapping->base);
+#else
+    munmap(mapping->base, mapping->size);
+#endif
+    mapping->base = NULL;
+    mapping->size = 0;
+    mapping->data = NULL;
+}
+
+void soundfont_os_advise(void *data, size_t size, SoundFontAdvice advice) {
+    if (NULL == data || size == 0) {
+        return;
+    }
+#ifdef _WIN32
+    // only the prefetch hint has a counterpart on windows
+    if (SOUNDFONT_ADVICE_WILLNEED == advice) {
+        WIN32_MEMORY_RANGE_ENTRY range;
+        range.VirtualAddress = data;
+        range.NumberOfBytes = size;
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    }
+#else
+    // posix_madvise wants a page aligned start address
+    uintptr_t pageSize = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)data & ~(pageSize - 1);
+    size_t length = size + ((uintptr_t)data - start);
+
+    int hint = POSIX_MADV_NORMAL;
+    switch (advice) {
+        case SOUNDFONT_ADVICE_SEQUENTIAL:
+            hint = POSIX_MADV_SEQUENTIAL;
+            break;
+        case SOUNDFONT_ADVICE_RANDOM:
+            hint = POSIX_MADV_RANDOM;
+            break;
+        case SOUNDFONT_ADVICE_WILLNEED:
+            hint = POSIX_MADV_WILLNEED;
+            break;
+        default:
+            break;
+    }
+    posix_madvise((void *)start, length, hint);
+#endif
+}
+
+// thread must stay at the same address until it is joined
+bool soundfont_os_thread_start(SoundFontThread *thread, SoundFontThreadMain main, void *arg) {
+    thread->main = main;
+    thread->arg = arg;
+#ifdef _WIN32
+    thread->handle = CreateThread(NULL, 0, thread_entry, thread, 0, NULL);
+    return NULL != thread->handle;
+#else
+    thread->handle = malloc(sizeof(pthread_t));
+    if (NULL == thread->handle) {
+        return false;
+    }
+    if (0 != pthread_create((pthread_t *)thread->handle, NULL, thread_entry, thread)) {
+        free(thread->handle);
+        thread->handle = NULL;
+        return false;
+    }
+    return true;
+#endif
+}
+
+void soundfont_os_thread_join(SoundFontThread *thread) {
+    if (NULL == thread->handle) {
+        return;
+    }
+#ifdef _WIN32
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+#else
+    pthread_join(*(pthread_t *)thread->handle, NULL);
+    free(thread->handle);
+#endif
+    thread->handle = NULL;
+}
+
+uint32_t soundfont_os_cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (uint32_t)count : 1;
+#endif
+}
+
+bool soundfont_os_lock_create(SoundFontLock *lock) {
+#ifdef _WIN32
+    lock->handle = malloc(sizeof(CRITICAL_SECTION));
+    if (NULL == lock->handle) {
+        return false;
+    }
+    InitializeCriticalSection((CRITICAL_SECTION *)lock->handle);
+#else
+    lock->handle = malloc(sizeof(pthread_mutex_t));
+    if (NULL == lock->handle) {
+        return false;
+    }
+    if (0 != pthread_mutex_init((pthread_mutex_t *)lock->handle, NULL)) {
+        free(lock->handle);
+        lock->handle = NULL;
+        return false;
+    }
+#endif
+    return true;
+}
+
+void soundfont_os_lock_destroy(SoundFontLock *lock) {
+    if (NULL == lock->handle) {
+        return;
+    }
+#ifdef _WIN32
+    DeleteCriticalSection((CRITICAL_SECTION *)lock->handle);
+#else
+    pthread_mutex_destroy((pthread_mutex_t *)lock->handle);
+#endif
+    free(lock->handle);
+    lock->handle = NULL;
+}
+
+void soundfont_os_lock(SoundFontLock *lock) {
+#ifdef _WIN32
+    EnterCriticalSection((CRITICAL_SECTION *)lock->handle);
+#else
+    pthread_mutex_lock((pthread_mutex_t *)lock->handle);
+#endif
+}
+
+void soundfont_os_unlock(SoundFontLock *lock) {
+#ifdef _WIN32
+    LeaveCriticalSection((CRITICAL_SECTION *)lock->handle);
+#else
+    pthread_mutex_unlock((pthread_mutex_t *)lock->handle);
+#endif
+}
+
+bool soundfont_os_signal_create(SoundFontSignal *signal) {
+#ifdef _WIN32
+    signal->handle = malloc(sizeof(CONDITION_VARIABLE));
+    if (NULL == signal->handle) {
+        return false;
+    }
+    InitializeConditionVariable((CONDITION_VARIABLE *)signal->handle);
+#else
+    signal->handle = malloc(sizeof(pthread_cond_t));
+    if (NULL == signal->handle) {
+        return false;
+    }
+    if (0 != pthread_cond_init((pthread_cond_t *)signal->handle, NULL)) {
+        free(signal->handle);
+        signal->handle = NULL;
+        return false;
+    }
+#endif
+    return true;
+}
+
+void soundfont_os_signal_destroy(SoundFontSignal *signal) {
+    if (NULL == signal->handle) {
+        return;
+    }
+#ifndef _WIN32
+    pthread_cond_destroy((pthread_cond_t *)signal->handle);
+#endif
+    free(signal->handle);
+    signal->handle = NULL;
+}
+
+// lock must be held; returns after a notify, a timeout of seconds or a spurious wake-up
+void soundfont_os_signal_wait(SoundFontSignal *signal, SoundFontLock *lock, double seconds) {
+#ifdef _WIN32
+    SleepConditionVariableCS((CONDITION_VARIABLE *)signal->handle, (CRITICAL_SECTION *)lock->handle, (DWORD)(seconds * 1000.0));
+#else
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    int64_t nanoseconds = deadline.tv_nsec + (int64_t)(seconds * 1e9);
+    deadline.tv_sec += (time_t)(nanoseconds / 1000000000);
+    deadline.tv_nsec = (long)(nanoseconds % 1000000000);
+    pthread_cond_timedwait((pthread_cond_t *)signal->handle, (pthread_mutex_t *)lock->handle, &deadline);
+#endif
+}
+
+// wakes one waiting thread; callers need not hold the lock
+void soundfont_os_signal_notify(SoundFontSignal *signal) {
+#ifdef _WIN32
+    WakeConditionVariable((CONDITION_VARIABLE *)signal->handle);
+#else
+    pthread_cond_signal((pthread_cond_t *)signal->handle);
+#endif
+}
+
+// wakes every waiting thread; callers need not hold the lock
+void soundfont_os_signal_broadcast(SoundFontSignal *signal) {
+#ifdef _WIN32
+    WakeAllConditionVariable((CONDITION_VARIABLE *)signal->handle);
+#else
+    pthread_cond_broadcast((pthread_cond_t *)signal->handle);
+#endif
+}
+
+#ifdef _WIN32
+static DWORD WINAPI thread_entry(LPVOID arg) {
+    SoundFontThread *thread = (SoundFontThread *)arg;
+    thread->main(thread->arg);
+    soundfont_stats_release();
+    return 0;
+}
+#else
+static void *thread_entry(void *arg) {
+    SoundFontThread *thread = (SoundFontThread *)arg;
+    thread->main(thread->arg);
+    soundfont_stats_release();
+    return NULL;
+}
+#endif
@@ -0,0 +1,95 @@
+/*
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#ifndef CMANLH_SOUNDFONT_OS
+#define CMANLH_SOUNDFONT_OS
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#if defined(_WIN32) || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define SOUNDFONT_LITTLE_ENDIAN 1  // the in-memory layout of integers matches RIFF
+#endif
+
+#define SOUNDFONT_CACHE_LINE 64  // what data written by different threads is kept apart by
+
+typedef enum SoundFontAdvice {
+    SOUNDFONT_ADVICE_NORMAL,
+    SOUNDFONT_ADVICE_SEQUENTIAL,  // the region will be read front to back once
+    SOUNDFONT_ADVICE_RANDOM,      // disable read-ahead, pages are touched sparsely
+    SOUNDFONT_ADVICE_WILLNEED     // start paging the region in asynchronously
+} SoundFontAdvice;
+
+typedef struct SoundFontMapping {
+    void *base;   // page aligned address returned by the system
+    size_t size;  // length of the whole mapping
+    uint8_t *data;  // the requested offset inside the mapping
+} SoundFontMapping;
+
+typedef void (*SoundFontThreadMain)(void *arg);
+
+typedef struct SoundFontThread {
+    void *handle;  // a HANDLE on windows, a heap allocated pthread_t elsewhere
+    SoundFontThreadMain main;
+    void *arg;
+} SoundFontThread;
+
+typedef struct SoundFontLock {
+    void *handle;  // a heap allocated CRITICAL_SECTION on windows, pthread_mutex_t elsewhere
+} SoundFontLock;
+
+typedef struct SoundFontSignal {
+    void *handle;  // a heap allocated CONDITION_VARIABLE on windows, pthread_cond_t elsewhere
+} SoundFontSignal;
+
+double soundfont_os_now(void);  // monotonic clock in seconds
+
+int64_t soundfont_os_tell(FILE *file);
+bool soundfont_os_seek(FILE *file, int64_t offset);
+int64_t soundfont_os_file_size(FILE *file);
+int64_t soundfont_os_file_time(FILE *file);  // last modification in the finest unit the system keeps
+bool soundfont_os_read_at(FILE *file, void *buffer, size_t size, int64_t offset);
+
+bool soundfont_os_map(SoundFontMapping *mapping, FILE *file, int64_t offset, size_t size);
+void soundfont_os_unmap(SoundFontMapping *mapping);
+void soundfont_os_advise(void *data, size_t size, SoundFontAdvice advice);
+
+bool soundfont_os_thread_start(SoundFontThread *thread, SoundFontThreadMain main, void *arg);
+void soundfont_os_thread_join(SoundFontThread *thread);
+uint32_t soundfont_os_cpu_count(void);
+
+bool soundfont_os_lock_create(SoundFontLock *lock);
+void soundfont_os_lock_destroy(SoundFontLock *lock);
+void soundfont_os_lock(SoundFontLock *lock);
+void soundfont_os_unlock(SoundFontLock *lock);
+
+bool soundfont_os_signal_create(SoundFontSignal *signal);
+void soundfont_os_signal_destroy(SoundFontSignal *signal);
+void soundfont_os_signal_wait(SoundFontSignal *signal, SoundFontLock *lock, double seconds);
+void soundfont_os_signal_notify(SoundFontSignal *signal);
+void soundfont_os_signal_broadcast(SoundFontSignal *signal);
+
+#endif
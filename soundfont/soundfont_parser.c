@@ -0,0 +1,260 @@
+/*
+    RIFF file process library
+
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#include "soundfont_parser.h"
+
+typedef struct Parser {
+    FILE *file;           // NULL when parsing a memory buffer
+    const uint8_t *data;  // the memory buffer
+    int64_t size;         // bytes of the file or the buffer
+    int64_t position;     // where the next fetch starts
+    uint8_t *scratch;     // SOUNDFONT_PARSER_SCRATCH bytes plus a terminator
+    const SoundFontParseHandler *handler;
+    bool stopped;  // a callback asked to stop
+} Parser;
+
+typedef union ParseRecord {
+    SoundFontPresetHeader presetHeader;
+    SoundFontPresetIndex presetIndex;
+    SoundFontMod mod;
+    SoundFontGen gen;
+    SoundFontPresetInst presetInst;
+    SoundFontPresetIbag presetIbag;
+    SoundFontSample sample;
+} ParseRecord;
+
+static bool parse(Parser *parser);
+static bool parse_list(Parser *parser, const uint8_t *type, int64_t listEnd);
+static bool parse_info(Parser *parser, const char *fourcc, uint32_t size);
+static bool parse_samples(Parser *parser, const char *fourcc, uint32_t size);
+static bool parse_records(Parser *parser, SoundFontRecordType type, uint32_t size);
+static const uint8_t *fetch(Parser *parser, uint32_t size);
+static bool skip_to(Parser *parser, int64_t position);
+
+bool soundfont_parse_file(FILE *file, const SoundFontParseHandler *handler) {
+    Parser parser;
+    memset(&parser, 0, sizeof(Parser));
+    parser.file = file;
+    parser.size = soundfont_os_file_size(file);
+    parser.position = soundfont_os_tell(file);
+    parser.handler = handler;
+    parser.scratch = (uint8_t *)malloc(SOUNDFONT_PARSER_SCRATCH + 1);
+    if (NULL == parser.scratch) {
+        printf("Not enough memory for parsing.\n");
+        return false;
+    }
+
+    bool ok = parse(&parser);
+    free(parser.scratch);
+
+    return ok;
+}
+
+bool soundfont_parse_memory(const uint8_t *data, size_t size, const SoundFontParseHandler *handler) {
+    Parser parser;
+    memset(&parser, 0, sizeof(Parser));
+    parser.data = data;
+    parser.size = (int64_t)size;
+    parser.handler = handler;
+    // only INFO fields are copied, to terminate them
+    parser.scratch = (uint8_t *)malloc(SOUNDFONT_PARSER_SCRATCH + 1);
+    if (NULL == parser.scratch) {
+        printf("Not enough memory for parsing.\n");
+        return false;
+    }
+
+    bool ok = parse(&parser);
+    free(parser.scratch);
+
+    return ok;
+}
+
+static bool parse(Parser *parser) {
+    const uint8_t *header = fetch(parser, 12);
+    if (NULL == header || 0 != memcmp(header, "RIFF", 4) || 0 != memcmp(header + 8, "sfbk", 4)) {
+        printf("Not a sound font 2 file.\n");
+        return false;
+    }
+    int64_t riffEnd = parser->position + soundfont_read_u32(header + 4) - 4;
+
+    while (!parser->stopped && riffEnd - parser->position >= 8) {
+        const uint8_t *chunk = fetch(parser, 8);
+        if (NULL == chunk) {
+            return false;
+        }
+        uint32_t size = soundfont_read_u32(chunk + 4);
+        int64_t chunkEnd = parser->position + size;
+        if (0 == memcmp(chunk, "LIST", 4) && size >= 4) {
+            const uint8_t *type = fetch(parser, 4);
+            if (NULL == type || !parse_list(parser, type, chunkEnd)) {
+                return false;
+            }
+        }
+        // the pad byte of the last chunk may be missing
+        chunkEnd += size & 1;
+        if (!parser->stopped && !skip_to(parser, chunkEnd < parser->size ? chunkEnd : parser->size)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool parse_list(Parser *parser, const uint8_t *type, int64_t listEnd) {
+    char list[5];
+    memcpy(list, type, 4);
+    list[4] = '\0';
+
+    while (!parser->stopped && listEnd - parser->position >= 8) {
+        const uint8_t *chunk = fetch(parser, 8);
+        if (NULL == chunk) {
+            return false;
+        }
+        char fourcc[5];
+        memcpy(fourcc, chunk, 4);
+        fourcc[4] = '\0';
+        uint32_t size = soundfont_read_u32(chunk + 4);
+        if (size > listEnd - parser->position) {
+            printf("Broken %s chunk in the %s list.\n", fourcc, list);
+            return false;
+        }
+        int64_t chunkEnd = parser->position + size;
+
+        bool ok = true;
+        if (0 == strcmp(list, "INFO")) {
+            ok = NULL == parser->handler->info || parse_info(parser, fourcc, size);
+        } else if (0 == strcmp(list, "sdta")) {
+            if (NULL != parser->handler->samples && (0 == strcmp(fourcc, "smpl") || 0 == strcmp(fourcc, "sm24"))) {
+                ok = parse_samples(parser, fourcc, size);
+            }
+        } else if (0 == strcmp(list, "pdta")) {
+            SoundFontRecordType recordType = soundfont_record_type(fourcc);
+            if (NULL != parser->handler->record && SOUNDFONT_RECORD_TYPES != recordType && 0 != (parser->handler->records & 1u << recordType)) {
+                ok = parse_records(parser, recordType, size);
+            }
+        }
+        if (!ok) {
+            return false;
+        }
+
+        // RIFF pads odd sized chunks to a word boundary
+        chunkEnd += size & 1;
+        if (!parser->stopped && !skip_to(parser, chunkEnd < listEnd ? chunkEnd : listEnd)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool parse_info(Parser *parser, const char *fourcc, uint32_t size) {
+    // longer fields than the specification allows are cut to the scratch size
+    uint32_t length = size < SOUNDFONT_PARSER_SCRATCH ? size : SOUNDFONT_PARSER_SCRATCH;
+    const uint8_t *data = fetch(parser, length);
+    if (NULL == data) {
+        return false;
+    }
+    if (data != parser->scratch) {
+        memcpy(parser->scratch, data, length);
+    }
+    parser->scratch[length] = '\0';
+    parser->stopped = !parser->handler->info(parser->handler->user, fourcc, parser->scratch, length);
+
+    return true;
+}
+
+static bool parse_samples(Parser *parser, const char *fourcc, uint32_t size) {
+    // a memory buffer is handed out whole, a file in scratch sized blocks
+    uint32_t blockSize = NULL != parser->file ? SOUNDFONT_PARSER_SCRATCH : size;
+    for (uint32_t offset = 0; offset < size && !parser->stopped;) {
+        uint32_t length = size - offset < blockSize ? size - offset : blockSize;
+        const uint8_t *data = fetch(parser, length);
+        if (NULL == data) {
+            return false;
+        }
+        parser->stopped = !parser->handler->samples(parser->handler->user, fourcc, offset, data, length);
+        offset += length;
+    }
+
+    return true;
+}
+
+static bool parse_records(Parser *parser, SoundFontRecordType type, uint32_t size) {
+    uint32_t recordSize = soundfont_record_size(type);
+    if (size % recordSize != 0) {
+        printf("Broken pdta records of %u bytes in a chunk of %u bytes.\n", recordSize, size);
+        return false;
+    }
+
+    uint32_t count = size / recordSize;
+    uint32_t batch = SOUNDFONT_PARSER_SCRATCH / recordSize;
+    ParseRecord record;
+    for (uint32_t index = 0; index < count && !parser->stopped;) {
+        uint32_t records = count - index < batch ? count - index : batch;
+        const uint8_t *data = fetch(parser, records * recordSize);
+        if (NULL == data) {
+            return false;
+        }
+        for (uint32_t i = 0; i < records && !parser->stopped; i++, index++, data += recordSize) {
+            soundfont_decode_record(type, &record, data);
+            parser->stopped = !parser->handler->record(parser->handler->user, type, index, &record);
+        }
+    }
+
+    return true;
+}
+
+// size bytes at the current position, at most SOUNDFONT_PARSER_SCRATCH when reading a file
+static const uint8_t *fetch(Parser *parser, uint32_t size) {
+    if (size > parser->size - parser->position) {
+        printf("The sound font is cut short at %lld.\n", (long long)parser->size);
+        return NULL;
+    }
+    const uint8_t *data = NULL;
+    if (NULL == parser->file) {
+        data = parser->data + parser->position;
+    } else if (size == fread(parser->scratch, 1, size, parser->file)) {
+        data = parser->scratch;
+    } else {
+        printf("Failed to read the sound font.\n");
+    }
+    parser->position += size;
+
+    return data;
+}
+
+static bool skip_to(Parser *parser, int64_t position) {
+    if (position == parser->position) {
+        return true;
+    }
+    if (position > parser->size) {
+        printf("The sound font is cut short at %lld.\n", (long long)parser->size);
+        return false;
+    }
+    parser->position = position;
+
+    return NULL == parser->file || soundfont_os_seek(parser->file, position);
+}
@@ -0,0 +1,60 @@
+/*
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#ifndef CMANLH_SOUNDFONT_PARSER
+#define CMANLH_SOUNDFONT_PARSER
+
+#include "soundfont2.h"
+
+#define SOUNDFONT_PARSER_SCRATCH 65536  // the longest INFO field the specification allows (ICMT), also the smpl block size
+#define SOUNDFONT_RECORD_ALL ((1u << SOUNDFONT_RECORD_TYPES) - 1)
+
+/*
+    Every callback returns false to stop the parse. A NULL callback is not only silent: the parser
+    seeks over what it would have been given, so a scan for preset names never reads sample data.
+*/
+typedef struct SoundFontParseHandler {
+    void *user;
+    // one INFO sub-chunk, data holds its size bytes and is always terminated after them
+    bool (*info)(void *user, const char *fourcc, const uint8_t *data, uint32_t size);
+    // one decoded pdta record, record points to the struct of its SoundFontRecordType
+    bool (*record)(void *user, SoundFontRecordType type, uint32_t index, const void *record);
+    // consecutive blocks of the smpl and sm24 payloads, offset counts bytes from the payload start
+    bool (*samples)(void *user, const char *fourcc, uint32_t offset, const uint8_t *data, uint32_t size);
+    uint32_t records;  // 1 << SoundFontRecordType for every record type to emit, sub-chunks of the others are skipped
+} SoundFontParseHandler;
+
+/*
+    Walks a .sf2 once from front to back and hands out its contents as they are read, in file
+    order and whatever order the lists and sub-chunks come in; unknown chunks are skipped. Nothing
+    is allocated per record: the file is read through one scratch buffer of
+    SOUNDFONT_PARSER_SCRATCH bytes, and a memory buffer is read in place.
+
+    Returns false for a file that is not a sound font or is cut short, after the events of the
+    part that could be read. A parse stopped by a callback returns true.
+*/
+bool soundfont_parse_file(FILE *file, const SoundFontParseHandler *handler);
+bool soundfont_parse_memory(const uint8_t *data, size_t size, const SoundFontParseHandler *handler);
+
+#endif
@@ -0,0 +1,225 @@
+/*
+    RIFF file process library
+
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#include "soundfont_pool.h"
+
+#define POOL_BUCKETS 1024  // initial bucket count, doubled whenever the buffers outnumber the buckets
+
+static bool grow_buckets(SoundFontSamplePool *pool);
+
+void soundfont_init_pool(SoundFontSamplePool *pool) {
+    memset(pool, 0, sizeof(SoundFontSamplePool));
+}
+
+bool soundfont_create_pool(SoundFontSamplePool *pool) {
+    soundfont_init_pool(pool);
+    pool->buckets = (SoundFontPoolBuffer **)calloc(POOL_BUCKETS, sizeof(SoundFontPoolBuffer *));
+    if (NULL == pool->buckets || !soundfont_os_lock_create(&pool->lock)) {
+        printf("Not enough memory for the sample pool.\n");
+        soundfont_release_pool(pool);
+        return false;
+    }
+    pool->mask = POOL_BUCKETS - 1;
+
+    return true;
+}
+
+// frees every buffer still held, the fonts sharing the pool must be released before
+void soundfont_release_pool(SoundFontSamplePool *pool) {
+    for (uint32_t i = 0; NULL != pool->buckets && i <= pool->mask; i++) {
+        SoundFontPoolBuffer *buffer = pool->buckets[i];
+        while (NULL != buffer) {
+            SoundFontPoolBuffer *next = buffer->next;
+            free(buffer->points);
+            free(buffer);
+            buffer = next;
+        }
+    }
+    if (NULL != pool->buckets) {
+        free(pool->buckets);
+    }
+    soundfont_os_lock_destroy(&pool->lock);
+    soundfont_init_pool(pool);
+}
+
+/*
+    Returns a buffer holding the same frames points, taking a reference to it: the buffer of an
+    earlier caller when the points match, otherwise a new copy. Returns NULL when out of memory.
+*/
+SoundFontPoolBuffer *soundfont_pool_share(SoundFontSamplePool *pool, const int16_t *points, uint32_t frames) {
+    size_t bytes = sizeof(int16_t) * frames;
+    uint64_t hash = soundfont_hash(points, bytes);
+
+    soundfont_os_lock(&pool->lock);
+    SoundFontPoolBuffer **bucket = pool->buckets + (hash & pool->mask);
+    SoundFontPoolBuffer *buffer = *bucket;
+    // equal hashes are confirmed point by point, a collision never mixes two samples up
+    while (NULL != buffer && (buffer->hash != hash || buffer->frames != frames || 0 != memcmp(buffer->points, points, bytes))) {
+        buffer = buffer->next;
+    }
+    if (NULL == buffer) {
+        buffer = (SoundFontPoolBuffer *)malloc(sizeof(SoundFontPoolBuffer));
+        int16_t *copy = (int16_t *)malloc(bytes > 0 ? bytes : 1);
+        if (NULL == buffer || NULL == copy) {
+            soundfont_os_unlock(&pool->lock);
+            printf("Not enough memory for the sample pool.\n");
+            free(buffer);
+            free(copy);
+            return NULL;
+        }
+        memcpy(copy, points, bytes);
+        buffer->hash = hash;
+        buffer->frames = frames;
+        buffer->refs = 0;
+        buffer->points = copy;
+        buffer->next = *bucket;
+        *bucket = buffer;
+        pool->count++;
+        pool->bytes += bytes;
+        if (pool->count > pool->mask + 1) {
+            grow_buckets(pool);  // chains only get longer when it fails
+        }
+    }
+    buffer->refs++;
+    pool->requestedBytes += bytes;
+    soundfont_os_unlock(&pool->lock);
+
+    return buffer;
+}
+
+void soundfont_pool_drop(SoundFontSamplePool *pool, SoundFontPoolBuffer *buffer) {
+    soundfont_os_lock(&pool->lock);
+    pool->requestedBytes -= sizeof(int16_t) * buffer->frames;
+    if (0 == --buffer->refs) {
+        SoundFontPoolBuffer **link = pool->buckets + (buffer->hash & pool->mask);
+        while (*link != buffer) {
+            link = &(*link)->next;
+        }
+        *link = buffer->next;
+        pool->count--;
+        pool->bytes -= sizeof(int16_t) * buffer->frames;
+        free(buffer->points);
+        free(buffer);
+    }
+    soundfont_os_unlock(&pool->lock);
+}
+
+/*
+    Shares every sample of a loaded font, filling pooled with one entry per sample header. A
+    sample covers its points from start to end and the guard points around them, so two samples
+    only share a buffer when every point an interpolator can reach is the same. The font's sdta
+    may be released afterwards.
+*/
+bool soundfont_pool_samples(SoundFontSamplePool *pool, const SoundFontPdtaData *pdta, const SoundFontSdtaData *sdta, SoundFontPooledSample *pooled) {
+    uint32_t smplFrames = sdta->size / 2;
+    memset(pooled, 0, sizeof(SoundFontPooledSample) * pdta->shdrSize);
+
+    int16_t *points = NULL;
+    uint32_t capacity = 0;
+    for (uint32_t i = 0; i < pdta->shdrSize; i++) {
+        const SoundFontSample *sample = pdta->shdr + i;
+        if (NULL == sdta->data || sample->start >= sample->end || sample->end > smplFrames) {
+            continue;
+        }
+        uint32_t origin = sample->start > SOUNDFONT_STORE_GUARD ? sample->start - SOUNDFONT_STORE_GUARD : 0;
+        uint32_t frames = sample->end + SOUNDFONT_STORE_GUARD - origin;
+        if (frames > capacity) {
+            free(points);
+            capacity = frames;
+            points = (int16_t *)malloc(sizeof(int16_t) * capacity);
+            if (NULL == points) {
+                printf("Not enough memory for pooling samples.\n");
+                soundfont_pool_drop_samples(pool, pooled, i);
+                return false;
+            }
+        }
+
+        // the points past the end of smpl read as zero, the smpl points are little-endian
+        uint32_t available = smplFrames - origin < frames ? smplFrames - origin : frames;
+        const uint8_t *bytes = sdta->data + 2 * (size_t)origin;
+#ifdef SOUNDFONT_LITTLE_ENDIAN
+        memcpy(points, bytes, sizeof(int16_t) * available);
+#else
+        for (uint32_t p = 0; p < available; p++) {
+            points[p] = (int16_t)(bytes[2 * p] | bytes[2 * p + 1] << 8);
+        }
+#endif
+        memset(points + available, 0, sizeof(int16_t) * (frames - available));
+
+        pooled[i].origin = origin;
+        pooled[i].buffer = soundfont_pool_share(pool, points, frames);
+        if (NULL == pooled[i].buffer) {
+            free(points);
+            soundfont_pool_drop_samples(pool, pooled, i);
+            return false;
+        }
+    }
+    free(points);
+
+    return true;
+}
+
+void soundfont_pool_drop_samples(SoundFontSamplePool *pool, SoundFontPooledSample *pooled, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (NULL != pooled[i].buffer) {
+            soundfont_pool_drop(pool, pooled[i].buffer);
+            pooled[i].buffer = NULL;
+        }
+    }
+}
+
+bool soundfont_pool_view(const SoundFontPooledSample *pooled, const SoundFontSample *sample, SoundFontSampleView *view) {
+    if (NULL == pooled->buffer) {
+        return false;
+    }
+    soundfont_sample_view_at(view, pooled->buffer->points, pooled->buffer->frames, pooled->origin, sample);
+
+    return true;
+}
+
+// called with the lock held
+static bool grow_buckets(SoundFontSamplePool *pool) {
+    uint32_t count = (pool->mask + 1) * 2;
+    SoundFontPoolBuffer **buckets = (SoundFontPoolBuffer **)calloc(count, sizeof(SoundFontPoolBuffer *));
+    if (NULL == buckets) {
+        return false;
+    }
+    for (uint32_t i = 0; i <= pool->mask; i++) {
+        SoundFontPoolBuffer *buffer = pool->buckets[i];
+        while (NULL != buffer) {
+            SoundFontPoolBuffer *next = buffer->next;
+            SoundFontPoolBuffer **bucket = buckets + (buffer->hash & (count - 1));
+            buffer->next = *bucket;
+            *bucket = buffer;
+            buffer = next;
+        }
+    }
+    free(pool->buckets);
+    pool->buckets = buckets;
+    pool->mask = count - 1;
+
+    return true;
+}
@@ -0,0 +1,73 @@
+/*
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#ifndef CMANLH_SOUNDFONT_POOL
+#define CMANLH_SOUNDFONT_POOL
+
+#include "soundfont_store.h"
+
+typedef struct SoundFontPoolBuffer {
+    uint64_t hash;
+    uint32_t frames;  // points held
+    uint32_t refs;    // samples of all fonts pointing here, the buffer is freed with the last
+    int16_t *points;
+    struct SoundFontPoolBuffer *next;  // in the same bucket
+} SoundFontPoolBuffer;
+
+// a sample of one font resolved to its pool buffer
+typedef struct SoundFontPooledSample {
+    SoundFontPoolBuffer *buffer;  // NULL for a broken sample
+    uint32_t origin;              // smpl position of the first point of the buffer
+} SoundFontPooledSample;
+
+/*
+    Sample data shared by every font loaded into the pool. Each sample is copied out of its font's
+    smpl chunk with SOUNDFONT_STORE_GUARD points on either side, hashed, and looked up: points
+    some font already brought along are only referenced again, so fonts derived from the same
+    source hold their common samples once. Every font keeps its own pdta.
+
+    Sharing and dropping lock the pool and may run on any thread; views of a held buffer do not
+    lock at all.
+*/
+typedef struct SoundFontSamplePool {
+    SoundFontPoolBuffer **buckets;
+    uint32_t mask;         // bucket count - 1
+    uint32_t count;        // distinct buffers
+    size_t bytes;          // held by the distinct buffers
+    size_t requestedBytes;  // the buffers would take without sharing
+    SoundFontLock lock;
+} SoundFontSamplePool;
+
+void soundfont_init_pool(SoundFontSamplePool *pool);
+bool soundfont_create_pool(SoundFontSamplePool *pool);
+void soundfont_release_pool(SoundFontSamplePool *pool);
+
+SoundFontPoolBuffer *soundfont_pool_share(SoundFontSamplePool *pool, const int16_t *points, uint32_t frames);
+void soundfont_pool_drop(SoundFontSamplePool *pool, SoundFontPoolBuffer *buffer);
+
+bool soundfont_pool_samples(SoundFontSamplePool *pool, const SoundFontPdtaData *pdta, const SoundFontSdtaData *sdta, SoundFontPooledSample *pooled);
+void soundfont_pool_drop_samples(SoundFontSamplePool *pool, SoundFontPooledSample *pooled, uint32_t count);
+bool soundfont_pool_view(const SoundFontPooledSample *pooled, const SoundFontSample *sample, SoundFontSampleView *view);
+
+#endif
@@ -0,0 +1,394 @@
+/*
+    RIFF file process library
+
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#include "soundfont_prepare.h"
+
+#include <math.h>
+
+#define DECIMATE_TAPS 32         // length of the decimation filter in points of the level
+#define DECIMATE_RESOLUTION 256  // tabulated weights per point of the level
+#define DECIMATE_PHASES 256      // filter rows per sample point, fractions between two rows blend them
+#define PREPARE_MIN_LOOP 4       // shortest loop a decimated level keeps, shorter ones leave the level out
+
+// maps the points of a decimated level to positions of the sample they are filtered from
+typedef struct Decimator {
+    double ratio;        // level points per sample point
+    double anchor;       // sample position of level position levelAnchor
+    double levelAnchor;
+    const float *kernel;  // weights by distance in level points, DECIMATE_RESOLUTION per point
+    float *rows;          // DECIMATE_PHASES + 1 rows of taps weights for rowsRatio
+    uint32_t taps;        // a multiple of 4, row p weighs the source points idx - half + 1 ... for a position p / DECIMATE_PHASES past idx
+    uint32_t half;
+    double rowsRatio;
+    size_t rowsCapacity;
+    float *source;  // the sample points around the run being filtered
+    size_t capacity;
+} Decimator;
+
+static bool has_loop(const SoundFontSample *sample);
+static bool level_header(const SoundFontSample *sample, uint32_t level, SoundFontSample *header, Decimator *decimator);
+static void lay_out(SoundFontPreparedSample *entry, const SoundFontSample *header, size_t offset);
+static bool fill_level(Decimator *decimator, const uint8_t *smpl, const SoundFontSample *sample, const SoundFontPreparedSample *entry, const SoundFontSample *header, int16_t *points);
+static bool build_rows(Decimator *decimator);
+static bool load_source(Decimator *decimator, const uint8_t *smpl, const SoundFontSample *sample, int64_t first, int64_t last, bool looped);
+static void decimate_run(const Decimator *decimator, double position, uint32_t count, int16_t *points);
+static void copy_points(int16_t *dest, const uint8_t *smpl, uint32_t position, uint32_t count);
+
+void soundfont_init_prepared(SoundFontPreparedSamples *prepared) {
+    memset(prepared, 0, sizeof(SoundFontPreparedSamples));
+}
+
+/*
+    Copies every sample of a loaded font into its padded buffer, and for levels above 1 adds the
+    decimated levels up to SOUNDFONT_PREPARE_LEVELS. Samples whose points lie outside the smpl
+    chunk get no buffer, as soundfont_sample_view refuses them; a level too short to hold a point,
+    or a loop of PREPARE_MIN_LOOP points, is left out for its sample.
+*/
+bool soundfont_prepare_samples(SoundFontPreparedSamples *prepared, const SoundFontPdtaData *pdta, const SoundFontSdtaData *sdta, uint32_t levels) {
+    soundfont_init_prepared(prepared);
+    uint32_t smplFrames = sdta->size / 2;
+    if (NULL == sdta->data) {
+        printf("No sample data to prepare.\n");
+        return false;
+    }
+    prepared->count = pdta->shdrSize;
+    prepared->levels = levels < 1 ? 1 : (levels > SOUNDFONT_PREPARE_LEVELS ? SOUNDFONT_PREPARE_LEVELS : levels);
+    size_t entries = (size_t)prepared->count * prepared->levels;
+    prepared->samples = (SoundFontPreparedSample *)calloc(entries > 0 ? entries : 1, sizeof(SoundFontPreparedSample));
+    prepared->headers = (SoundFontSample *)calloc(entries > 0 ? entries : 1, sizeof(SoundFontSample));
+    if (NULL == prepared->samples || NULL == prepared->headers) {
+        printf("Not enough memory for preparing the samples.\n");
+        soundfont_release_prepared(prepared);
+        return false;
+    }
+
+    // the layout first, then one block for every buffer
+    size_t total = 0;
+    size_t sampled = 0;
+    size_t levelPoints = 0;
+    for (uint32_t level = 0; level < prepared->levels; level++) {
+        for (uint32_t i = 0; i < prepared->count; i++) {
+            const SoundFontSample *sample = pdta->shdr + i;
+            SoundFontSample *header = prepared->headers + (size_t)level * prepared->count + i;
+            if (sample->start >= sample->end || sample->end > smplFrames) {
+                continue;
+            }
+            if (0 == level) {
+                *header = *sample;
+                sampled += sample->end - sample->start;
+            } else if (!level_header(sample, level, header, NULL)) {
+                continue;
+            }
+            SoundFontPreparedSample *entry = prepared->samples + (size_t)level * prepared->count + i;
+            lay_out(entry, header, total);
+            total += entry->frames;
+            levelPoints += level > 0 ? entry->frames : 0;
+        }
+    }
+    prepared->points = (int16_t *)malloc(sizeof(int16_t) * (total > 0 ? total : 1));
+    if (NULL == prepared->points) {
+        printf("Not enough memory for preparing the samples.\n");
+        soundfont_release_prepared(prepared);
+        return false;
+    }
+    prepared->bytes = sizeof(int16_t) * total + (sizeof(SoundFontPreparedSample) + sizeof(SoundFontSample)) * entries;
+    prepared->extraBytes = prepared->bytes - sizeof(int16_t) * sampled;
+    prepared->levelBytes = sizeof(int16_t) * levelPoints;
+
+    float kernel[DECIMATE_TAPS / 2 * DECIMATE_RESOLUTION + 1];
+    double cutoff = soundfont_sinc_cutoff(DECIMATE_TAPS);
+    for (uint32_t k = 0; k <= DECIMATE_TAPS / 2 * DECIMATE_RESOLUTION; k++) {
+        kernel[k] = (float)soundfont_sinc_weight((double)k / DECIMATE_RESOLUTION, DECIMATE_TAPS, cutoff);
+    }
+
+    Decimator decimator;
+    memset(&decimator, 0, sizeof(Decimator));
+    decimator.kernel = kernel;
+    for (uint32_t level = 0; level < prepared->levels; level++) {
+        for (uint32_t i = 0; i < prepared->count; i++) {
+            const SoundFontSample *sample = pdta->shdr + i;
+            const SoundFontSample *header = prepared->headers + (size_t)level * prepared->count + i;
+            const SoundFontPreparedSample *entry = prepared->samples + (size_t)level * prepared->count + i;
+            if (0 == entry->frames) {
+                continue;
+            }
+            int16_t *points = prepared->points + entry->offset;
+            if (level > 0) {
+                level_header(sample, level, NULL, &decimator);
+                if (!fill_level(&decimator, sdta->data, sample, entry, header, points)) {
+                    free(decimator.rows);
+                    free(decimator.source);
+                    soundfont_release_prepared(prepared);
+                    return false;
+                }
+                continue;
+            }
+
+            if (0 != entry->loopCopy) {
+                // the loop itself with its wrapped neighbours, even when the loop is shorter than a guard
+                uint32_t length = sample->endLoop - sample->startLoop;
+                uint32_t first = (length - SOUNDFONT_PREPARE_GUARD % length) % length;
+                for (uint32_t p = 0, at = first; p < entry->start - SOUNDFONT_PREPARE_GUARD;) {
+                    uint32_t run = length - at < entry->start - SOUNDFONT_PREPARE_GUARD - p ? length - at : entry->start - SOUNDFONT_PREPARE_GUARD - p;
+                    copy_points(points + p, sdta->data, sample->startLoop + at, run);
+                    p += run;
+                    at = 0;
+                }
+            }
+            int16_t *body = points + entry->start;
+            memset(body - SOUNDFONT_PREPARE_GUARD, 0, sizeof(int16_t) * SOUNDFONT_PREPARE_GUARD);
+            copy_points(body, sdta->data, sample->start, sample->end - sample->start);
+            memset(body + (sample->end - sample->start), 0, sizeof(int16_t) * SOUNDFONT_PREPARE_GUARD);
+        }
+    }
+    free(decimator.rows);
+    free(decimator.source);
+
+    return true;
+}
+
+void soundfont_release_prepared(SoundFontPreparedSamples *prepared) {
+    if (NULL != prepared->points) {
+        free(prepared->points);
+    }
+    if (NULL != prepared->samples) {
+        free(prepared->samples);
+    }
+    if (NULL != prepared->headers) {
+        free(prepared->headers);
+    }
+    soundfont_init_prepared(prepared);
+}
+
+bool soundfont_prepared_view(const SoundFontPreparedSamples *prepared, uint32_t index, uint32_t level, SoundFontSampleView *view) {
+    if (index >= prepared->count || level >= prepared->levels || 0 == prepared->samples[(size_t)level * prepared->count + index].frames) {
+        return false;
+    }
+    const SoundFontPreparedSample *entry = prepared->samples + (size_t)level * prepared->count + index;
+    const SoundFontSample *header = prepared->headers + (size_t)level * prepared->count + index;
+    // positions of the buffer stand for positions of the header from its start on, with the loop copy in front of them
+    soundfont_sample_view_at(view, prepared->points + entry->offset, entry->frames, 0, header);
+    view->start = entry->start;
+    view->end = entry->start + (header->end - header->start);
+    view->startLoop = header->startLoop > header->start ? entry->start + (header->startLoop - header->start) : entry->start;
+    view->endLoop = header->endLoop > header->start ? entry->start + (header->endLoop - header->start) : entry->start;
+    view->loopCopy = entry->loopCopy;
+
+    return true;
+}
+
+static bool has_loop(const SoundFontSample *sample) {
+    return sample->start <= sample->startLoop && sample->startLoop < sample->endLoop && sample->endLoop <= sample->end;
+}
+
+/*
+    The header of a decimated level of sample, positions counted from its start, and when
+    decimator is given the mapping of its points. A loop keeps a whole number of points, the
+    nearest to its length at the level's nominal rate, and anchors the mapping at its start.
+*/
+static bool level_header(const SoundFontSample *sample, uint32_t level, SoundFontSample *header, Decimator *decimator) {
+    double scale = 1.0 / (double)(1u << level);
+    bool loop = has_loop(sample);
+    uint32_t length = sample->endLoop - sample->startLoop;
+    uint32_t levelLength = loop ? (uint32_t)lround(length * scale) : 0;
+    if (loop && levelLength < PREPARE_MIN_LOOP) {
+        return false;
+    }
+    double ratio = loop ? (double)levelLength / length : scale;
+
+    uint32_t levelLoop = loop ? (uint32_t)lround((sample->startLoop - sample->start) * ratio) : 0;
+    uint32_t end = loop ? levelLoop + levelLength + (uint32_t)floor((sample->end - sample->endLoop) * ratio) : (uint32_t)floor((sample->end - sample->start) * ratio);
+    if (end < 1) {
+        return false;
+    }
+    if (NULL != header) {
+        *header = *sample;
+        header->start = 0;
+        header->end = end;
+        header->startLoop = levelLoop;
+        header->endLoop = levelLoop + levelLength;
+        uint32_t rate = sample->sampleRate > 0 ? sample->sampleRate : 44100;
+        header->sampleRate = (uint32_t)lround(rate * ratio) > 0 ? (uint32_t)lround(rate * ratio) : 1;
+    }
+    if (NULL != decimator) {
+        decimator->ratio = ratio;
+        decimator->anchor = loop ? sample->startLoop : sample->start;
+        decimator->levelAnchor = levelLoop;
+    }
+
+    return true;
+}
+
+// the buffer of header laid out from offset on, see SoundFontPreparedSample
+static void lay_out(SoundFontPreparedSample *entry, const SoundFontSample *header, size_t offset) {
+    uint32_t copy = has_loop(header) ? header->endLoop - header->startLoop + 2 * SOUNDFONT_PREPARE_GUARD : 0;
+    entry->offset = offset;
+    entry->frames = copy + (header->end - header->start) + 2 * SOUNDFONT_PREPARE_GUARD;
+    entry->start = copy + SOUNDFONT_PREPARE_GUARD;
+    entry->loopCopy = copy > 0 ? SOUNDFONT_PREPARE_GUARD : 0;
+}
+
+// the buffer of a decimated level, laid out as the level 0 one
+static bool fill_level(Decimator *decimator, const uint8_t *smpl, const SoundFontSample *sample, const SoundFontPreparedSample *entry, const SoundFontSample *header, int16_t *points) {
+    if (!build_rows(decimator)) {
+        return false;
+    }
+    // sample points a row reaches past the first and last position of a run, with a few to spare
+    int64_t reach = (int64_t)decimator->taps - decimator->half + 2;
+    if (0 != entry->loopCopy) {
+        // the loop copy reads the sample's loop periodically, so it wraps seamlessly at the level's rate too
+        double first = decimator->anchor + ((double)header->startLoop - SOUNDFONT_PREPARE_GUARD - decimator->levelAnchor) / decimator->ratio;
+        double last = decimator->anchor + ((double)header->endLoop + SOUNDFONT_PREPARE_GUARD - decimator->levelAnchor) / decimator->ratio;
+        int64_t from = (int64_t)floor(first) - reach;
+        if (!load_source(decimator, smpl, sample, from, (int64_t)ceil(last) + reach, true)) {
+            return false;
+        }
+        decimate_run(decimator, first - from, entry->start - SOUNDFONT_PREPARE_GUARD, points);
+    }
+    double first = decimator->anchor - decimator->levelAnchor / decimator->ratio;
+    double last = decimator->anchor + ((double)header->end - decimator->levelAnchor) / decimator->ratio;
+    int64_t from = (int64_t)floor(first) - reach;
+    if (!load_source(decimator, smpl, sample, from, (int64_t)ceil(last) + reach, false)) {
+        return false;
+    }
+    int16_t *body = points + entry->start;
+    memset(body - SOUNDFONT_PREPARE_GUARD, 0, sizeof(int16_t) * SOUNDFONT_PREPARE_GUARD);
+    decimate_run(decimator, first - from, header->end, body);
+    memset(body + header->end, 0, sizeof(int16_t) * SOUNDFONT_PREPARE_GUARD);
+
+    return true;
+}
+
+// the filter rows of the decimator's ratio, kept while the ratio stays the same
+static bool build_rows(Decimator *decimator) {
+    if (NULL != decimator->rows && decimator->rowsRatio == decimator->ratio) {
+        return true;
+    }
+    uint32_t half = (uint32_t)ceil((DECIMATE_TAPS / 2) / decimator->ratio) + 1;
+    uint32_t taps = (2 * half + 3) / 4 * 4;
+    size_t size = (size_t)taps * (DECIMATE_PHASES + 1);
+    if (size > decimator->rowsCapacity) {
+        free(decimator->rows);
+        decimator->rowsCapacity = size;
+        decimator->rows = (float *)malloc(sizeof(float) * size);
+        if (NULL == decimator->rows) {
+            printf("Not enough memory for preparing the samples.\n");
+            return false;
+        }
+    }
+    decimator->taps = taps;
+    decimator->half = half;
+    decimator->rowsRatio = decimator->ratio;
+
+    const float *kernel = decimator->kernel;
+    for (uint32_t p = 0; p <= DECIMATE_PHASES; p++) {
+        float *row = decimator->rows + (size_t)p * taps;
+        double frac = (double)p / DECIMATE_PHASES;
+        double sum = 0.0;
+        for (uint32_t k = 0; k < taps; k++) {
+            // distance in level points from the read position to the point the weight applies to
+            double d = fabs((double)k - (half - 1.0) - frac) * decimator->ratio * DECIMATE_RESOLUTION;
+            uint32_t at = (uint32_t)d;
+            double weight = at < DECIMATE_TAPS / 2 * DECIMATE_RESOLUTION ? kernel[at] + (d - at) * (kernel[at + 1] - kernel[at]) : 0.0;
+            row[k] = (float)weight;
+            sum += weight;
+        }
+        // unit gain at DC, the filter sees as many source points as the level drops
+        for (uint32_t k = 0; k < taps; k++) {
+            row[k] = (float)(row[k] / sum);
+        }
+    }
+
+    return true;
+}
+
+// the sample points first to last as float into source, wrapped into the loop when looped, otherwise zero outside the sample
+static bool load_source(Decimator *decimator, const uint8_t *smpl, const SoundFontSample *sample, int64_t first, int64_t last, bool looped) {
+    size_t count = (size_t)(last - first + 1);
+    if (count > decimator->capacity) {
+        free(decimator->source);
+        decimator->capacity = count;
+        decimator->source = (float *)malloc(sizeof(float) * count);
+        if (NULL == decimator->source) {
+            printf("Not enough memory for preparing the samples.\n");
+            return false;
+        }
+    }
+    int64_t length = (int64_t)sample->endLoop - sample->startLoop;
+    for (size_t j = 0; j < count; j++) {
+        int64_t point = first + (int64_t)j;
+        if (looped) {
+            point = sample->startLoop + ((point - sample->startLoop) % length + length) % length;
+        } else if (point < sample->start || point >= sample->end) {
+            decimator->source[j] = 0.0f;
+            continue;
+        }
+        const uint8_t *bytes = smpl + 2 * point;
+        decimator->source[j] = (float)(int16_t)(bytes[0] | bytes[1] << 8);
+    }
+
+    return true;
+}
+
+/*
+    count points of a level, the first at source position position and each following one
+    1 / ratio further: the windowed sinc of the level's rate over the source points around it.
+*/
+static void decimate_run(const Decimator *decimator, double position, uint32_t count, int16_t *points) {
+    uint32_t taps = decimator->taps;
+    for (uint32_t p = 0; p < count; p++) {
+        double at = position + p / decimator->ratio;
+        double index = floor(at);
+        double phase = (at - index) * DECIMATE_PHASES;
+        uint32_t row = (uint32_t)phase;
+        float frac = (float)(phase - row);
+        const float *a = decimator->rows + (size_t)row * taps;
+        const float *b = a + taps;
+        const float *x = decimator->source + (int64_t)index - decimator->half + 1;
+        // two accumulators per row keep the additions from waiting on each other
+        float a0 = 0.0f, a1 = 0.0f, b0 = 0.0f, b1 = 0.0f;
+        for (uint32_t k = 0; k < taps; k += 4) {
+            a0 += a[k] * x[k] + a[k + 2] * x[k + 2];
+            a1 += a[k + 1] * x[k + 1] + a[k + 3] * x[k + 3];
+            b0 += b[k] * x[k] + b[k + 2] * x[k + 2];
+            b1 += b[k + 1] * x[k + 1] + b[k + 3] * x[k + 3];
+        }
+        float y = (a0 + a1) + frac * ((b0 + b1) - (a0 + a1));
+        points[p] = (int16_t)(y > 32767.0f ? 32767 : (y < -32768.0f ? -32768 : lrintf(y)));
+    }
+}
+
+// the smpl points are little-endian
+static void copy_points(int16_t *dest, const uint8_t *smpl, uint32_t position, uint32_t count) {
+    const uint8_t *bytes = smpl + 2 * (size_t)position;
+#ifdef SOUNDFONT_LITTLE_ENDIAN
+    memcpy(dest, bytes, sizeof(int16_t) * count);
+#else
+    for (uint32_t p = 0; p < count; p++) {
+        dest[p] = (int16_t)(bytes[2 * p] | bytes[2 * p + 1] << 8);
+    }
+#endif
+}
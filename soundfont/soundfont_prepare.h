@@ -0,0 +1,70 @@
+/*
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#ifndef CMANLH_SOUNDFONT_PREPARE
+#define CMANLH_SOUNDFONT_PREPARE
+
+#include "soundfont_sinc.h"
+#include "soundfont_voice.h"
+
+#define SOUNDFONT_PREPARE_GUARD (SOUNDFONT_SINC_MAX_TAPS / 2 + 1)  // points around a sample and its loop copy, as far as the widest interpolator reads
+#define SOUNDFONT_PREPARE_LEVELS 3  // the samples at their own rate, at half and at quarter rate
+
+/*
+    The buffer of one sample. When the sample has a loop the buffer opens with a copy of it,
+    SOUNDFONT_PREPARE_GUARD points of the loop's end before and of its start after, so a read
+    around either loop point sees the wrapped loop whatever the file holds there. The sample
+    points follow between two runs of SOUNDFONT_PREPARE_GUARD zero points.
+*/
+typedef struct SoundFontPreparedSample {
+    size_t offset;      // first point in SoundFontPreparedSamples.points
+    uint32_t frames;    // points of the buffer, 0 for a broken sample
+    uint32_t start;     // buffer position of the sample's start
+    uint32_t loopCopy;  // buffer position of the copied startLoop, 0 without a loop
+} SoundFontPreparedSample;
+
+/*
+    Level 0 holds the samples as the file has them. Levels 1 and 2, when asked for, hold them
+    low-pass filtered and decimated to about half and a quarter of their rate, so a voice pitched
+    up by an octave or two plays few enough points per output frame not to alias. The loop of a
+    decimated sample is rounded to whole points and the rate of the level follows the rounding,
+    so the loop keeps its pitch and stays seamless.
+*/
+typedef struct SoundFontPreparedSamples {
+    int16_t *points;
+    SoundFontPreparedSample *samples;  // count per level, level after level
+    SoundFontSample *headers;          // count per level, the positions and rate of each level's points; level 0 is the font's shdr
+    uint32_t count;
+    uint32_t levels;     // 1 without decimated copies
+    size_t bytes;        // the buffers and their index
+    size_t extraBytes;   // of bytes, what guards, loop copies and levels add to the sample points themselves
+    size_t levelBytes;   // of bytes, the decimated levels
+} SoundFontPreparedSamples;
+
+void soundfont_init_prepared(SoundFontPreparedSamples *prepared);
+bool soundfont_prepare_samples(SoundFontPreparedSamples *prepared, const SoundFontPdtaData *pdta, const SoundFontSdtaData *sdta, uint32_t levels);
+void soundfont_release_prepared(SoundFontPreparedSamples *prepared);
+bool soundfont_prepared_view(const SoundFontPreparedSamples *prepared, uint32_t index, uint32_t level, SoundFontSampleView *view);
+
+#endif
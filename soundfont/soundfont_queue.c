@@ -0,0 +1,116 @@
+/*
+    RIFF file process library
+
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#include "soundfont_queue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void soundfont_init_queue(SoundFontEventQueue *queue) {
+    memset(queue, 0, sizeof(SoundFontEventQueue));
+}
+
+// capacity is rounded up to a power of two; the cells are allocated here, never while running
+bool soundfont_create_queue(SoundFontEventQueue *queue, uint32_t capacity, SoundFontQueueMode mode) {
+    soundfont_init_queue(queue);
+
+    uint32_t size = 2;
+    while (size < capacity && size < 0x80000000u) {
+        size <<= 1;
+    }
+    queue->memory = malloc(sizeof(SoundFontEventCell) * size + SOUNDFONT_CACHE_LINE);
+    if (NULL == queue->memory) {
+        printf("Not enough memory for the event queue.\n");
+        return false;
+    }
+    queue->cells = (SoundFontEventCell *)(((uintptr_t)queue->memory + SOUNDFONT_CACHE_LINE - 1) & ~(uintptr_t)(SOUNDFONT_CACHE_LINE - 1));
+    for (uint32_t i = 0; i < size; i++) {
+        queue->cells[i].sequence = i;
+    }
+    queue->mask = size - 1;
+    queue->mode = mode;
+
+    return true;
+}
+
+void soundfont_release_queue(SoundFontEventQueue *queue) {
+    if (NULL != queue->memory) {
+        free(queue->memory);
+    }
+    soundfont_init_queue(queue);
+}
+
+/*
+    Claims the cell at tail, writes the event and publishes it by bumping the cell's sequence.
+    Returns false when the queue is full.
+*/
+bool soundfont_queue_push(SoundFontEventQueue *queue, const SoundFontEvent *event) {
+    uint32_t position = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+    SoundFontEventCell *cell;
+    for (;;) {
+        cell = queue->cells + (position & queue->mask);
+        int32_t lag = (int32_t)(__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) - position);
+        if (lag < 0) {
+            return false;  // the consumer has not read the cell a lap ago
+        }
+        if (lag > 0) {
+            position = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);  // another producer took it
+        } else if (queue->mode == SOUNDFONT_QUEUE_SPSC) {
+            __atomic_store_n(&queue->tail, position + 1, __ATOMIC_RELAXED);
+            break;
+        } else if (__atomic_compare_exchange_n(&queue->tail, &position, position + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+    cell->event = *event;
+    __atomic_store_n(&cell->sequence, position + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+// the oldest event without removing it, consumer thread only
+bool soundfont_queue_peek(const SoundFontEventQueue *queue, SoundFontEvent *event) {
+    const SoundFontEventCell *cell = queue->cells + (queue->head & queue->mask);
+    if (__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) != queue->head + 1) {
+        return false;
+    }
+    *event = cell->event;
+
+    return true;
+}
+
+// consumer thread only; the cell goes back to the producers for the next lap
+bool soundfont_queue_pop(SoundFontEventQueue *queue, SoundFontEvent *event) {
+    if (!soundfont_queue_peek(queue, event)) {
+        return false;
+    }
+    SoundFontEventCell *cell = queue->cells + (queue->head & queue->mask);
+    __atomic_store_n(&cell->sequence, queue->head + queue->mask + 1, __ATOMIC_RELEASE);
+    queue->head++;
+
+    return true;
+}
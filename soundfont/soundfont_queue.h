@@ -0,0 +1,77 @@
+/*
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#ifndef CMANLH_SOUNDFONT_QUEUE
+#define CMANLH_SOUNDFONT_QUEUE
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "soundfont_os.h"
+
+typedef enum SoundFontQueueMode {
+    SOUNDFONT_QUEUE_SPSC,  // one producer thread, pushes need no compare-and-swap
+    SOUNDFONT_QUEUE_MPSC   // any number of producer threads
+} SoundFontQueueMode;
+
+// a MIDI channel message stamped with the synth frame it takes effect at
+typedef struct SoundFontEvent {
+    uint64_t frame;
+    uint8_t status;
+    uint8_t data1;
+    uint8_t data2;
+} SoundFontEvent;
+
+typedef struct SoundFontEventCell {
+    uint32_t sequence;  // position + 1 once written, position + capacity once read
+    SoundFontEvent event;
+} SoundFontEventCell;
+
+/*
+    Bounded ring of events from control threads to the audio thread. Every cell carries a sequence
+    number, so producers and the consumer hand cells over with one acquire/release pair and never
+    lock, wait or allocate: a push into a full queue and a pop from an empty one fail at once.
+    The positions sit on cache lines of their own.
+*/
+typedef struct SoundFontEventQueue {
+    void *memory;
+    SoundFontEventCell *cells;
+    uint32_t mask;  // capacity - 1, the capacity is a power of two
+    SoundFontQueueMode mode;
+    uint8_t padding0[SOUNDFONT_CACHE_LINE];
+    uint32_t tail;  // next position to write, shared by the producers
+    uint8_t padding1[SOUNDFONT_CACHE_LINE - sizeof(uint32_t)];
+    uint32_t head;  // next position to read, owned by the consumer
+    uint8_t padding2[SOUNDFONT_CACHE_LINE - sizeof(uint32_t)];
+} SoundFontEventQueue;
+
+void soundfont_init_queue(SoundFontEventQueue *queue);
+bool soundfont_create_queue(SoundFontEventQueue *queue, uint32_t capacity, SoundFontQueueMode mode);
+void soundfont_release_queue(SoundFontEventQueue *queue);
+
+bool soundfont_queue_push(SoundFontEventQueue *queue, const SoundFontEvent *event);
+bool soundfont_queue_peek(const SoundFontEventQueue *queue, SoundFontEvent *event);
+bool soundfont_queue_pop(SoundFontEventQueue *queue, SoundFontEvent *event);
+
+#endif
@@ -0,0 +1,282 @@
+/*
+    RIFF file process library
+
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#include "soundfont_region.h"
+
+typedef struct ZoneRange {
+    uint8_t keyLo;
+    uint8_t keyHi;
+    uint8_t velLo;
+    uint8_t velHi;
+} ZoneRange;
+
+typedef struct RegionList {
+    SoundFontRegion *items;
+    uint32_t size;
+    uint32_t capacity;
+} RegionList;
+
+static bool find_gen(const SoundFontGen *gens, uint32_t first, uint32_t last, uint16_t operator, uint16_t *amount);
+static void read_zone_range(const SoundFontGen *gens, uint32_t first, uint32_t last, const ZoneRange *defaults, ZoneRange *range);
+static bool push_region(RegionList *list, const SoundFontRegion *region);
+static bool collect_instrument(RegionList *list, const SoundFontPdtaData *pdta, SoundFontRegion *region, const ZoneRange *presetRange);
+
+void soundfont_init_regions(SoundFontRegionIndex *index) {
+    index->memory = NULL;
+    index->regions = NULL;
+    index->regionCount = 0;
+    index->keyOffsets = NULL;
+    index->keyRegions = NULL;
+    index->keyRegionCount = 0;
+    index->presetCount = 0;
+}
+
+bool soundfont_build_regions(SoundFontRegionIndex *index, const SoundFontPdtaData *pdta) {
+    soundfont_init_regions(index);
+    if (!pdta->verified) {
+        printf("Regions are only built over a verified pdta.\n");
+        return false;
+    }
+    if (pdta->presetHeaderSize < 2) {
+        return true;
+    }
+    uint16_t presetCount = pdta->presetHeaderSize - 1;  // without the EOP record
+
+    RegionList list = {NULL, 0, 0};
+    uint32_t *presetFirstRegion = (uint32_t *)malloc(sizeof(uint32_t) * (presetCount + 1));
+    if (NULL == presetFirstRegion) {
+        printf("Not enough memory for building regions.\n");
+        return false;
+    }
+
+    const ZoneRange fullRange = {0, 127, 0, 127};
+    for (uint16_t p = 0; p < presetCount; p++) {
+        presetFirstRegion[p] = list.size;
+
+        uint32_t bagFirst, bagLast;
+        soundfont_pdta_preset_zones(pdta, p, &bagFirst, &bagLast);
+        ZoneRange globalRange = fullRange;
+        uint16_t globalZone = SOUNDFONT_NO_ZONE;
+
+        for (uint32_t z = bagFirst; z < bagLast; z++) {
+            uint32_t first, last;
+            soundfont_pdta_preset_gens(pdta, z, &first, &last);
+
+            uint16_t instrument;
+            if (!find_gen(pdta->presetGen, first, last, SOUNDFONT_GEN_INSTRUMENT, &instrument)) {
+                // only the first zone may be global, any other zone without an instrument is ignored
+                if (z == bagFirst) {
+                    read_zone_range(pdta->presetGen, first, last, &fullRange, &globalRange);
+                    globalZone = z;
+                }
+                continue;
+            }
+
+            ZoneRange presetRange;
+            read_zone_range(pdta->presetGen, first, last, &globalRange, &presetRange);
+
+            SoundFontRegion region;
+            region.presetZone = z;
+            region.presetGlobalZone = globalZone;
+            region.instrument = instrument;
+            if (!collect_instrument(&list, pdta, &region, &presetRange)) {
+                printf("Not enough memory for building regions.\n");
+                free(list.items);
+                free(presetFirstRegion);
+                return false;
+            }
+        }
+    }
+    presetFirstRegion[presetCount] = list.size;
+
+    // count the regions of every (preset, key) bucket, then turn the counts into offsets
+    size_t offsetCount = (size_t)presetCount * 129;
+    uint32_t *counts = (uint32_t *)calloc(offsetCount + 1, sizeof(uint32_t));
+    if (NULL == counts) {
+        printf("Not enough memory for building regions.\n");
+        free(list.items);
+        free(presetFirstRegion);
+        return false;
+    }
+    uint32_t keyRegionCount = 0;
+    for (uint16_t p = 0; p < presetCount; p++) {
+        for (uint32_t r = presetFirstRegion[p]; r < presetFirstRegion[p + 1]; r++) {
+            for (int k = list.items[r].keyLo; k <= list.items[r].keyHi; k++) {
+                counts[(size_t)p * 129 + k]++;
+                keyRegionCount++;
+            }
+        }
+    }
+
+    size_t regionBytes = sizeof(SoundFontRegion) * list.size;
+    size_t offsetBytes = sizeof(uint32_t) * (offsetCount + 1);
+    index->memory = malloc(regionBytes + offsetBytes + sizeof(uint32_t) * keyRegionCount);
+    if (NULL == index->memory) {
+        printf("Not enough memory for building regions.\n");
+        free(counts);
+        free(list.items);
+        free(presetFirstRegion);
+        return false;
+    }
+    index->regions = (SoundFontRegion *)index->memory;
+    index->keyOffsets = (uint32_t *)((uint8_t *)index->memory + regionBytes);
+    index->keyRegions = index->keyOffsets + offsetCount + 1;
+    index->regionCount = list.size;
+    index->keyRegionCount = keyRegionCount;
+    index->presetCount = presetCount;
+    if (list.size > 0) {
+        memcpy(index->regions, list.items, regionBytes);
+    }
+
+    // the 129th entry of a preset is the end of its key 127 bucket and the start of the next preset
+    uint32_t offset = 0;
+    for (size_t i = 0; i <= offsetCount; i++) {
+        index->keyOffsets[i] = offset;
+        offset += counts[i];
+        counts[i] = index->keyOffsets[i];
+    }
+    for (uint16_t p = 0; p < presetCount; p++) {
+        for (uint32_t r = presetFirstRegion[p]; r < presetFirstRegion[p + 1]; r++) {
+            for (int k = list.items[r].keyLo; k <= list.items[r].keyHi; k++) {
+                index->keyRegions[counts[(size_t)p * 129 + k]++] = r;
+            }
+        }
+    }
+
+    free(counts);
+    free(list.items);
+    free(presetFirstRegion);
+
+    return true;
+}
+
+void soundfont_release_regions(SoundFontRegionIndex *index) {
+    if (NULL != index->memory) {
+        free(index->memory);
+    }
+    soundfont_init_regions(index);
+}
+
+uint32_t soundfont_find_regions(const SoundFontRegionIndex *index, uint16_t presetNdx, uint8_t key, uint8_t velocity,
+                                const SoundFontRegion **regions, uint32_t maxRegions) {
+    if (presetNdx >= index->presetCount || key > 127) {
+        return 0;
+    }
+
+    const uint32_t *bucket = index->keyOffsets + (size_t)presetNdx * 129 + key;
+    uint32_t found = 0;
+    for (uint32_t i = bucket[0]; i < bucket[1] && found < maxRegions; i++) {
+        const SoundFontRegion *region = index->regions + index->keyRegions[i];
+        if (velocity >= region->velLo && velocity <= region->velHi) {
+            regions[found++] = region;
+        }
+    }
+
+    return found;
+}
+
+static bool find_gen(const SoundFontGen *gens, uint32_t first, uint32_t last, uint16_t operator, uint16_t *amount) {
+    for (uint32_t i = first; i < last; i++) {
+        if (gens[i].operator == operator) {
+            *amount = gens[i].amount;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void read_zone_range(const SoundFontGen *gens, uint32_t first, uint32_t last, const ZoneRange *defaults, ZoneRange *range) {
+    *range = *defaults;
+
+    uint16_t amount;
+    if (find_gen(gens, first, last, SOUNDFONT_GEN_KEY_RANGE, &amount)) {
+        range->keyLo = amount & 0xFF;
+        range->keyHi = amount >> 8;
+    }
+    if (find_gen(gens, first, last, SOUNDFONT_GEN_VEL_RANGE, &amount)) {
+        range->velLo = amount & 0xFF;
+        range->velHi = amount >> 8;
+    }
+    if (range->keyHi > 127) {
+        range->keyHi = 127;
+    }
+    if (range->velHi > 127) {
+        range->velHi = 127;
+    }
+}
+
+static bool push_region(RegionList *list, const SoundFontRegion *region) {
+    if (list->size == list->capacity) {
+        uint32_t capacity = list->capacity == 0 ? 256 : list->capacity * 2;
+        SoundFontRegion *items = (SoundFontRegion *)realloc(list->items, sizeof(SoundFontRegion) * capacity);
+        if (NULL == items) {
+            return false;
+        }
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->size++] = *region;
+
+    return true;
+}
+
+static bool collect_instrument(RegionList *list, const SoundFontPdtaData *pdta, SoundFontRegion *region, const ZoneRange *presetRange) {
+    const ZoneRange fullRange = {0, 127, 0, 127};
+    uint32_t bagFirst, bagLast;
+    soundfont_pdta_inst_zones(pdta, region->instrument, &bagFirst, &bagLast);
+    ZoneRange globalRange = fullRange;
+    region->instGlobalZone = SOUNDFONT_NO_ZONE;
+
+    for (uint32_t z = bagFirst; z < bagLast; z++) {
+        uint32_t first, last;
+        soundfont_pdta_inst_gens(pdta, z, &first, &last);
+
+        uint16_t sample;
+        if (!find_gen(pdta->iGen, first, last, SOUNDFONT_GEN_SAMPLE_ID, &sample)) {
+            if (z == bagFirst) {
+                read_zone_range(pdta->iGen, first, last, &fullRange, &globalRange);
+                region->instGlobalZone = z;
+            }
+            continue;
+        }
+
+        ZoneRange instRange;
+        read_zone_range(pdta->iGen, first, last, &globalRange, &instRange);
+
+        region->instZone = z;
+        region->sample = sample;
+        region->keyLo = instRange.keyLo > presetRange->keyLo ? instRange.keyLo : presetRange->keyLo;
+        region->keyHi = instRange.keyHi < presetRange->keyHi ? instRange.keyHi : presetRange->keyHi;
+        region->velLo = instRange.velLo > presetRange->velLo ? instRange.velLo : presetRange->velLo;
+        region->velHi = instRange.velHi < presetRange->velHi ? instRange.velHi : presetRange->velHi;
+        if (region->keyLo <= region->keyHi && region->velLo <= region->velHi && !push_region(list, region)) {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,71 @@
+/*
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#ifndef CMANLH_SOUNDFONT_REGION
+#define CMANLH_SOUNDFONT_REGION
+
+#include "soundfont2.h"
+
+#define SOUNDFONT_NO_ZONE 0xFFFF
+
+/*
+    One playable (preset zone, instrument zone, sample) triple, with the key and velocity
+    ranges of both levels already intersected.
+*/
+typedef struct SoundFontRegion {
+    uint16_t presetZone;        // index into presetIndex
+    uint16_t presetGlobalZone;  // global zone of the preset, SOUNDFONT_NO_ZONE if none
+    uint16_t instZone;          // index into presetIbag
+    uint16_t instGlobalZone;    // global zone of the instrument, SOUNDFONT_NO_ZONE if none
+    uint16_t instrument;        // index into presetInst
+    uint16_t sample;            // index into shdr
+    uint8_t keyLo;
+    uint8_t keyHi;
+    uint8_t velLo;
+    uint8_t velHi;
+} SoundFontRegion;
+
+/*
+    Regions of every preset bucketed by MIDI key. The regions sounding for key k of preset p are
+    keyRegions[keyOffsets[p * 129 + k]] up to keyRegions[keyOffsets[p * 129 + k + 1]], so a
+    note-on only has to check the velocity range of the regions that already match the key.
+*/
+typedef struct SoundFontRegionIndex {
+    void *memory;  // the single allocation behind the arrays below
+    SoundFontRegion *regions;
+    uint32_t regionCount;
+    uint32_t *keyOffsets;  // presetCount * 129 entries
+    uint32_t *keyRegions;  // region ids
+    uint32_t keyRegionCount;
+    uint16_t presetCount;
+} SoundFontRegionIndex;
+
+void soundfont_init_regions(SoundFontRegionIndex *index);
+bool soundfont_build_regions(SoundFontRegionIndex *index, const SoundFontPdtaData *pdta);
+void soundfont_release_regions(SoundFontRegionIndex *index);
+
+uint32_t soundfont_find_regions(const SoundFontRegionIndex *index, uint16_t presetNdx, uint8_t key, uint8_t velocity,
+                                const SoundFontRegion **regions, uint32_t maxRegions);
+
+#endif
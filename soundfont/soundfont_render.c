@@ -0,0 +1,231 @@
+/*
+    RIFF file process library
+
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#include "soundfont_render.h"
+
+#define RENDER_CHUNK 4096  // frames converted and written at once
+#define RENDER_MAX_THREADS 64
+
+// the work list shared by the workers of one batch; next is the only field written after start
+typedef struct RenderBatch {
+    const SoundFontFont *font;
+    const SoundFontRenderOptions *options;
+    SoundFontRenderJob *jobs;
+    uint32_t jobCount;
+    uint32_t next;
+} RenderBatch;
+
+static void put_le(uint8_t *data, uint32_t value, int bytes);
+static bool write_wav_header(FILE *file, uint32_t sampleRate, uint32_t frames);
+static void render_worker(void *arg);
+
+void soundfont_render_defaults(SoundFontRenderOptions *options) {
+    options->sampleRate = 44100;
+    options->polyphony = 256;
+    options->gain = 0.5f;
+    options->tail = 2.0;
+    options->interp = SOUNDFONT_INTERP_CUBIC;
+    options->sincTaps = SOUNDFONT_SINC_TAPS;
+    options->sincPhases = SOUNDFONT_SINC_PHASES;
+}
+
+/*
+    Plays midi through a synth of its own and writes 16-bit stereo PCM to wavPath. Rendering is
+    split at the frame of every event.
+*/
+bool soundfont_render_midi(const SoundFontFont *font, const SoundFontMidiFile *midi, const SoundFontRenderOptions *options, const char *wavPath,
+                           double *duration) {
+    SoundFontSynth synth;
+    if (!soundfont_create_synth(&synth, font, options->sampleRate, options->polyphony)) {
+        return false;
+    }
+    synth.gain = options->gain;
+    if (!soundfont_mixer_set_interp(&synth.mixer, options->interp, options->sincTaps, options->sincPhases)) {
+        soundfont_release_synth(&synth);
+        return false;
+    }
+
+    FILE *file = fopen(wavPath, "wb");
+    float *left = (float *)malloc(sizeof(float) * RENDER_CHUNK * 2);
+    int16_t *pcm = (int16_t *)malloc(sizeof(int16_t) * RENDER_CHUNK * 2);
+    if (NULL == file || NULL == left || NULL == pcm) {
+        printf("Can't write the wave file %s.\n", wavPath);
+        if (NULL != file) {
+            fclose(file);
+        }
+        free(left);
+        free(pcm);
+        soundfont_release_synth(&synth);
+        return false;
+    }
+    float *right = left + RENDER_CHUNK;
+
+    double rate = synth.sampleRate;
+    uint64_t lastFrame = (uint64_t)((midi->duration + options->tail) * rate);
+    uint64_t eventsEnd = (uint64_t)(midi->duration * rate);
+    uint64_t frame = 0;
+    uint32_t event = 0;
+    bool ok = write_wav_header(file, synth.sampleRate, 0);
+    while (ok && frame < lastFrame) {
+        uint32_t frames = 0;
+        while (frames < RENDER_CHUNK && frame < lastFrame) {
+            uint32_t todo = SOUNDFONT_SYNTH_BLOCK;
+            while (event < midi->eventCount) {
+                uint64_t at = (uint64_t)(midi->events[event].time * rate);
+                if (at > frame) {
+                    todo = at - frame < todo ? (uint32_t)(at - frame) : todo;
+                    break;
+                }
+                soundfont_synth_midi(&synth, midi->events[event].status, midi->events[event].data1, midi->events[event].data2);
+                event++;
+            }
+            if (todo > RENDER_CHUNK - frames) {
+                todo = RENDER_CHUNK - frames;
+            }
+            soundfont_synth_render(&synth, left + frames, right + frames, todo);
+            frames += todo;
+            frame += todo;
+            // the tail ends early once every voice has died away
+            if (frame >= eventsEnd && event == midi->eventCount && 0 == soundfont_synth_active(&synth)) {
+                lastFrame = frame;
+            }
+        }
+
+        for (uint32_t i = 0; i < frames; i++) {
+            float l = left[i] * 32767.0f;
+            float r = right[i] * 32767.0f;
+            pcm[2 * i] = (int16_t)(l > 32767.0f ? 32767.0f : (l < -32768.0f ? -32768.0f : l));
+            pcm[2 * i + 1] = (int16_t)(r > 32767.0f ? 32767.0f : (r < -32768.0f ? -32768.0f : r));
+        }
+#ifndef SOUNDFONT_LITTLE_ENDIAN
+        for (uint32_t i = 0; i < frames * 2; i++) {
+            pcm[i] = (int16_t)((uint16_t)pcm[i] >> 8 | (uint16_t)pcm[i] << 8);
+        }
+#endif
+        ok = fwrite(pcm, sizeof(int16_t) * 2, frames, file) == frames;
+    }
+
+    // the header is written again now that the length is known
+    ok = ok && fseek(file, 0, SEEK_SET) == 0 && write_wav_header(file, synth.sampleRate, (uint32_t)frame);
+    ok = (0 == fclose(file)) && ok;
+    if (!ok) {
+        printf("Failed to write the wave file %s.\n", wavPath);
+    }
+    if (NULL != duration) {
+        *duration = frame / rate;
+    }
+
+    free(left);
+    free(pcm);
+    soundfont_release_synth(&synth);
+
+    return ok;
+}
+
+/*
+    Renders every job on a pool of threads sharing the one font. Each worker takes the next job
+    index atomically and builds a synth of its own for it, so nothing but the read-only font is
+    shared. Returns the number of jobs that succeeded.
+*/
+uint32_t soundfont_render_batch(const SoundFontFont *font, SoundFontRenderJob *jobs, uint32_t jobCount, const SoundFontRenderOptions *options,
+                                uint32_t threads) {
+    RenderBatch batch = {font, options, jobs, jobCount, 0};
+    SoundFontThread pool[RENDER_MAX_THREADS];
+
+    if (0 == threads) {
+        threads = soundfont_os_cpu_count();
+    }
+    if (threads > jobCount) {
+        threads = jobCount;
+    }
+    if (threads > RENDER_MAX_THREADS) {
+        threads = RENDER_MAX_THREADS;
+    }
+
+    // the calling thread is a worker too
+    uint32_t started = 0;
+    while (started + 1 < threads && soundfont_os_thread_start(pool + started, render_worker, &batch)) {
+        started++;
+    }
+    render_worker(&batch);
+    for (uint32_t i = 0; i < started; i++) {
+        soundfont_os_thread_join(pool + i);
+    }
+
+    uint32_t succeeded = 0;
+    for (uint32_t i = 0; i < jobCount; i++) {
+        succeeded += jobs[i].ok;
+    }
+
+    return succeeded;
+}
+
+static void put_le(uint8_t *data, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        data[i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+
+// a canonical 44 byte header for 16-bit stereo PCM
+static bool write_wav_header(FILE *file, uint32_t sampleRate, uint32_t frames) {
+    uint8_t header[44];
+    uint32_t dataSize = frames * 4;
+    memcpy(header, "RIFF", 4);
+    put_le(header + 4, 36 + dataSize, 4);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    put_le(header + 16, 16, 4);
+    put_le(header + 20, 1, 2);  // PCM
+    put_le(header + 22, 2, 2);  // channels
+    put_le(header + 24, sampleRate, 4);
+    put_le(header + 28, sampleRate * 4, 4);
+    put_le(header + 32, 4, 2);   // block align
+    put_le(header + 34, 16, 2);  // bits per sample
+    memcpy(header + 36, "data", 4);
+    put_le(header + 40, dataSize, 4);
+
+    return fwrite(header, 1, sizeof(header), file) == sizeof(header);
+}
+
+static void render_worker(void *arg) {
+    RenderBatch *batch = (RenderBatch *)arg;
+    for (;;) {
+        uint32_t index = __atomic_fetch_add(&batch->next, 1, __ATOMIC_RELAXED);
+        if (index >= batch->jobCount) {
+            return;
+        }
+
+        SoundFontRenderJob *job = batch->jobs + index;
+        double started = soundfont_os_now();
+        SoundFontMidiFile midi;
+        job->ok = false;
+        job->duration = 0.0;
+        if (soundfont_read_midi(&midi, job->midiPath)) {
+            job->ok = soundfont_render_midi(batch->font, &midi, batch->options, job->wavPath, &job->duration);
+        }
+        soundfont_release_midi(&midi);
+        job->seconds = soundfont_os_now() - started;
+    }
+}
@@ -0,0 +1,55 @@
+/*
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#ifndef CMANLH_SOUNDFONT_RENDER
+#define CMANLH_SOUNDFONT_RENDER
+
+#include "soundfont_midi.h"
+#include "soundfont_synth.h"
+
+typedef struct SoundFontRenderOptions {
+    uint32_t sampleRate;
+    uint32_t polyphony;
+    float gain;  // master gain, leaves headroom for dense files at the default
+    double tail;  // seconds rendered after the last event while voices still sound
+    SoundFontInterp interp;
+    uint32_t sincTaps;  // filter size of SOUNDFONT_INTERP_SINC
+    uint32_t sincPhases;
+} SoundFontRenderOptions;
+
+typedef struct SoundFontRenderJob {
+    const char *midiPath;
+    const char *wavPath;
+    bool ok;
+    double duration;  // seconds of audio written
+    double seconds;   // wall clock time spent on the job
+} SoundFontRenderJob;
+
+void soundfont_render_defaults(SoundFontRenderOptions *options);
+bool soundfont_render_midi(const SoundFontFont *font, const SoundFontMidiFile *midi, const SoundFontRenderOptions *options, const char *wavPath,
+                           double *duration);
+uint32_t soundfont_render_batch(const SoundFontFont *font, SoundFontRenderJob *jobs, uint32_t jobCount, const SoundFontRenderOptions *options,
+                                uint32_t threads);
+
+#endif
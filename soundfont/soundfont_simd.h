@@ -0,0 +1,176 @@
+/*
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#ifndef CMANLH_SOUNDFONT_SIMD
+#define CMANLH_SOUNDFONT_SIMD
+
+/*
+    Compile time selection of the vector kernels. Exactly one of the SOUNDFONT_SIMD_* macros is
+    defined; SOUNDFONT_SIMD_WIDTH is the number of float lanes of the selected instruction set.
+*/
+#if defined(__AVX2__)
+#define SOUNDFONT_SIMD_AVX2 1
+#define SOUNDFONT_SIMD_WIDTH 8
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOUNDFONT_SIMD_SSE2 1
+#define SOUNDFONT_SIMD_WIDTH 4
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SOUNDFONT_SIMD_NEON 1
+#define SOUNDFONT_SIMD_WIDTH 4
+#include <arm_neon.h>
+#else
+#define SOUNDFONT_SIMD_SCALAR 1
+#define SOUNDFONT_SIMD_WIDTH 1
+#endif
+
+#define SOUNDFONT_SIMD_ALIGN 32  // wide enough for every kernel above
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+    Thin lane-generic wrappers used by the structure-of-arrays kernels. sf_vf holds
+    SOUNDFONT_SIMD_WIDTH floats, sf_vi as many 32-bit integers; comparisons return all-ones lanes.
+    Loads and stores expect SOUNDFONT_SIMD_ALIGN aligned addresses.
+*/
+#if defined(SOUNDFONT_SIMD_AVX2)
+typedef __m256 sf_vf;
+typedef __m256i sf_vi;
+
+static inline sf_vf sf_vf_load(const float *p) { return _mm256_load_ps(p); }
+static inline void sf_vf_store(float *p, sf_vf v) { _mm256_store_ps(p, v); }
+static inline sf_vf sf_vf_set1(float x) { return _mm256_set1_ps(x); }
+static inline sf_vf sf_vf_add(sf_vf a, sf_vf b) { return _mm256_add_ps(a, b); }
+static inline sf_vf sf_vf_sub(sf_vf a, sf_vf b) { return _mm256_sub_ps(a, b); }
+static inline sf_vf sf_vf_mul(sf_vf a, sf_vf b) { return _mm256_mul_ps(a, b); }
+static inline sf_vi sf_vf_cmpge(sf_vf a, sf_vf b) { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_GE_OQ)); }
+static inline sf_vf sf_vf_and(sf_vi mask, sf_vf a) { return _mm256_and_ps(_mm256_castsi256_ps(mask), a); }
+static inline sf_vf sf_vf_abs(sf_vf a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+static inline sf_vi sf_vi_load(const int32_t *p) { return _mm256_load_si256((const __m256i *)p); }
+static inline void sf_vi_store(int32_t *p, sf_vi v) { _mm256_store_si256((__m256i *)p, v); }
+static inline sf_vi sf_vi_set1(int32_t x) { return _mm256_set1_epi32(x); }
+static inline sf_vi sf_vi_add(sf_vi a, sf_vi b) { return _mm256_add_epi32(a, b); }
+static inline sf_vi sf_vi_sub(sf_vi a, sf_vi b) { return _mm256_sub_epi32(a, b); }
+static inline sf_vi sf_vi_and(sf_vi a, sf_vi b) { return _mm256_and_si256(a, b); }
+static inline sf_vi sf_vi_or(sf_vi a, sf_vi b) { return _mm256_or_si256(a, b); }
+static inline sf_vi sf_vi_cmpgt(sf_vi a, sf_vi b) { return _mm256_cmpgt_epi32(a, b); }
+static inline sf_vi sf_vi_select(sf_vi mask, sf_vi a, sf_vi b) { return _mm256_blendv_epi8(b, a, mask); }
+static inline sf_vf sf_vi_to_vf(sf_vi v) { return _mm256_cvtepi32_ps(v); }
+static inline bool sf_vi_any(sf_vi mask) { return 0 != _mm256_movemask_epi8(mask); }
+static inline float sf_vf_hsum(sf_vf v) {
+    __m128 x = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    x = _mm_add_ps(x, _mm_movehl_ps(x, x));
+    x = _mm_add_ss(x, _mm_shuffle_ps(x, x, 1));
+    return _mm_cvtss_f32(x);
+}
+#elif defined(SOUNDFONT_SIMD_SSE2)
+typedef __m128 sf_vf;
+typedef __m128i sf_vi;
+
+static inline sf_vf sf_vf_load(const float *p) { return _mm_load_ps(p); }
+static inline void sf_vf_store(float *p, sf_vf v) { _mm_store_ps(p, v); }
+static inline sf_vf sf_vf_set1(float x) { return _mm_set1_ps(x); }
+static inline sf_vf sf_vf_add(sf_vf a, sf_vf b) { return _mm_add_ps(a, b); }
+static inline sf_vf sf_vf_sub(sf_vf a, sf_vf b) { return _mm_sub_ps(a, b); }
+static inline sf_vf sf_vf_mul(sf_vf a, sf_vf b) { return _mm_mul_ps(a, b); }
+static inline sf_vi sf_vf_cmpge(sf_vf a, sf_vf b) { return _mm_castps_si128(_mm_cmpge_ps(a, b)); }
+static inline sf_vf sf_vf_and(sf_vi mask, sf_vf a) { return _mm_and_ps(_mm_castsi128_ps(mask), a); }
+static inline sf_vf sf_vf_abs(sf_vf a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+static inline sf_vi sf_vi_load(const int32_t *p) { return _mm_load_si128((const __m128i *)p); }
+static inline void sf_vi_store(int32_t *p, sf_vi v) { _mm_store_si128((__m128i *)p, v); }
+static inline sf_vi sf_vi_set1(int32_t x) { return _mm_set1_epi32(x); }
+static inline sf_vi sf_vi_add(sf_vi a, sf_vi b) { return _mm_add_epi32(a, b); }
+static inline sf_vi sf_vi_sub(sf_vi a, sf_vi b) { return _mm_sub_epi32(a, b); }
+static inline sf_vi sf_vi_and(sf_vi a, sf_vi b) { return _mm_and_si128(a, b); }
+static inline sf_vi sf_vi_or(sf_vi a, sf_vi b) { return _mm_or_si128(a, b); }
+static inline sf_vi sf_vi_cmpgt(sf_vi a, sf_vi b) { return _mm_cmpgt_epi32(a, b); }
+static inline sf_vi sf_vi_select(sf_vi mask, sf_vi a, sf_vi b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+static inline sf_vf sf_vi_to_vf(sf_vi v) { return _mm_cvtepi32_ps(v); }
+static inline bool sf_vi_any(sf_vi mask) { return 0 != _mm_movemask_epi8(mask); }
+static inline float sf_vf_hsum(sf_vf v) {
+    __m128 x = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    x = _mm_add_ss(x, _mm_shuffle_ps(x, x, 1));
+    return _mm_cvtss_f32(x);
+}
+#elif defined(SOUNDFONT_SIMD_NEON)
+typedef float32x4_t sf_vf;
+typedef int32x4_t sf_vi;
+
+static inline sf_vf sf_vf_load(const float *p) { return vld1q_f32(p); }
+static inline void sf_vf_store(float *p, sf_vf v) { vst1q_f32(p, v); }
+static inline sf_vf sf_vf_set1(float x) { return vdupq_n_f32(x); }
+static inline sf_vf sf_vf_add(sf_vf a, sf_vf b) { return vaddq_f32(a, b); }
+static inline sf_vf sf_vf_sub(sf_vf a, sf_vf b) { return vsubq_f32(a, b); }
+static inline sf_vf sf_vf_mul(sf_vf a, sf_vf b) { return vmulq_f32(a, b); }
+static inline sf_vi sf_vf_cmpge(sf_vf a, sf_vf b) { return vreinterpretq_s32_u32(vcgeq_f32(a, b)); }
+static inline sf_vf sf_vf_and(sf_vi mask, sf_vf a) { return vreinterpretq_f32_s32(vandq_s32(mask, vreinterpretq_s32_f32(a))); }
+static inline sf_vf sf_vf_abs(sf_vf a) { return vabsq_f32(a); }
+static inline sf_vi sf_vi_load(const int32_t *p) { return vld1q_s32(p); }
+static inline void sf_vi_store(int32_t *p, sf_vi v) { vst1q_s32(p, v); }
+static inline sf_vi sf_vi_set1(int32_t x) { return vdupq_n_s32(x); }
+static inline sf_vi sf_vi_add(sf_vi a, sf_vi b) { return vaddq_s32(a, b); }
+static inline sf_vi sf_vi_sub(sf_vi a, sf_vi b) { return vsubq_s32(a, b); }
+static inline sf_vi sf_vi_and(sf_vi a, sf_vi b) { return vandq_s32(a, b); }
+static inline sf_vi sf_vi_or(sf_vi a, sf_vi b) { return vorrq_s32(a, b); }
+static inline sf_vi sf_vi_cmpgt(sf_vi a, sf_vi b) { return vreinterpretq_s32_u32(vcgtq_s32(a, b)); }
+static inline sf_vi sf_vi_select(sf_vi mask, sf_vi a, sf_vi b) { return vbslq_s32(vreinterpretq_u32_s32(mask), a, b); }
+static inline sf_vf sf_vi_to_vf(sf_vi v) { return vcvtq_f32_s32(v); }
+static inline bool sf_vi_any(sf_vi mask) {
+    int32x2_t x = vorr_s32(vget_low_s32(mask), vget_high_s32(mask));
+    return 0 != (vget_lane_s32(x, 0) | vget_lane_s32(x, 1));
+}
+static inline float sf_vf_hsum(sf_vf v) {
+    float32x2_t x = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpadd_f32(x, x), 0);
+}
+#else
+typedef float sf_vf;
+typedef int32_t sf_vi;
+
+static inline sf_vf sf_vf_load(const float *p) { return *p; }
+static inline void sf_vf_store(float *p, sf_vf v) { *p = v; }
+static inline sf_vf sf_vf_set1(float x) { return x; }
+static inline sf_vf sf_vf_add(sf_vf a, sf_vf b) { return a + b; }
+static inline sf_vf sf_vf_sub(sf_vf a, sf_vf b) { return a - b; }
+static inline sf_vf sf_vf_mul(sf_vf a, sf_vf b) { return a * b; }
+static inline sf_vi sf_vf_cmpge(sf_vf a, sf_vf b) { return a >= b ? -1 : 0; }
+static inline sf_vf sf_vf_and(sf_vi mask, sf_vf a) { return mask ? a : 0.0f; }
+static inline sf_vf sf_vf_abs(sf_vf a) { return a < 0.0f ? -a : a; }
+static inline sf_vi sf_vi_load(const int32_t *p) { return *p; }
+static inline void sf_vi_store(int32_t *p, sf_vi v) { *p = v; }
+static inline sf_vi sf_vi_set1(int32_t x) { return x; }
+static inline sf_vi sf_vi_add(sf_vi a, sf_vi b) { return a + b; }
+static inline sf_vi sf_vi_sub(sf_vi a, sf_vi b) { return a - b; }
+static inline sf_vi sf_vi_and(sf_vi a, sf_vi b) { return a & b; }
+static inline sf_vi sf_vi_or(sf_vi a, sf_vi b) { return a | b; }
+static inline sf_vi sf_vi_cmpgt(sf_vi a, sf_vi b) { return a > b ? -1 : 0; }
+static inline sf_vi sf_vi_select(sf_vi mask, sf_vi a, sf_vi b) { return mask ? a : b; }
+static inline sf_vf sf_vi_to_vf(sf_vi v) { return (float)v; }
+static inline bool sf_vi_any(sf_vi mask) { return 0 != mask; }
+static inline float sf_vf_hsum(sf_vf v) { return v; }
+#endif
+
+#endif
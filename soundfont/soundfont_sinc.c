@@ -0,0 +1,120 @@
+/*
+    RIFF file process library
+
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#include "soundfont_sinc.h"
+
+#include <math.h>
+
+#define PI 3.14159265358979323846
+
+static double bessel_i0(double x);
+
+void soundfont_init_sinc(SoundFontSincTable *table) {
+    memset(table, 0, sizeof(SoundFontSincTable));
+}
+
+/*
+    Tabulates a filter of taps points (rounded up to a multiple of 8) at phases fractions. Both are
+    clamped to SOUNDFONT_SINC_MAX_TAPS and SOUNDFONT_SINC_MAX_PHASES.
+*/
+bool soundfont_create_sinc(SoundFontSincTable *table, uint32_t taps, uint32_t phases) {
+    soundfont_init_sinc(table);
+    taps = (taps + 7) / 8 * 8;
+    taps = taps < 8 ? 8 : (taps > SOUNDFONT_SINC_MAX_TAPS ? SOUNDFONT_SINC_MAX_TAPS : taps);
+    phases = phases < 1 ? 1 : (phases > SOUNDFONT_SINC_MAX_PHASES ? SOUNDFONT_SINC_MAX_PHASES : phases);
+
+    table->memory = malloc(sizeof(float) * taps * (phases + 1) + SOUNDFONT_SIMD_ALIGN);
+    if (NULL == table->memory) {
+        printf("Not enough memory for the sinc table.\n");
+        return false;
+    }
+    table->coefs = (float *)(((uintptr_t)table->memory + SOUNDFONT_SIMD_ALIGN - 1) & ~(uintptr_t)(SOUNDFONT_SIMD_ALIGN - 1));
+    table->taps = taps;
+    table->phases = phases;
+
+    double cutoff = soundfont_sinc_cutoff(taps);
+    table->cutoff = (float)cutoff;
+
+    double half = taps / 2;
+    for (uint32_t p = 0; p <= phases; p++) {
+        float *row = table->coefs + (size_t)p * taps;
+        double frac = (double)p / phases;
+        double sum = 0.0;
+        for (uint32_t k = 0; k < taps; k++) {
+            // distance from the read position to the point the weight applies to
+            double weight = soundfont_sinc_weight((double)k - (half - 1.0) - frac, taps, cutoff);
+            row[k] = (float)weight;
+            sum += weight;
+        }
+        // unity gain at DC for every fraction, otherwise the rounding of the rows rides on the signal as noise
+        for (uint32_t k = 0; k < taps; k++) {
+            row[k] = (float)(row[k] / sum);
+        }
+    }
+
+    return true;
+}
+
+void soundfont_release_sinc(SoundFontSincTable *table) {
+    if (NULL != table->memory) {
+        free(table->memory);
+    }
+    soundfont_init_sinc(table);
+}
+
+// -6 dB point of a filter of taps points, as a fraction of the Nyquist frequency, from Kaiser's transition width estimate
+double soundfont_sinc_cutoff(uint32_t taps) {
+    double transition = (SOUNDFONT_SINC_ATTENUATION - 7.95) / (2.285 * (taps - 1) * PI);
+    double cutoff = 1.0 - transition / 2.0;
+
+    return cutoff < 0.5 ? 0.5 : cutoff;
+}
+
+// unnormalised weight of the point d away from the read position in a filter of taps points
+double soundfont_sinc_weight(double d, uint32_t taps, double cutoff) {
+    double beta = 0.1102 * (SOUNDFONT_SINC_ATTENUATION - 8.7);
+    double x = d / (taps / 2);
+    if (x * x >= 1.0) {
+        return 0.0;
+    }
+    double window = bessel_i0(beta * sqrt(1.0 - x * x)) / bessel_i0(beta);
+    double sinc = 0.0 == d ? 1.0 : sin(PI * cutoff * d) / (PI * cutoff * d);
+
+    return cutoff * sinc * window;
+}
+
+// modified Bessel function of the first kind, order zero, by its power series
+static double bessel_i0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 64 && term > sum * 1e-12; k++) {
+        double t = x / (2.0 * k);
+        term *= t * t;
+        sum += term;
+    }
+
+    return sum;
+}
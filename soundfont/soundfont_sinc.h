@@ -0,0 +1,59 @@
+/*
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#ifndef CMANLH_SOUNDFONT_SINC
+#define CMANLH_SOUNDFONT_SINC
+
+#include "soundfont2.h"
+#include "soundfont_simd.h"
+
+#define SOUNDFONT_SINC_TAPS 32        // default filter length
+#define SOUNDFONT_SINC_PHASES 256     // default number of tabulated fractional positions
+#define SOUNDFONT_SINC_MAX_TAPS 64    // the store and pool guard points cover half of it past a sample
+#define SOUNDFONT_SINC_MAX_PHASES 4096
+#define SOUNDFONT_SINC_ATTENUATION 80.0  // stopband attenuation in dB the Kaiser window is designed for
+
+/*
+    Windowed-sinc interpolation filter tabulated at phases + 1 evenly spaced fractions. Row p
+    weighs the points idx - taps / 2 + 1 ... idx + taps / 2 for a read position p / phases past
+    idx; fractions between two rows blend them linearly. The cutoff is placed so the transition
+    band of the window ends at the Nyquist frequency of the sample, which leaves playback at or
+    below the sample rate free of images down to SOUNDFONT_SINC_ATTENUATION; longer filters have
+    a narrower transition band and keep more of the top octave.
+*/
+typedef struct SoundFontSincTable {
+    void *memory;
+    float *coefs;     // (phases + 1) * taps weights, every row starts on a vector boundary
+    uint32_t taps;    // a multiple of 8, so rows split into whole vectors of every kernel
+    uint32_t phases;  // rows - 1
+    float cutoff;     // -6 dB point as a fraction of the sample's Nyquist frequency
+} SoundFontSincTable;
+
+void soundfont_init_sinc(SoundFontSincTable *table);
+bool soundfont_create_sinc(SoundFontSincTable *table, uint32_t taps, uint32_t phases);
+void soundfont_release_sinc(SoundFontSincTable *table);
+double soundfont_sinc_cutoff(uint32_t taps);
+double soundfont_sinc_weight(double d, uint32_t taps, double cutoff);
+
+#endif
@@ -0,0 +1,155 @@
+/*
+    RIFF file process library
+
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#include "soundfont_stats.h"
+
+#include <string.h>
+
+static const char *PHASE_NAMES[SOUNDFONT_PHASES] = {"font_load", "pdta_read", "pdta_decode", "pdta_parallel", "sdta_read",
+                                                    "sdta_map",  "tables_build", "render", "control_tick"};
+static const char *COUNTER_NAMES[SOUNDFONT_COUNTERS] = {"bytes_read", "records_decoded", "voices_started", "voices_stolen", "frames_rendered",
+                                                        "cache_hits", "cache_misses", "store_hits", "store_misses"};
+
+#ifdef SOUNDFONT_STATS
+
+#define STATS_CALIBRATION 0.001  // seconds of clock the tick rate is measured over at least
+
+SOUNDFONT_THREAD_LOCAL SoundFontStatsSlot *soundfont_stats_thread_slot = NULL;
+
+// a line of padding between two slots whatever the alignment, so no two threads write the same cache line
+typedef union StatsLine {
+    SoundFontStatsSlot slot;
+    uint8_t pad[(sizeof(SoundFontStatsSlot) + SOUNDFONT_CACHE_LINE - 1) / SOUNDFONT_CACHE_LINE * SOUNDFONT_CACHE_LINE + SOUNDFONT_CACHE_LINE];
+} StatsLine;
+
+static StatsLine lines[SOUNDFONT_STATS_SLOTS];
+static uint32_t owned[SOUNDFONT_STATS_SLOTS];  // 1 while a live thread holds the slot, the shared last one is never given back
+static uint32_t used = 0;                      // slots handed out at least once, the ones a snapshot reads
+static uint32_t claimed = 0;                   // threads that claimed a slot, reused ones included
+// the tick counter and the clock at the first claim, the tick rate is measured from there
+static uint64_t originTicks = 0;
+static double originSeconds = 0.0;
+static uint32_t originSet = 0;  // 0 unset, 1 being set, 2 set
+
+/*
+    The calling thread's slot, claimed on its first update: the lowest one no live thread holds,
+    or the shared last one when all are held. A slot given back keeps its counts and its next
+    owner adds to them, so the sums stay those of every thread that ever ran.
+*/
+SoundFontStatsSlot *soundfont_stats_claim(void) {
+    uint32_t expected = 0;
+    if (__atomic_compare_exchange_n(&originSet, &expected, 1, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        originSeconds = soundfont_os_now();
+        originTicks = soundfont_stats_ticks();
+        __atomic_store_n(&originSet, 2, __ATOMIC_RELEASE);
+    }
+    uint32_t index = 0;
+    for (; index < SOUNDFONT_STATS_SLOTS - 1; index++) {
+        expected = 0;
+        // acquire pairs with the release in soundfont_stats_release, the last owner's stores are seen
+        if (0 == __atomic_load_n(owned + index, __ATOMIC_RELAXED) &&
+            __atomic_compare_exchange_n(owned + index, &expected, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+    if (index == SOUNDFONT_STATS_SLOTS - 1) {
+        __atomic_store_n(&lines[index].slot.shared, true, __ATOMIC_RELAXED);
+    }
+    uint32_t seen = __atomic_load_n(&used, __ATOMIC_RELAXED);
+    while (seen <= index && !__atomic_compare_exchange_n(&used, &seen, index + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    __atomic_add_fetch(&claimed, 1, __ATOMIC_RELAXED);
+    soundfont_stats_thread_slot = &lines[index].slot;
+
+    return soundfont_stats_thread_slot;
+}
+
+// gives the calling thread's slot back for the next thread that claims one, a no-op when it holds none
+void soundfont_stats_release(void) {
+    SoundFontStatsSlot *slot = soundfont_stats_thread_slot;
+    if (NULL == slot) {
+        return;
+    }
+    soundfont_stats_thread_slot = NULL;
+    uint32_t index = (uint32_t)((StatsLine *)slot - lines);
+    if (index < SOUNDFONT_STATS_SLOTS - 1) {
+        __atomic_store_n(owned + index, 0, __ATOMIC_RELEASE);
+    }
+}
+
+/*
+    Reads every slot without locking them. The threads keep updating meanwhile, so the counters
+    of one snapshot may be a few updates apart, but none is ever torn.
+*/
+void soundfont_stats_snapshot(SoundFontStatsSnapshot *snapshot) {
+    memset(snapshot, 0, sizeof(SoundFontStatsSnapshot));
+    snapshot->enabled = true;
+    snapshot->threads = __atomic_load_n(&claimed, __ATOMIC_RELAXED);
+    uint32_t count = __atomic_load_n(&used, __ATOMIC_RELAXED);
+
+    uint64_t ticks[SOUNDFONT_PHASES] = {0};
+    for (uint32_t s = 0; s < count; s++) {
+        for (int i = 0; i < SOUNDFONT_COUNTERS; i++) {
+            snapshot->counters[i] += __atomic_load_n(&lines[s].slot.counters[i], __ATOMIC_RELAXED);
+        }
+        for (int i = 0; i < SOUNDFONT_PHASES; i++) {
+            snapshot->calls[i] += __atomic_load_n(&lines[s].slot.calls[i], __ATOMIC_RELAXED);
+            ticks[i] += __atomic_load_n(&lines[s].slot.ticks[i], __ATOMIC_RELAXED);
+        }
+    }
+    if (2 != __atomic_load_n(&originSet, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
+    // the ticks per second from the origin on, measured over a millisecond at least
+    double seconds = soundfont_os_now() - originSeconds;
+    while (seconds < STATS_CALIBRATION) {
+        seconds = soundfont_os_now() - originSeconds;
+    }
+    double rate = (double)(soundfont_stats_ticks() - originTicks) / seconds;
+    for (int i = 0; i < SOUNDFONT_PHASES; i++) {
+        snapshot->seconds[i] = rate > 0.0 ? ticks[i] / rate : 0.0;
+    }
+}
+
+#else
+
+void soundfont_stats_release(void) {
+}
+
+void soundfont_stats_snapshot(SoundFontStatsSnapshot *snapshot) {
+    memset(snapshot, 0, sizeof(SoundFontStatsSnapshot));
+}
+
+#endif
+
+const char *soundfont_stats_phase_name(SoundFontStatsPhase phase) {
+    return phase < SOUNDFONT_PHASES ? PHASE_NAMES[phase] : "unknown";
+}
+
+const char *soundfont_stats_counter_name(SoundFontStatsCounter counter) {
+    return counter < SOUNDFONT_COUNTERS ? COUNTER_NAMES[counter] : "unknown";
+}
@@ -0,0 +1,142 @@
+/*
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#ifndef CMANLH_SOUNDFONT_STATS
+#define CMANLH_SOUNDFONT_STATS
+
+#include "soundfont_os.h"
+
+#define SOUNDFONT_STATS_SLOTS 64  // live threads with a slot of their own, the ones after them share the last
+
+typedef enum SoundFontStatsPhase {
+    SOUNDFONT_PHASE_FONT_LOAD,      // soundfont_load_font and its variants, covering the phases below
+    SOUNDFONT_PHASE_PDTA_READ,      // soundfont_read_pdta, the read and the decode
+    SOUNDFONT_PHASE_PDTA_DECODE,    // soundfont_decode_pdta
+    SOUNDFONT_PHASE_PDTA_PARALLEL,  // soundfont_read_pdta_parallel
+    SOUNDFONT_PHASE_SDTA_READ,
+    SOUNDFONT_PHASE_SDTA_MAP,
+    SOUNDFONT_PHASE_TABLES_BUILD,  // regions, zones and modulators of a loaded font
+    SOUNDFONT_PHASE_RENDER,        // soundfont_synth_render, covering the control ticks
+    SOUNDFONT_PHASE_CONTROL_TICK,
+    SOUNDFONT_PHASES
+} SoundFontStatsPhase;
+
+typedef enum SoundFontStatsCounter {
+    SOUNDFONT_COUNT_BYTES_READ,  // from font files, by stream and positional reads
+    SOUNDFONT_COUNT_RECORDS_DECODED,
+    SOUNDFONT_COUNT_VOICES_STARTED,
+    SOUNDFONT_COUNT_VOICES_STOLEN,
+    SOUNDFONT_COUNT_FRAMES_RENDERED,
+    SOUNDFONT_COUNT_CACHE_HITS,    // fonts whose tables came from a valid cache file
+    SOUNDFONT_COUNT_CACHE_MISSES,  // fonts compiled from the .sf2 instead
+    SOUNDFONT_COUNT_STORE_HITS,    // paged samples resident when a voice asked for them
+    SOUNDFONT_COUNT_STORE_MISSES,
+    SOUNDFONT_COUNTERS
+} SoundFontStatsCounter;
+
+// the sums over every thread at one moment; counters bumped during the snapshot may or may not be in
+typedef struct SoundFontStatsSnapshot {
+    bool enabled;  // false when the library was built without SOUNDFONT_STATS, everything else is 0 then
+    uint32_t threads;  // threads that updated a counter so far, the exited ones included
+    uint64_t counters[SOUNDFONT_COUNTERS];
+    uint64_t calls[SOUNDFONT_PHASES];
+    double seconds[SOUNDFONT_PHASES];
+} SoundFontStatsSnapshot;
+
+void soundfont_stats_snapshot(SoundFontStatsSnapshot *snapshot);
+// called by a thread before it exits; the threads of soundfont_os_thread_start do it on their own
+void soundfont_stats_release(void);
+const char *soundfont_stats_phase_name(SoundFontStatsPhase phase);
+const char *soundfont_stats_counter_name(SoundFontStatsCounter counter);
+
+/*
+    Instrumentation is compiled in with -DSOUNDFONT_STATS, for the library and everything
+    including its headers alike. Without it the macros below expand to nothing and a snapshot
+    reports enabled as false.
+
+    Every thread claims a slot of its own on its first update and is the only writer of it, so an
+    update is a plain load and store without a lock or a locked instruction; it gives the slot back
+    through soundfont_stats_release when it exits. Only the threads past SOUNDFONT_STATS_SLOTS live
+    at once share a slot and add atomically. Phases are timed with the time stamp
+    counter on x86 and the monotonic clock elsewhere.
+*/
+#ifdef SOUNDFONT_STATS
+
+#if defined(_MSC_VER)
+#define SOUNDFONT_THREAD_LOCAL __declspec(thread)
+#else
+#define SOUNDFONT_THREAD_LOCAL __thread
+#endif
+
+typedef struct SoundFontStatsSlot {
+    uint64_t counters[SOUNDFONT_COUNTERS];
+    uint64_t calls[SOUNDFONT_PHASES];
+    uint64_t ticks[SOUNDFONT_PHASES];
+    bool shared;  // the overflow slot, written by more than one thread
+} SoundFontStatsSlot;
+
+extern SOUNDFONT_THREAD_LOCAL SoundFontStatsSlot *soundfont_stats_thread_slot;
+
+SoundFontStatsSlot *soundfont_stats_claim(void);
+
+static inline uint64_t soundfont_stats_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return (uint64_t)(soundfont_os_now() * 1e9);
+#endif
+}
+
+static inline void soundfont_stats_bump(const SoundFontStatsSlot *slot, uint64_t *value, uint64_t n) {
+    if (slot->shared) {
+        __atomic_add_fetch(value, n, __ATOMIC_RELAXED);
+    } else {
+        __atomic_store_n(value, __atomic_load_n(value, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+    }
+}
+
+static inline void soundfont_stats_add(SoundFontStatsCounter counter, uint64_t n) {
+    SoundFontStatsSlot *slot = NULL != soundfont_stats_thread_slot ? soundfont_stats_thread_slot : soundfont_stats_claim();
+    soundfont_stats_bump(slot, slot->counters + counter, n);
+}
+
+static inline void soundfont_stats_phase(SoundFontStatsPhase phase, uint64_t ticks) {
+    SoundFontStatsSlot *slot = NULL != soundfont_stats_thread_slot ? soundfont_stats_thread_slot : soundfont_stats_claim();
+    soundfont_stats_bump(slot, slot->calls + phase, 1);
+    soundfont_stats_bump(slot, slot->ticks + phase, ticks);
+}
+
+#define SOUNDFONT_STATS_ADD(counter, n) soundfont_stats_add(counter, n)
+#define SOUNDFONT_STATS_BEGIN(name) uint64_t name = soundfont_stats_ticks()
+#define SOUNDFONT_STATS_END(phase, name) soundfont_stats_phase(phase, soundfont_stats_ticks() - (name))
+
+#else
+
+#define SOUNDFONT_STATS_ADD(counter, n) ((void)0)
+#define SOUNDFONT_STATS_BEGIN(name) ((void)0)
+#define SOUNDFONT_STATS_END(phase, name) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,361 @@
+/*
+    RIFF file process library
+
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#include "soundfont_store.h"
+
+#include "soundfont_stats.h"
+
+#define STORE_POLL 0.01  // seconds the loader sleeps when a wake-up was missed
+
+static bool try_acquire(SoundFontSampleStore *store, uint32_t sample, SoundFontSampleView *view);
+static bool read_points(SoundFontSampleStore *store, int16_t *dest, uint32_t origin, uint32_t count);
+static void fill_view(const SoundFontSampleStore *store, uint32_t sample, const int16_t *data, uint32_t frames, SoundFontSampleView *view);
+static void request_body(SoundFontSampleStore *store, uint32_t sample);
+static void load_body(SoundFontSampleStore *store, uint32_t sample);
+static void evict_bodies(SoundFontSampleStore *store);
+static void loader_main(void *arg);
+
+void soundfont_store_defaults(SoundFontStoreOptions *options) {
+    options->headFrames = 8192;
+    options->budget = (size_t)256 << 20;
+    options->wait = false;
+}
+
+void soundfont_init_store(SoundFontSampleStore *store) {
+    memset(store, 0, sizeof(SoundFontSampleStore));
+}
+
+/*
+    Opens path a second time for the sample data, reads the head of every sample of pdta and starts
+    the loader thread. pdta must be the font's own pdta and stay loaded until the store is released.
+*/
+bool soundfont_open_store(SoundFontSampleStore *store, const char *path, const SoundFontPdtaData *pdta, const SoundFontStoreOptions *options) {
+    soundfont_init_store(store);
+    store->options = *options;
+    if (store->options.headFrames < 2 * SOUNDFONT_STORE_GUARD) {
+        store->options.headFrames = 2 * SOUNDFONT_STORE_GUARD;
+    }
+
+    store->file = fopen(path, "rb");
+    if (NULL == store->file) {
+        printf("Can't open the sound font %s.\n", path);
+        return false;
+    }
+    SoundFontSdtaLocation location;
+    if (!soundfont_locate_sdta(store->file, &location) || soundfont_os_file_size(store->file) < location.smplOffset + location.smplSize) {
+        printf("No sample data in %s.\n", path);
+        soundfont_release_store(store);
+        return false;
+    }
+    store->smplOffset = location.smplOffset;
+    store->smplFrames = location.smplSize / 2;
+
+    store->shdr = pdta->shdr;
+    store->count = pdta->shdrSize;
+    store->entries = (SoundFontStoreEntry *)calloc(store->count > 0 ? store->count : 1, sizeof(SoundFontStoreEntry));
+    if (NULL == store->entries) {
+        printf("Not enough memory for the sample store.\n");
+        soundfont_release_store(store);
+        return false;
+    }
+
+    // the guard points come from the file, which holds the spec's zero points around every sample
+    size_t headPoints = 0;
+    for (uint32_t i = 0; i < store->count; i++) {
+        const SoundFontSample *sample = store->shdr + i;
+        SoundFontStoreEntry *entry = store->entries + i;
+        if (sample->start >= sample->end || sample->end > store->smplFrames) {
+            continue;
+        }
+        entry->origin = sample->start > SOUNDFONT_STORE_GUARD ? sample->start - SOUNDFONT_STORE_GUARD : 0;
+        entry->frames = sample->end + SOUNDFONT_STORE_GUARD - entry->origin;
+        entry->headFrames = entry->frames < store->options.headFrames ? entry->frames : store->options.headFrames;
+        entry->state = entry->headFrames == entry->frames ? SOUNDFONT_STORE_PINNED : SOUNDFONT_STORE_EMPTY;
+        headPoints += entry->headFrames;
+    }
+    store->heads = (int16_t *)malloc(sizeof(int16_t) * (headPoints > 0 ? headPoints : 1));
+    if (NULL == store->heads) {
+        printf("Not enough memory for the sample heads.\n");
+        soundfont_release_store(store);
+        return false;
+    }
+    store->pinned = sizeof(int16_t) * headPoints;
+
+    int16_t *head = store->heads;
+    for (uint32_t i = 0; i < store->count; i++) {
+        SoundFontStoreEntry *entry = store->entries + i;
+        if (0 == entry->frames) {
+            continue;
+        }
+        entry->head = head;
+        head += entry->headFrames;
+        if (!read_points(store, entry->head, entry->origin, entry->headFrames)) {
+            printf("Failed to read the sample data of %s.\n", path);
+            soundfont_release_store(store);
+            return false;
+        }
+        if (entry->state == SOUNDFONT_STORE_PINNED) {
+            entry->body = entry->head;
+        }
+    }
+
+    if (!soundfont_os_lock_create(&store->lock) || !soundfont_os_signal_create(&store->wake) || !soundfont_os_signal_create(&store->loaded) ||
+        !soundfont_os_thread_start(&store->loader, loader_main, store)) {
+        printf("Failed to start the sample loader.\n");
+        soundfont_release_store(store);
+        return false;
+    }
+
+    return true;
+}
+
+// every voice must have released its samples before
+void soundfont_release_store(SoundFontSampleStore *store) {
+    if (NULL != store->loader.handle) {
+        soundfont_os_lock(&store->lock);
+        __atomic_store_n(&store->stop, 1, __ATOMIC_RELEASE);
+        soundfont_os_signal_notify(&store->wake);
+        soundfont_os_unlock(&store->lock);
+        soundfont_os_thread_join(&store->loader);
+    }
+    soundfont_os_signal_destroy(&store->wake);
+    soundfont_os_signal_destroy(&store->loaded);
+    soundfont_os_lock_destroy(&store->lock);
+
+    for (uint32_t i = 0; NULL != store->entries && i < store->count; i++) {
+        SoundFontStoreEntry *entry = store->entries + i;
+        if (entry->state != SOUNDFONT_STORE_PINNED && NULL != entry->body) {
+            free(entry->body);
+        }
+    }
+    if (NULL != store->entries) {
+        free(store->entries);
+    }
+    if (NULL != store->heads) {
+        free(store->heads);
+    }
+    if (NULL != store->file) {
+        fclose(store->file);
+    }
+    soundfont_init_store(store);
+}
+
+/*
+    A view of the resident head of a sample, available at any time. Positions past the head read
+    silence; a voice playing it should move to soundfont_store_acquire's view before it gets there.
+*/
+bool soundfont_store_head(SoundFontSampleStore *store, uint32_t sample, SoundFontSampleView *view) {
+    if (sample >= store->count || 0 == store->entries[sample].frames) {
+        return false;
+    }
+    fill_view(store, sample, store->entries[sample].head, store->entries[sample].headFrames, view);
+
+    return true;
+}
+
+/*
+    A view of the whole sample when it is resident, which then stays resident until the matching
+    soundfont_store_release. Otherwise the sample is queued for loading and false is returned; the
+    call never blocks.
+*/
+bool soundfont_store_acquire(SoundFontSampleStore *store, uint32_t sample, SoundFontSampleView *view) {
+    bool resident = try_acquire(store, sample, view);
+    SOUNDFONT_STATS_ADD(resident ? SOUNDFONT_COUNT_STORE_HITS : SOUNDFONT_COUNT_STORE_MISSES, 1);
+
+    return resident;
+}
+
+// as soundfont_store_acquire, but blocks until the loader thread has read the sample
+bool soundfont_store_acquire_wait(SoundFontSampleStore *store, uint32_t sample, SoundFontSampleView *view) {
+    // counted once, the polls while waiting are not misses of their own
+    if (soundfont_store_acquire(store, sample, view)) {
+        return true;
+    }
+    while (!try_acquire(store, sample, view)) {
+        if (sample >= store->count || 0 == store->entries[sample].frames) {
+            return false;
+        }
+        soundfont_os_lock(&store->lock);
+        uint32_t state = __atomic_load_n(&store->entries[sample].state, __ATOMIC_ACQUIRE);
+        if (state == SOUNDFONT_STORE_QUEUED || state == SOUNDFONT_STORE_LOADING) {
+            soundfont_os_signal_wait(&store->loaded, &store->lock, STORE_POLL);
+        }
+        soundfont_os_unlock(&store->lock);
+    }
+
+    return true;
+}
+
+void soundfont_store_release(SoundFontSampleStore *store, uint32_t sample) {
+    if (sample < store->count) {
+        __atomic_sub_fetch(&store->entries[sample].users, 1, __ATOMIC_RELEASE);
+    }
+}
+
+static bool try_acquire(SoundFontSampleStore *store, uint32_t sample, SoundFontSampleView *view) {
+    if (sample >= store->count || 0 == store->entries[sample].frames) {
+        return false;
+    }
+    SoundFontStoreEntry *entry = store->entries + sample;
+    __atomic_store_n(&entry->lastUse, __atomic_add_fetch(&store->clock, 1, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+
+    // the user count goes up before the state is read and the evictor does the opposite, so one of them sees the other
+    __atomic_add_fetch(&entry->users, 1, __ATOMIC_SEQ_CST);
+    uint32_t state = __atomic_load_n(&entry->state, __ATOMIC_SEQ_CST);
+    if (state == SOUNDFONT_STORE_RESIDENT || state == SOUNDFONT_STORE_PINNED) {
+        fill_view(store, sample, entry->body, entry->frames, view);
+        return true;
+    }
+    __atomic_sub_fetch(&entry->users, 1, __ATOMIC_RELEASE);
+    request_body(store, sample);
+
+    return false;
+}
+
+// count points from smpl position origin, the points past the end of smpl read as zero
+static bool read_points(SoundFontSampleStore *store, int16_t *dest, uint32_t origin, uint32_t count) {
+    uint32_t available = origin < store->smplFrames ? store->smplFrames - origin : 0;
+    uint32_t n = count < available ? count : available;
+    if (n > 0 && !soundfont_os_read_at(store->file, dest, sizeof(int16_t) * n, store->smplOffset + 2 * (int64_t)origin)) {
+        return false;
+    }
+#ifndef SOUNDFONT_LITTLE_ENDIAN
+    for (uint32_t i = 0; i < n; i++) {
+        const uint8_t *bytes = (const uint8_t *)(dest + i);
+        dest[i] = (int16_t)(bytes[0] | bytes[1] << 8);
+    }
+#endif
+    memset(dest + n, 0, sizeof(int16_t) * (count - n));
+
+    return true;
+}
+
+static void fill_view(const SoundFontSampleStore *store, uint32_t sample, const int16_t *data, uint32_t frames, SoundFontSampleView *view) {
+    soundfont_sample_view_at(view, data, frames, store->entries[sample].origin, store->shdr + sample);
+}
+
+// pushes the sample on the request stack unless it is already queued, loading or resident
+static void request_body(SoundFontSampleStore *store, uint32_t sample) {
+    SoundFontStoreEntry *entry = store->entries + sample;
+    uint32_t expected = SOUNDFONT_STORE_EMPTY;
+    if (!__atomic_compare_exchange_n(&entry->state, &expected, SOUNDFONT_STORE_QUEUED, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        return;
+    }
+    uint32_t top = __atomic_load_n(&store->requests, __ATOMIC_RELAXED);
+    do {
+        entry->nextRequest = top;
+    } while (!__atomic_compare_exchange_n(&store->requests, &top, sample + 1, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    soundfont_os_signal_notify(&store->wake);
+}
+
+static void load_body(SoundFontSampleStore *store, uint32_t sample) {
+    SoundFontStoreEntry *entry = store->entries + sample;
+    __atomic_store_n(&entry->state, SOUNDFONT_STORE_LOADING, __ATOMIC_RELAXED);
+
+    size_t bytes = sizeof(int16_t) * entry->frames;
+    int16_t *body = (int16_t *)malloc(bytes);
+    if (NULL == body || !read_points(store, body, entry->origin, entry->frames)) {
+        printf("Failed to load sample %u.\n", sample);
+        free(body);
+        __atomic_store_n(&entry->state, SOUNDFONT_STORE_EMPTY, __ATOMIC_RELEASE);
+        return;
+    }
+    entry->body = body;
+    entry->batch = store->batch;
+    __atomic_add_fetch(&store->resident, bytes, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&store->loads, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->state, SOUNDFONT_STORE_RESIDENT, __ATOMIC_SEQ_CST);
+}
+
+/*
+    Frees the least recently requested bodies nobody plays until the resident bytes fit the budget.
+    Runs on the loader thread only, which is the only thread freeing bodies.
+*/
+static void evict_bodies(SoundFontSampleStore *store) {
+    while (__atomic_load_n(&store->resident, __ATOMIC_RELAXED) > store->options.budget) {
+        uint32_t victim = store->count;
+        uint64_t oldest = UINT64_MAX;
+        for (uint32_t i = 0; i < store->count; i++) {
+            const SoundFontStoreEntry *entry = store->entries + i;
+            if (__atomic_load_n(&entry->state, __ATOMIC_RELAXED) == SOUNDFONT_STORE_RESIDENT && 0 == __atomic_load_n(&entry->users, __ATOMIC_RELAXED) &&
+                entry->batch != store->batch) {
+                uint64_t lastUse = __atomic_load_n(&entry->lastUse, __ATOMIC_RELAXED);
+                if (lastUse < oldest) {
+                    oldest = lastUse;
+                    victim = i;
+                }
+            }
+        }
+        if (victim == store->count) {
+            return;  // everything resident is playing or just loaded, the budget is exceeded for now
+        }
+
+        SoundFontStoreEntry *entry = store->entries + victim;
+        __atomic_store_n(&entry->state, SOUNDFONT_STORE_EVICTING, __ATOMIC_SEQ_CST);
+        if (0 != __atomic_load_n(&entry->users, __ATOMIC_SEQ_CST)) {
+            __atomic_store_n(&entry->state, SOUNDFONT_STORE_RESIDENT, __ATOMIC_SEQ_CST);  // acquired meanwhile
+            continue;
+        }
+        free(entry->body);
+        entry->body = NULL;
+        __atomic_sub_fetch(&store->resident, sizeof(int16_t) * entry->frames, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&store->evictions, 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&entry->state, SOUNDFONT_STORE_EMPTY, __ATOMIC_RELEASE);
+    }
+}
+
+/*
+    Takes the whole request stack at once, so no entry is popped while being pushed again, evicts
+    down to the budget and loads every body on the stack. Requests made while the loader checks
+    the stack and goes to sleep are picked up after STORE_POLL at the latest.
+*/
+static void loader_main(void *arg) {
+    SoundFontSampleStore *store = (SoundFontSampleStore *)arg;
+    for (;;) {
+        uint32_t top = __atomic_exchange_n(&store->requests, 0, __ATOMIC_ACQUIRE);
+        if (0 == top) {
+            soundfont_os_lock(&store->lock);
+            if (!__atomic_load_n(&store->stop, __ATOMIC_ACQUIRE) && 0 == __atomic_load_n(&store->requests, __ATOMIC_ACQUIRE)) {
+                soundfont_os_signal_wait(&store->wake, &store->lock, STORE_POLL);
+            }
+            soundfont_os_unlock(&store->lock);
+            if (__atomic_load_n(&store->stop, __ATOMIC_ACQUIRE)) {
+                return;
+            }
+            continue;
+        }
+        store->batch++;
+        evict_bodies(store);
+        while (0 != top) {
+            uint32_t sample = top - 1;
+            top = store->entries[sample].nextRequest;
+            load_body(store, sample);
+        }
+        soundfont_os_lock(&store->lock);
+        soundfont_os_signal_broadcast(&store->loaded);
+        soundfont_os_unlock(&store->lock);
+    }
+}
@@ -0,0 +1,110 @@
+/*
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#ifndef CMANLH_SOUNDFONT_STORE
+#define CMANLH_SOUNDFONT_STORE
+
+#include "soundfont_sinc.h"
+#include "soundfont_voice.h"
+
+// points kept before start and after end, as far as the longest sinc filter reads; the spec puts 46 zero points after every sample
+#define SOUNDFONT_STORE_GUARD (SOUNDFONT_SINC_MAX_TAPS / 2 + 1)
+
+typedef enum SoundFontStoreState {
+    SOUNDFONT_STORE_EMPTY,     // only the head is resident
+    SOUNDFONT_STORE_QUEUED,    // waiting for the loader thread
+    SOUNDFONT_STORE_LOADING,   // being read by the loader thread
+    SOUNDFONT_STORE_RESIDENT,  // body holds the whole sample
+    SOUNDFONT_STORE_EVICTING,  // the loader thread is about to free body
+    SOUNDFONT_STORE_PINNED     // the head already holds the whole sample
+} SoundFontStoreState;
+
+typedef struct SoundFontStoreOptions {
+    uint32_t headFrames;  // points of every sample read at open and never evicted, they cover the streaming latency
+    size_t budget;        // bytes of streamed sample bodies kept resident
+    bool wait;            // note-ons wait for the whole sample instead of starting on the head, for offline rendering
+} SoundFontStoreOptions;
+
+/*
+    Both buffers of an entry hold the points of the sample from origin on, so a position means the
+    same point in either and a voice may move from the head to the body while playing.
+*/
+typedef struct SoundFontStoreEntry {
+    int16_t *head;        // the first headFrames points, resident from open to release
+    int16_t *body;        // all frames points once streamed in, otherwise NULL
+    uint32_t origin;      // smpl position of the first point
+    uint32_t frames;      // points from origin to the end of the trailing guard, 0 for a broken sample
+    uint32_t headFrames;  // points in head
+    uint32_t state;       // SoundFontStoreState, changed atomically
+    uint32_t users;       // voices playing from body, which is never evicted while they do
+    uint32_t nextRequest;  // link of the request stack, index + 1
+    uint32_t batch;        // loader batch that read body, which that batch does not evict again
+    uint64_t lastUse;      // store clock at the latest request, the least recent body is evicted first
+} SoundFontStoreEntry;
+
+/*
+    Lazy sample data for fonts too large to load whole. Every sample keeps a short head in memory
+    from open on, so a note-on never waits for the disk: the voice starts on the head while a
+    loader thread reads the rest of the sample with positional reads, and moves over once it has
+    arrived. Bodies nobody plays are freed least recently used first whenever the resident bytes
+    exceed the budget, so memory follows the working set rather than the file size.
+
+    Any number of synths on any number of threads may share a store; acquiring and releasing
+    never lock. The budget may be exceeded by the bodies of the latest loader batch, which are
+    kept until their voices had the chance to acquire them, and by bodies still being played.
+*/
+typedef struct SoundFontSampleStore {
+    FILE *file;
+    int64_t smplOffset;  // file offset of the smpl payload
+    uint32_t smplFrames;
+    const SoundFontSample *shdr;  // the sample headers of the font, which must outlive the store
+    SoundFontStoreEntry *entries;
+    uint32_t count;
+    int16_t *heads;  // the single allocation behind every head
+    SoundFontStoreOptions options;
+    size_t pinned;    // bytes of heads
+    size_t resident;  // bytes of streamed bodies, atomic
+    uint64_t clock;   // atomic
+    uint32_t requests;  // top of the request stack, index + 1, 0 when empty
+    uint32_t stop;
+    uint32_t batch;      // loader batches so far
+    uint64_t loads;      // bodies streamed in
+    uint64_t evictions;  // bodies freed to stay within the budget
+    SoundFontLock lock;  // only guards the sleeps of the loader and of waiting acquires
+    SoundFontSignal wake;
+    SoundFontSignal loaded;
+    SoundFontThread loader;
+} SoundFontSampleStore;
+
+void soundfont_store_defaults(SoundFontStoreOptions *options);
+void soundfont_init_store(SoundFontSampleStore *store);
+bool soundfont_open_store(SoundFontSampleStore *store, const char *path, const SoundFontPdtaData *pdta, const SoundFontStoreOptions *options);
+void soundfont_release_store(SoundFontSampleStore *store);
+
+bool soundfont_store_head(SoundFontSampleStore *store, uint32_t sample, SoundFontSampleView *view);
+bool soundfont_store_acquire(SoundFontSampleStore *store, uint32_t sample, SoundFontSampleView *view);
+bool soundfont_store_acquire_wait(SoundFontSampleStore *store, uint32_t sample, SoundFontSampleView *view);
+void soundfont_store_release(SoundFontSampleStore *store, uint32_t sample);
+
+#endif
@@ -0,0 +1,750 @@
+/*
+    RIFF file process library
+
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#include "soundfont_synth.h"
+
+#include <math.h>
+
+#include "soundfont_stats.h"
+
+#define SYNTH_MAX_LAYERS 32  // regions one note-on may start
+#define SYNTH_NO_RPN 0x3FFF
+
+static const SoundFontPresetSlot *find_preset(const SoundFontPdtaData *pdta, uint16_t bank, uint8_t program);
+static void reset_channel(SoundFontChannel *channel, uint8_t index);
+static void set_input(SoundFontSynth *synth, uint8_t channel, uint8_t src, uint8_t key, uint16_t value);
+static void start_voice(SoundFontSynth *synth, uint8_t channel, uint8_t key, uint8_t velocity, const SoundFontRegion *region);
+static void release_voice(SoundFontSynth *synth, uint32_t handle);
+static void stop_voice(SoundFontSynth *synth, uint32_t handle);
+static void steal_voice(SoundFontSynth *synth);
+static void update_voice(SoundFontSynth *synth, uint32_t handle);
+static void resume_voice(SoundFontSynth *synth, uint32_t handle);
+static void control_tick(SoundFontSynth *synth);
+static bool load_font(SoundFontFont *font, const char *path, const SoundFontStoreOptions *paging);
+
+void soundfont_init_font(SoundFontFont *font) {
+    memset(font, 0, sizeof(SoundFontFont));
+    soundfont_init_info(&font->info);
+    soundfont_init_sdta(&font->sdta);
+    soundfont_init_pdta(&font->pdta);
+    soundfont_init_regions(&font->regions);
+    soundfont_init_zones(&font->zones);
+    soundfont_init_mods(&font->mods);
+    soundfont_init_prepared(&font->prepared);
+}
+
+/*
+    Reads the three lists of a .sf2 file and compiles the region, zone and modulator tables. The
+    sample data is mapped when the platform allows it and read into memory otherwise.
+*/
+bool soundfont_load_font(SoundFontFont *font, const char *path) {
+    return load_font(font, path, NULL);
+}
+
+/*
+    As soundfont_load_font, but the sample data is left on disk: a store keeps the head of every
+    sample resident and streams whole samples in as voices use them, within options->budget.
+*/
+bool soundfont_load_font_paged(SoundFontFont *font, const char *path, const SoundFontStoreOptions *options) {
+    return load_font(font, path, options);
+}
+
+/*
+    As soundfont_load_font, but the samples are moved into pool and the font keeps no sample data
+    of its own; samples equal to those of fonts already in the pool are not held twice. The pool
+    must outlive the font.
+*/
+bool soundfont_load_font_pooled(SoundFontFont *font, const char *path, SoundFontSamplePool *pool) {
+    if (!load_font(font, path, NULL)) {
+        return false;
+    }
+    font->pooled = (SoundFontPooledSample *)malloc(sizeof(SoundFontPooledSample) * (font->pdta.shdrSize > 0 ? font->pdta.shdrSize : 1));
+    if (NULL == font->pooled || !soundfont_pool_samples(pool, &font->pdta, &font->sdta, font->pooled)) {
+        printf("Failed to pool the samples of %s.\n", path);
+        soundfont_release_font(font);
+        return false;
+    }
+    font->pool = pool;
+    soundfont_release_sdta(&font->sdta);
+
+    return true;
+}
+
+/*
+    Converts the loaded samples to float32 so synths created afterwards mix without widening
+    integers, merging the sm24 low bytes of a version 2.04 or later font. Call it before the font
+    is shared.
+*/
+bool soundfont_convert_font(SoundFontFont *font) {
+    bool merge24 = font->info.major > 2 || (font->info.major == 2 && font->info.minor >= 4);
+    return soundfont_convert_sdta(&font->sdta, merge24);
+}
+
+/*
+    Moves the samples into padded buffers, where every interpolator finds zero points around a
+    sample and wrapped points around its loop, and releases the sdta. prepared.extraBytes tells
+    what that costs over the bare sample points. With levels above 1 the samples are also kept at
+    half and a quarter of their rate, and a voice pitched up far enough plays from those.
+    Only 16-bit samples held in memory are prepared: not those of a converted, paged or pooled
+    font. Call it before the font is shared.
+*/
+bool soundfont_prepare_font(SoundFontFont *font, uint32_t levels) {
+    if (NULL != font->sdta.samples || NULL != font->store || NULL != font->pooled) {
+        printf("Only a font holding its 16-bit samples is prepared.\n");
+        return false;
+    }
+    if (!soundfont_prepare_samples(&font->prepared, &font->pdta, &font->sdta, levels)) {
+        return false;
+    }
+    soundfont_release_sdta(&font->sdta);
+
+    return true;
+}
+
+void soundfont_release_font(SoundFontFont *font) {
+    // before the pdta, which has the sample count
+    if (NULL != font->pooled) {
+        if (NULL != font->pool) {
+            soundfont_pool_drop_samples(font->pool, font->pooled, font->pdta.shdrSize);
+        }
+        free(font->pooled);
+    }
+    soundfont_release_mods(&font->mods);
+    soundfont_release_zones(&font->zones);
+    soundfont_release_regions(&font->regions);
+    soundfont_release_pdta(&font->pdta);
+    soundfont_release_sdta(&font->sdta);
+    soundfont_release_prepared(&font->prepared);
+    if (NULL != font->store) {
+        soundfont_release_store(font->store);
+        free(font->store);
+    }
+    soundfont_release_info(&font->info);
+    soundfont_os_unmap(&font->cache);
+    soundfont_init_font(font);
+}
+
+void soundfont_init_synth(SoundFontSynth *synth) {
+    memset(synth, 0, sizeof(SoundFontSynth));
+    soundfont_init_mixer(&synth->mixer);
+    soundfont_init_envelopes(&synth->volEnv);
+    soundfont_init_envelopes(&synth->modEnv);
+    soundfont_init_lfos(&synth->modLfo);
+    soundfont_init_lfos(&synth->vibLfo);
+}
+
+bool soundfont_create_synth(SoundFontSynth *synth, const SoundFontFont *font, uint32_t sampleRate, uint32_t polyphony) {
+    soundfont_init_synth(synth);
+    synth->font = font;
+    synth->sampleRate = sampleRate > 0 ? sampleRate : 44100;
+    synth->gain = 1.0f;
+
+    float tickRate = (float)synth->sampleRate / SOUNDFONT_SYNTH_BLOCK;
+    SoundFontSampleFormat format = NULL != font->sdta.samples ? SOUNDFONT_SAMPLE_FLOAT : SOUNDFONT_SAMPLE_INT16;
+    if (!soundfont_create_mixer(&synth->mixer, polyphony, SOUNDFONT_SYNTH_BLOCK, SOUNDFONT_INTERP_CUBIC, format)) {
+        return false;
+    }
+    uint32_t capacity = synth->mixer.capacity;
+    bool ok = soundfont_create_envelopes(&synth->volEnv, capacity, tickRate) && soundfont_create_envelopes(&synth->modEnv, capacity, tickRate);
+    ok = ok && soundfont_create_lfos(&synth->modLfo, capacity, tickRate) && soundfont_create_lfos(&synth->vibLfo, capacity, tickRate);
+    synth->memory = ok ? malloc((sizeof(SoundFontSynthVoice) + sizeof(uint32_t)) * capacity) : NULL;
+    if (NULL == synth->memory) {
+        printf("Not enough memory for the synth.\n");
+        soundfont_release_synth(synth);
+        return false;
+    }
+    synth->voices = (SoundFontSynthVoice *)synth->memory;
+    synth->finished = (uint32_t *)(synth->voices + capacity);
+
+    for (uint8_t i = 0; i < SOUNDFONT_SYNTH_CHANNELS; i++) {
+        reset_channel(synth->channels + i, i);
+    }
+
+    return true;
+}
+
+void soundfont_release_synth(SoundFontSynth *synth) {
+    // hands the paged samples of the sounding voices back to the store
+    while (synth->mixer.count > 0) {
+        stop_voice(synth, synth->mixer.handleOf[synth->mixer.count - 1]);
+    }
+    soundfont_release_mixer(&synth->mixer);
+    soundfont_release_envelopes(&synth->volEnv);
+    soundfont_release_envelopes(&synth->modEnv);
+    soundfont_release_lfos(&synth->modLfo);
+    soundfont_release_lfos(&synth->vibLfo);
+    if (NULL != synth->memory) {
+        free(synth->memory);
+    }
+    soundfont_init_synth(synth);
+}
+
+void soundfont_synth_note_on(SoundFontSynth *synth, uint8_t channel, uint8_t key, uint8_t velocity) {
+    if (channel >= SOUNDFONT_SYNTH_CHANNELS || key > 127) {
+        return;
+    }
+    if (0 == velocity) {
+        soundfont_synth_note_off(synth, channel, key);
+        return;
+    }
+
+    // a key struck again releases what it still sounds
+    for (uint32_t slot = 0; slot < synth->mixer.count; slot++) {
+        uint32_t handle = synth->mixer.handleOf[slot];
+        SoundFontSynthVoice *voice = synth->voices + handle;
+        if (voice->channel == channel && voice->key == key && (voice->held || voice->sustained)) {
+            release_voice(synth, handle);
+        }
+    }
+
+    const SoundFontChannel *state = synth->channels + channel;
+    const SoundFontPresetSlot *preset = find_preset(&synth->font->pdta, state->bank, state->program);
+    if (NULL == preset) {
+        return;
+    }
+
+    const SoundFontRegion *regions[SYNTH_MAX_LAYERS];
+    uint32_t count = soundfont_find_regions(&synth->font->regions, preset->presetNdx, key, velocity, regions, SYNTH_MAX_LAYERS);
+    synth->noteCount++;
+    for (uint32_t i = 0; i < count; i++) {
+        start_voice(synth, channel, key, velocity, regions[i]);
+    }
+}
+
+void soundfont_synth_note_off(SoundFontSynth *synth, uint8_t channel, uint8_t key) {
+    if (channel >= SOUNDFONT_SYNTH_CHANNELS) {
+        return;
+    }
+    bool pedal = synth->channels[channel].inputs.cc[64] >= 64;
+    for (uint32_t slot = 0; slot < synth->mixer.count; slot++) {
+        uint32_t handle = synth->mixer.handleOf[slot];
+        SoundFontSynthVoice *voice = synth->voices + handle;
+        if (voice->channel == channel && voice->key == key && voice->held) {
+            voice->held = false;
+            if (pedal) {
+                voice->sustained = true;
+            } else {
+                release_voice(synth, handle);
+            }
+        }
+    }
+}
+
+void soundfont_synth_control_change(SoundFontSynth *synth, uint8_t channel, uint8_t controller, uint8_t value) {
+    if (channel >= SOUNDFONT_SYNTH_CHANNELS || controller > 127) {
+        return;
+    }
+    SoundFontChannel *state = synth->channels + channel;
+    value &= 0x7F;
+
+    switch (controller) {
+        case 0: {
+            // bank select MSB, the percussion channel keeps its bank
+            if (channel != SOUNDFONT_SYNTH_PERCUSSION) {
+                state->bank = value;
+            }
+            break;
+        }
+        case 6: {
+            if (0 == state->rpn) {
+                set_input(synth, channel, SOUNDFONT_MOD_SRC_PITCH_SENSITIVITY, 0, value);
+            }
+            break;
+        }
+        case 100: {
+            state->rpn = (state->rpn & 0x3F80) | value;
+            break;
+        }
+        case 101: {
+            state->rpn = (uint16_t)(value << 7) | (state->rpn & 0x7F);
+            break;
+        }
+        case 120: {
+            // all sound off
+            for (uint32_t slot = synth->mixer.count; slot-- > 0;) {
+                uint32_t handle = synth->mixer.handleOf[slot];
+                if (synth->voices[handle].channel == channel) {
+                    stop_voice(synth, handle);
+                }
+            }
+            return;
+        }
+        case 121: {
+            // reset all controllers, volume and pan stay as they are
+            set_input(synth, channel, SOUNDFONT_MOD_SRC_PITCH_WHEEL, 0, 8192);
+            set_input(synth, channel, SOUNDFONT_MOD_SRC_CHANNEL_PRESSURE, 0, 0);
+            set_input(synth, channel, 1, 0, 0);
+            set_input(synth, channel, 11, 0, 127);
+            soundfont_synth_control_change(synth, channel, 64, 0);
+            state->rpn = SYNTH_NO_RPN;
+            return;
+        }
+        case 123: {
+            // all notes off
+            for (uint32_t slot = 0; slot < synth->mixer.count; slot++) {
+                soundfont_synth_note_off(synth, channel, synth->voices[synth->mixer.handleOf[slot]].key);
+            }
+            return;
+        }
+        default:
+            break;
+    }
+    set_input(synth, channel, controller, 0, value);
+
+    if (64 == controller && value < 64) {
+        for (uint32_t slot = 0; slot < synth->mixer.count; slot++) {
+            uint32_t handle = synth->mixer.handleOf[slot];
+            if (synth->voices[handle].channel == channel && synth->voices[handle].sustained) {
+                release_voice(synth, handle);
+            }
+        }
+    }
+}
+
+void soundfont_synth_program_change(SoundFontSynth *synth, uint8_t channel, uint8_t program) {
+    if (channel < SOUNDFONT_SYNTH_CHANNELS) {
+        synth->channels[channel].program = program & 0x7F;
+    }
+}
+
+void soundfont_synth_pitch_bend(SoundFontSynth *synth, uint8_t channel, uint16_t value) {
+    if (channel < SOUNDFONT_SYNTH_CHANNELS) {
+        set_input(synth, channel, SOUNDFONT_MOD_SRC_PITCH_WHEEL, 0, value);
+    }
+}
+
+void soundfont_synth_key_pressure(SoundFontSynth *synth, uint8_t channel, uint8_t key, uint8_t value) {
+    if (channel < SOUNDFONT_SYNTH_CHANNELS) {
+        set_input(synth, channel, SOUNDFONT_MOD_SRC_POLY_PRESSURE, key, value);
+    }
+}
+
+void soundfont_synth_channel_pressure(SoundFontSynth *synth, uint8_t channel, uint8_t value) {
+    if (channel < SOUNDFONT_SYNTH_CHANNELS) {
+        set_input(synth, channel, SOUNDFONT_MOD_SRC_CHANNEL_PRESSURE, 0, value);
+    }
+}
+
+// dispatches one channel message, as held by SoundFontMidiEvent
+void soundfont_synth_midi(SoundFontSynth *synth, uint8_t status, uint8_t data1, uint8_t data2) {
+    uint8_t channel = status & 0x0F;
+    switch (status & 0xF0) {
+        case SOUNDFONT_MIDI_NOTE_OFF:
+            soundfont_synth_note_off(synth, channel, data1);
+            break;
+        case SOUNDFONT_MIDI_NOTE_ON:
+            soundfont_synth_note_on(synth, channel, data1, data2);
+            break;
+        case SOUNDFONT_MIDI_POLY_PRESSURE:
+            soundfont_synth_key_pressure(synth, channel, data1, data2);
+            break;
+        case SOUNDFONT_MIDI_CONTROL_CHANGE:
+            soundfont_synth_control_change(synth, channel, data1, data2);
+            break;
+        case SOUNDFONT_MIDI_PROGRAM_CHANGE:
+            soundfont_synth_program_change(synth, channel, data1);
+            break;
+        case SOUNDFONT_MIDI_CHANNEL_PRESSURE:
+            soundfont_synth_channel_pressure(synth, channel, data1);
+            break;
+        case SOUNDFONT_MIDI_PITCH_BEND:
+            soundfont_synth_pitch_bend(synth, channel, (uint16_t)(data1 | data2 << 7));
+            break;
+        default:
+            break;
+    }
+}
+
+uint32_t soundfont_synth_active(const SoundFontSynth *synth) {
+    return synth->mixer.count;
+}
+
+// the synth clock, safe to read from any thread for stamping events
+uint64_t soundfont_synth_now(const SoundFontSynth *synth) {
+    return __atomic_load_n(&synth->frame, __ATOMIC_RELAXED);
+}
+
+/*
+    Renders frames of output, overwriting left and right. Envelopes, LFOs and modulators are applied
+    to the mixer every SOUNDFONT_SYNTH_BLOCK frames of the synth clock whatever the lengths of the
+    calls, so output may be split at any frame.
+*/
+void soundfont_synth_render(SoundFontSynth *synth, float *left, float *right, uint32_t frames) {
+    SOUNDFONT_STATS_BEGIN(timer);
+    uint32_t done = 0;
+    while (done < frames) {
+        if (0 == synth->tickLeft) {
+            control_tick(synth);
+            synth->tickLeft = SOUNDFONT_SYNTH_BLOCK;
+        }
+        uint32_t todo = frames - done < synth->tickLeft ? frames - done : synth->tickLeft;
+
+        uint32_t finished = soundfont_mixer_render(&synth->mixer, todo, synth->finished, synth->mixer.capacity);
+        for (uint32_t i = 0; i < finished; i++) {
+            stop_voice(synth, synth->finished[i]);
+        }
+        memcpy(left + done, synth->mixer.busLeft, sizeof(float) * todo);
+        memcpy(right + done, synth->mixer.busRight, sizeof(float) * todo);
+        synth->tickLeft -= todo;
+        __atomic_store_n(&synth->frame, synth->frame + todo, __ATOMIC_RELAXED);
+        done += todo;
+    }
+    SOUNDFONT_STATS_ADD(SOUNDFONT_COUNT_FRAMES_RENDERED, frames);
+    SOUNDFONT_STATS_END(SOUNDFONT_PHASE_RENDER, timer);
+}
+
+/*
+    Renders like soundfont_synth_render on the audio thread, applying the queued events at their
+    frames: the output is split wherever an event falls inside it. Events stamped in the past apply
+    at the start of the call, events past the end stay queued for a later call.
+*/
+void soundfont_synth_render_events(SoundFontSynth *synth, SoundFontEventQueue *queue, float *left, float *right, uint32_t frames) {
+    SoundFontEvent event;
+    uint32_t done = 0;
+    while (done < frames) {
+        uint32_t todo = frames - done;
+        while (soundfont_queue_peek(queue, &event)) {
+            if (event.frame > synth->frame) {
+                if (event.frame - synth->frame < todo) {
+                    todo = (uint32_t)(event.frame - synth->frame);
+                }
+                break;
+            }
+            soundfont_synth_midi(synth, event.status, event.data1, event.data2);
+            soundfont_queue_pop(queue, &event);
+        }
+        soundfont_synth_render(synth, left + done, right + done, todo);
+        done += todo;
+    }
+}
+
+// falls back to the first bank of the same kind when the selected bank lacks the program
+static const SoundFontPresetSlot *find_preset(const SoundFontPdtaData *pdta, uint16_t bank, uint8_t program) {
+    const SoundFontPresetSlot *preset = soundfont_find_preset(pdta, bank, program);
+    if (NULL == preset) {
+        preset = bank == SOUNDFONT_PERCUSSION_BANK ? soundfont_find_preset(pdta, bank, 0) : soundfont_find_preset(pdta, 0, program);
+    }
+    return preset;
+}
+
+static void reset_channel(SoundFontChannel *channel, uint8_t index) {
+    soundfont_mod_inputs_reset(&channel->inputs);
+    channel->bank = index == SOUNDFONT_SYNTH_PERCUSSION ? SOUNDFONT_PERCUSSION_BANK : 0;
+    channel->program = 0;
+    channel->rpn = SYNTH_NO_RPN;
+}
+
+// stores a modulator input of a channel and re-evaluates the voices that read it
+static void set_input(SoundFontSynth *synth, uint8_t channel, uint8_t src, uint8_t key, uint16_t value) {
+    const SoundFontModInputs *inputs = &synth->channels[channel].inputs;
+    if (!soundfont_mod_set_input(&synth->channels[channel].inputs, src, key, value)) {
+        return;
+    }
+    for (uint32_t slot = 0; slot < synth->mixer.count; slot++) {
+        SoundFontSynthVoice *voice = synth->voices + synth->mixer.handleOf[slot];
+        if (voice->channel == channel && (src != SOUNDFONT_MOD_SRC_POLY_PRESSURE || voice->key == key)) {
+            soundfont_mod_voice_update(&voice->mod, inputs, src);
+        }
+    }
+}
+
+static void start_voice(SoundFontSynth *synth, uint8_t channel, uint8_t key, uint8_t velocity, const SoundFontRegion *region) {
+    const SoundFontFont *font = synth->font;
+    SoundFontZone zone;
+    SoundFontSampleView view;
+    soundfont_resolve_zone(&font->zones, region, &zone);
+    // a paged sample that is not resident starts on its head and never waits for the disk
+    bool holding = false;
+    if (NULL != font->store) {
+        holding = font->store->options.wait ? soundfont_store_acquire_wait(font->store, region->sample, &view)
+                                            : soundfont_store_acquire(font->store, region->sample, &view);
+        if (!holding && !soundfont_store_head(font->store, region->sample, &view)) {
+            return;
+        }
+    } else if (NULL != font->pooled) {
+        if (!soundfont_pool_view(font->pooled + region->sample, soundfont_pdta_sample(&font->pdta, region->sample), &view)) {
+            return;
+        }
+    } else if (NULL != font->prepared.points) {
+        if (!soundfont_prepared_view(&font->prepared, region->sample, 0, &view)) {
+            return;
+        }
+    } else if (!soundfont_sample_view(&view, &font->sdta, soundfont_pdta_sample(&font->pdta, region->sample))) {
+        return;
+    }
+
+    // an exclusive class silences the channel's earlier notes of the same class
+    uint16_t exclusiveClass = zone.gen[SOUNDFONT_GEN_EXCLUSIVE_CLASS].word;
+    if (0 != exclusiveClass) {
+        for (uint32_t slot = synth->mixer.count; slot-- > 0;) {
+            uint32_t handle = synth->mixer.handleOf[slot];
+            const SoundFontSynthVoice *other = synth->voices + handle;
+            if (other->channel == channel && other->exclusiveClass == exclusiveClass && other->age < synth->noteCount) {
+                stop_voice(synth, handle);
+            }
+        }
+    }
+    if (synth->mixer.count >= synth->mixer.capacity) {
+        steal_voice(synth);
+    }
+
+    SoundFontVoice playback;
+    soundfont_voice_init(&playback, &view, synth->sampleRate);
+    soundfont_voice_apply_zone(&playback, &zone, key);
+    // a voice playing two or four points per frame takes the decimated level instead, unless address offsets point into the sample
+    bool whole = playback.start == view.start && playback.end == view.end;
+    bool loopAsIs = playback.loopMode == SOUNDFONT_LOOP_NONE || playback.loopMode == SOUNDFONT_LOOP_UNUSED || (playback.loopStart == view.startLoop && playback.loopEnd == view.endLoop);
+    if (font->prepared.levels > 1 && whole && loopAsIs && playback.increment >= (2ull << 32)) {
+        uint32_t level = playback.increment >= (4ull << 32) && font->prepared.levels > 2 ? 2 : 1;
+        // a sample whose loop is too short for a level has none, the next lower one does
+        while (level > 0 && !soundfont_prepared_view(&font->prepared, region->sample, level, &view)) {
+            level--;
+        }
+        if (level > 0) {
+            soundfont_voice_init(&playback, &view, synth->sampleRate);
+            soundfont_voice_apply_zone(&playback, &zone, key);
+        }
+    }
+    playback.interp = synth->mixer.interp;
+    playback.gainLeft = 0.0f;
+    playback.gainRight = 0.0f;
+    uint32_t handle = soundfont_mixer_add(&synth->mixer, &playback);
+    if (handle == SOUNDFONT_MIXER_NONE) {
+        if (holding) {
+            soundfont_store_release(font->store, region->sample);
+        }
+        return;
+    }
+
+    SOUNDFONT_STATS_ADD(SOUNDFONT_COUNT_VOICES_STARTED, 1);
+
+    SoundFontSynthVoice *voice = synth->voices + handle;
+    voice->zone = zone;
+    voice->voice = playback;
+    voice->age = synth->noteCount;
+    voice->exclusiveClass = exclusiveClass;
+    voice->sample = region->sample;
+    voice->streaming = NULL != font->store && !holding;
+    voice->holding = holding;
+    voice->channel = channel;
+    voice->key = key;
+    voice->held = true;
+    voice->sustained = false;
+    soundfont_mod_voice_start(&voice->mod, &font->mods, (uint32_t)(region - font->regions.regions), key, velocity, &synth->channels[channel].inputs);
+
+    // envelope and LFO timings take their modulation once, at note-on
+    for (int i = SOUNDFONT_GEN_DELAY_MOD_LFO; i <= SOUNDFONT_GEN_KEYNUM_TO_VOL_ENV_DECAY; i++) {
+        int32_t value = zone.gen[i].value + (int32_t)lrintf(voice->mod.mod[i]);
+        zone.gen[i].value = value < INT16_MIN ? INT16_MIN : (value > INT16_MAX ? INT16_MAX : value);
+    }
+    SoundFontEnvelopeSegments segments;
+    soundfont_envelope_segments(&segments, &zone, key, SOUNDFONT_ENV_VOLUME, synth->volEnv.tickRate);
+    soundfont_envelope_start(&synth->volEnv, handle, &segments);
+    soundfont_envelope_segments(&segments, &zone, key, SOUNDFONT_ENV_MODULATION, synth->modEnv.tickRate);
+    soundfont_envelope_start(&synth->modEnv, handle, &segments);
+    soundfont_lfo_start(&synth->modLfo, handle, &zone, SOUNDFONT_LFO_MODULATION);
+    soundfont_lfo_start(&synth->vibLfo, handle, &zone, SOUNDFONT_LFO_VIBRATO);
+
+    // inside a control block the voice takes its first tick at once, so it sounds from this frame
+    if (synth->tickLeft > 0) {
+        soundfont_envelope_step(&synth->volEnv, handle);
+        soundfont_envelope_step(&synth->modEnv, handle);
+        update_voice(synth, handle);
+    }
+}
+
+static void release_voice(SoundFontSynth *synth, uint32_t handle) {
+    synth->voices[handle].held = false;
+    synth->voices[handle].sustained = false;
+    soundfont_envelope_release(&synth->volEnv, handle);
+    soundfont_envelope_release(&synth->modEnv, handle);
+    soundfont_mixer_release(&synth->mixer, handle);
+}
+
+static void stop_voice(SoundFontSynth *synth, uint32_t handle) {
+    SoundFontSynthVoice *voice = synth->voices + handle;
+    if (voice->holding) {
+        soundfont_store_release(synth->font->store, voice->sample);
+    }
+    voice->streaming = false;
+    voice->holding = false;
+    soundfont_mixer_remove(&synth->mixer, handle);
+    soundfont_envelope_stop(&synth->volEnv, handle);
+    soundfont_envelope_stop(&synth->modEnv, handle);
+    soundfont_lfo_stop(&synth->modLfo, handle);
+    soundfont_lfo_stop(&synth->vibLfo, handle);
+}
+
+// frees a slot for a new note: the oldest released voice, or the oldest voice when all are held
+static void steal_voice(SoundFontSynth *synth) {
+    uint32_t victim = SOUNDFONT_MIXER_NONE;
+    bool victimHeld = true;
+    for (uint32_t slot = 0; slot < synth->mixer.count; slot++) {
+        uint32_t handle = synth->mixer.handleOf[slot];
+        const SoundFontSynthVoice *voice = synth->voices + handle;
+        bool held = voice->held || voice->sustained;
+        if (victim == SOUNDFONT_MIXER_NONE || (victimHeld && !held) || (held == victimHeld && voice->age < synth->voices[victim].age)) {
+            victim = handle;
+            victimHeld = held;
+        }
+    }
+    if (victim != SOUNDFONT_MIXER_NONE) {
+        stop_voice(synth, victim);
+        SOUNDFONT_STATS_ADD(SOUNDFONT_COUNT_VOICES_STOLEN, 1);
+    }
+}
+
+/*
+    Applies the envelopes, LFOs and modulator offsets of one voice to its mixer slot: gain and pan
+    from the volume envelope and attenuation, the increment from the pitch terms and the low-pass
+    cutoff from the filter terms. The filter is the mixer's one-pole, the resonance is not used.
+*/
+static void update_voice(SoundFontSynth *synth, uint32_t handle) {
+    SoundFontSynthVoice *voice = synth->voices + handle;
+    const SoundFontGenAmount *gen = voice->zone.gen;
+    const float *mod = voice->mod.mod;
+    float modLfo = synth->modLfo.value[handle];
+    float vibLfo = synth->vibLfo.value[handle];
+    float modEnv = synth->modEnv.level[handle];
+
+    // centibels of attenuation, the LFO swings the volume both ways
+    float attenuation = gen[SOUNDFONT_GEN_INITIAL_ATTENUATION].value + mod[SOUNDFONT_GEN_INITIAL_ATTENUATION];
+    attenuation -= (gen[SOUNDFONT_GEN_MOD_LFO_TO_VOLUME].value + mod[SOUNDFONT_GEN_MOD_LFO_TO_VOLUME]) * modLfo;
+    attenuation = attenuation < 0.0f ? 0.0f : (attenuation > 1440.0f ? 1440.0f : attenuation);
+    float amplitude = synth->volEnv.level[handle] * powf(10.0f, -attenuation / 200.0f) * synth->gain;
+
+    float pan = (gen[SOUNDFONT_GEN_PAN].value + mod[SOUNDFONT_GEN_PAN]) / 1000.0f;
+    pan = pan < -0.5f ? -0.5f : (pan > 0.5f ? 0.5f : pan);
+    float angle = (pan + 0.5f) * 1.5707963f;
+    soundfont_mixer_set_gain(&synth->mixer, handle, amplitude * cosf(angle), amplitude * sinf(angle));
+
+    double cents = mod[SOUNDFONT_GEN_FINE_TUNE] + 100.0 * mod[SOUNDFONT_GEN_COARSE_TUNE];
+    cents += (gen[SOUNDFONT_GEN_MOD_LFO_TO_PITCH].value + mod[SOUNDFONT_GEN_MOD_LFO_TO_PITCH]) * modLfo;
+    cents += (gen[SOUNDFONT_GEN_VIB_LFO_TO_PITCH].value + mod[SOUNDFONT_GEN_VIB_LFO_TO_PITCH]) * vibLfo;
+    cents += (gen[SOUNDFONT_GEN_MOD_ENV_TO_PITCH].value + mod[SOUNDFONT_GEN_MOD_ENV_TO_PITCH]) * modEnv;
+    soundfont_voice_set_pitch(&voice->voice, cents);
+    soundfont_mixer_set_increment(&synth->mixer, handle, voice->voice.increment);
+
+    float cutoff = gen[SOUNDFONT_GEN_INITIAL_FILTER_FC].value + mod[SOUNDFONT_GEN_INITIAL_FILTER_FC];
+    cutoff += (gen[SOUNDFONT_GEN_MOD_LFO_TO_FILTER_FC].value + mod[SOUNDFONT_GEN_MOD_LFO_TO_FILTER_FC]) * modLfo;
+    cutoff += (gen[SOUNDFONT_GEN_MOD_ENV_TO_FILTER_FC].value + mod[SOUNDFONT_GEN_MOD_ENV_TO_FILTER_FC]) * modEnv;
+    // 13500 cents and above leave the filter open, an infinite cutoff is the mixer's bypass
+    soundfont_mixer_set_cutoff(&synth->mixer, handle, cutoff >= 13500.0f ? HUGE_VALF : 8.176f * exp2f(cutoff / 1200.0f), synth->sampleRate);
+}
+
+// moves a voice started on the head of a paged sample to the whole sample once it is resident
+static void resume_voice(SoundFontSynth *synth, uint32_t handle) {
+    SoundFontSynthVoice *voice = synth->voices + handle;
+    SoundFontSampleView view;
+    if (!soundfont_store_acquire(synth->font->store, voice->sample, &view)) {
+        return;
+    }
+    voice->voice.view = view;
+    voice->streaming = false;
+    voice->holding = true;
+    soundfont_mixer_set_source(&synth->mixer, handle, &voice->voice);
+}
+
+static void control_tick(SoundFontSynth *synth) {
+    SOUNDFONT_STATS_BEGIN(timer);
+    soundfont_advance_envelopes(&synth->volEnv);
+    soundfont_advance_envelopes(&synth->modEnv);
+    soundfont_advance_lfos(&synth->modLfo);
+    soundfont_advance_lfos(&synth->vibLfo);
+
+    for (uint32_t slot = synth->mixer.count; slot-- > 0;) {
+        uint32_t handle = synth->mixer.handleOf[slot];
+        if (soundfont_envelope_done(&synth->volEnv, handle)) {
+            stop_voice(synth, handle);
+        } else {
+            if (synth->voices[handle].streaming) {
+                resume_voice(synth, handle);
+            }
+            update_voice(synth, handle);
+        }
+    }
+    SOUNDFONT_STATS_END(SOUNDFONT_PHASE_CONTROL_TICK, timer);
+}
+
+static bool load_font(SoundFontFont *font, const char *path, const SoundFontStoreOptions *paging) {
+    SOUNDFONT_STATS_BEGIN(timer);
+    soundfont_init_font(font);
+
+    FILE *file = fopen(path, "rb");
+    if (NULL == file) {
+        printf("Can't open the sound font %s.\n", path);
+        return false;
+    }
+
+    // the lists are read through the chunk directory, in whatever order the file has them
+    SoundFontChunkDirectory directory;
+    soundfont_init_chunks(&directory);
+    if (!soundfont_scan_chunks(&directory, file)) {
+        printf("%s is not a sound font 2 file.\n", path);
+        fclose(file);
+        return false;
+    }
+
+    const SoundFontChunk *info = soundfont_find_chunk(&directory, "", "INFO");
+    if (NULL != info && soundfont_os_seek(file, info->offset)) {
+        font->info.size = info->size;
+        soundfont_read_info(&font->info, file);
+    }
+    bool ok = soundfont_read_pdta_parallel(&font->pdta, &directory, file, 0);
+    if (ok && NULL == paging) {
+        SoundFontSdtaLocation location;
+        ok = soundfont_find_sdta(&directory, &location);
+        if (ok && !soundfont_map_sdta_at(&font->sdta, file, &location, SOUNDFONT_ADVICE_RANDOM)) {
+            ok = soundfont_os_seek(file, location.smplOffset - 8) && soundfont_read_sdta(&font->sdta, file);
+        }
+    }
+    soundfont_release_chunks(&directory);
+    fclose(file);
+
+    ok = ok && NULL != font->pdta.shdr;
+    if (ok && NULL != paging) {
+        font->store = (SoundFontSampleStore *)malloc(sizeof(SoundFontSampleStore));
+        ok = NULL != font->store;
+        if (ok && !soundfont_open_store(font->store, path, &font->pdta, paging)) {
+            free(font->store);
+            font->store = NULL;
+            ok = false;
+        }
+    }
+    ok = ok && (NULL != font->sdta.data || NULL != font->store);
+    SOUNDFONT_STATS_BEGIN(building);
+    ok = ok && soundfont_build_regions(&font->regions, &font->pdta) && soundfont_build_zones(&font->zones, &font->pdta);
+    ok = ok && soundfont_build_mods(&font->mods, &font->pdta, &font->regions);
+    if (!ok) {
+        printf("Failed to load the sound font %s.\n", path);
+        soundfont_release_font(font);
+        return false;
+    }
+    SOUNDFONT_STATS_END(SOUNDFONT_PHASE_TABLES_BUILD, building);
+    SOUNDFONT_STATS_END(SOUNDFONT_PHASE_FONT_LOAD, timer);
+
+    return true;
+}
@@ -0,0 +1,134 @@
+/*
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#ifndef CMANLH_SOUNDFONT_SYNTH
+#define CMANLH_SOUNDFONT_SYNTH
+
+#include "soundfont_envelope.h"
+#include "soundfont_midi.h"
+#include "soundfont_mixer.h"
+#include "soundfont_modulator.h"
+#include "soundfont_pool.h"
+#include "soundfont_prepare.h"
+#include "soundfont_queue.h"
+#include "soundfont_store.h"
+
+#define SOUNDFONT_SYNTH_BLOCK 64  // frames per control tick
+#define SOUNDFONT_SYNTH_CHANNELS 16
+#define SOUNDFONT_SYNTH_PERCUSSION 9  // channel playing the percussion bank, MIDI channel 10
+
+/*
+    Everything loaded from one .sf2 file plus the tables compiled from it. After
+    soundfont_load_font returns nothing in here is written again, so any number of synths on any
+    number of threads may share one font. A font loaded by soundfont_load_font_paged has no sdta;
+    its samples come from the store, and one loaded by soundfont_load_font_pooled has none either;
+    its samples are buffers of the pool. soundfont_prepare_font moves the samples of a font
+    holding its sdta into padded buffers.
+*/
+typedef struct SoundFontFont {
+    SoundFontInfo info;
+    SoundFontSdtaData sdta;
+    SoundFontSampleStore *store;  // NULL unless the samples are paged
+    SoundFontSamplePool *pool;    // NULL unless the samples are shared with other fonts
+    SoundFontPooledSample *pooled;  // one per sample header when pooled
+    SoundFontPreparedSamples prepared;  // set when the samples moved into padded buffers
+    SoundFontPdtaData pdta;
+    SoundFontRegionIndex regions;
+    SoundFontZoneTable zones;
+    SoundFontModTable mods;
+    SoundFontMapping cache;  // set when the tables point into a mapped cache file
+} SoundFontFont;
+
+// per voice bookkeeping, indexed by mixer handle
+typedef struct SoundFontSynthVoice {
+    SoundFontModVoice mod;
+    SoundFontZone zone;    // resolved generators of the region, without modulation
+    SoundFontVoice voice;  // base pitch and rate ratio, the mixer holds the playback state
+    uint64_t age;          // note-on order, the oldest voice is stolen first
+    uint16_t exclusiveClass;
+    uint16_t sample;  // index into shdr
+    uint8_t channel;
+    uint8_t key;
+    bool held;       // the key is down
+    bool sustained;  // the key is up but the sustain pedal holds the note
+    bool streaming;  // plays the head of a paged sample until the whole sample is resident
+    bool holding;    // holds the whole paged sample, released when the voice stops
+} SoundFontSynthVoice;
+
+typedef struct SoundFontChannel {
+    SoundFontModInputs inputs;
+    uint16_t bank;
+    uint8_t program;
+    uint16_t rpn;  // selected registered parameter, 0x3FFF when none
+} SoundFontChannel;
+
+/*
+    A complete synthesizer over a shared, read-only font: the mixer, envelope and LFO banks and the
+    state of sixteen MIDI channels. All of it is owned by the synth, one synth per thread.
+*/
+typedef struct SoundFontSynth {
+    const SoundFontFont *font;
+    uint32_t sampleRate;
+    float gain;  // master gain applied to every voice
+    SoundFontMixer mixer;
+    SoundFontEnvelopes volEnv;
+    SoundFontEnvelopes modEnv;
+    SoundFontLfos modLfo;
+    SoundFontLfos vibLfo;
+    void *memory;
+    SoundFontSynthVoice *voices;  // mixer.capacity entries
+    uint32_t *finished;           // handles the mixer retired during the last block
+    uint64_t noteCount;
+    uint64_t frame;     // frames rendered so far, the clock events are stamped against
+    uint32_t tickLeft;  // frames left until the next control tick
+    SoundFontChannel channels[SOUNDFONT_SYNTH_CHANNELS];
+} SoundFontSynth;
+
+void soundfont_init_font(SoundFontFont *font);
+bool soundfont_load_font(SoundFontFont *font, const char *path);
+bool soundfont_load_font_paged(SoundFontFont *font, const char *path, const SoundFontStoreOptions *options);
+bool soundfont_load_font_pooled(SoundFontFont *font, const char *path, SoundFontSamplePool *pool);
+bool soundfont_convert_font(SoundFontFont *font);
+bool soundfont_prepare_font(SoundFontFont *font, uint32_t levels);
+void soundfont_release_font(SoundFontFont *font);
+
+void soundfont_init_synth(SoundFontSynth *synth);
+bool soundfont_create_synth(SoundFontSynth *synth, const SoundFontFont *font, uint32_t sampleRate, uint32_t polyphony);
+void soundfont_release_synth(SoundFontSynth *synth);
+
+void soundfont_synth_note_on(SoundFontSynth *synth, uint8_t channel, uint8_t key, uint8_t velocity);
+void soundfont_synth_note_off(SoundFontSynth *synth, uint8_t channel, uint8_t key);
+void soundfont_synth_control_change(SoundFontSynth *synth, uint8_t channel, uint8_t controller, uint8_t value);
+void soundfont_synth_program_change(SoundFontSynth *synth, uint8_t channel, uint8_t program);
+void soundfont_synth_pitch_bend(SoundFontSynth *synth, uint8_t channel, uint16_t value);
+void soundfont_synth_key_pressure(SoundFontSynth *synth, uint8_t channel, uint8_t key, uint8_t value);
+void soundfont_synth_channel_pressure(SoundFontSynth *synth, uint8_t channel, uint8_t value);
+void soundfont_synth_midi(SoundFontSynth *synth, uint8_t status, uint8_t data1, uint8_t data2);
+
+uint32_t soundfont_synth_active(const SoundFontSynth *synth);
+uint64_t soundfont_synth_now(const SoundFontSynth *synth);
+void soundfont_synth_render(SoundFontSynth *synth, float *left, float *right, uint32_t frames);
+void soundfont_synth_render_events(SoundFontSynth *synth, SoundFontEventQueue *queue, float *left, float *right, uint32_t frames);
+
+#endif
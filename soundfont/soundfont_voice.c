@@ -0,0 +1,374 @@
+/*
+    RIFF file process library
+
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#include "soundfont_voice.h"
+
+#include <math.h>
+
+#include "soundfont_simd.h"
+
+#define SAMPLE_SCALE (1.0f / 32768.0f)
+
+static bool voice_looping(const SoundFontVoice *voice);
+static float edge_tap(const SoundFontVoice *voice, int64_t index, bool looping);
+static float interpolate_edge(const SoundFontVoice *voice, uint32_t index, float frac, bool looping);
+static void interp_linear(const int16_t *src, const int32_t *idx, const float *frac, float *out, uint32_t n);
+static void interp_cubic(const int16_t *src, const int32_t *idx, const float *frac, float *out, uint32_t n);
+
+bool soundfont_sample_view(SoundFontSampleView *view, const SoundFontSdtaData *sdta, const SoundFontSample *sample) {
+    uint32_t frames = sdta->size / 2;
+    if (NULL == sdta->data || sample->start >= sample->end || sample->end > frames) {
+        return false;
+    }
+
+    view->data = (const int16_t *)sdta->data;
+    view->samples = sdta->samples;
+    view->frames = frames;
+    view->start = sample->start;
+    view->end = sample->end;
+    view->startLoop = sample->startLoop;
+    view->endLoop = sample->endLoop;
+    view->loopCopy = 0;
+    view->sampleRate = sample->sampleRate > 0 ? sample->sampleRate : 44100;
+    view->originalPitch = sample->originalPitch <= 127 ? sample->originalPitch : 60;
+    view->pitchCorrection = (int8_t)sample->pitchCorrection;
+
+    return true;
+}
+
+// a view of a copy of the sample's points, data holding frames points from smpl position origin on
+void soundfont_sample_view_at(SoundFontSampleView *view, const int16_t *data, uint32_t frames, uint32_t origin, const SoundFontSample *sample) {
+    view->data = data;
+    view->samples = NULL;
+    view->frames = frames;
+    view->start = sample->start - origin;
+    view->end = sample->end - origin;
+    view->startLoop = sample->startLoop > origin ? sample->startLoop - origin : 0;
+    view->endLoop = sample->endLoop > origin ? sample->endLoop - origin : 0;
+    view->loopCopy = 0;
+    view->sampleRate = sample->sampleRate > 0 ? sample->sampleRate : 44100;
+    view->originalPitch = sample->originalPitch <= 127 ? sample->originalPitch : 60;
+    view->pitchCorrection = (int8_t)sample->pitchCorrection;
+}
+
+void soundfont_voice_init(SoundFontVoice *voice, const SoundFontSampleView *view, uint32_t outputRate) {
+    voice->view = *view;
+    voice->start = view->start;
+    voice->end = view->end;
+    voice->loopStart = view->startLoop;
+    voice->loopEnd = view->endLoop;
+    voice->phase = (uint64_t)view->start << 32;
+    voice->pitch = view->pitchCorrection;
+    voice->rateRatio = (double)view->sampleRate / (double)(outputRate > 0 ? outputRate : 44100);
+    voice->loopMode = SOUNDFONT_LOOP_NONE;
+    voice->interp = SOUNDFONT_INTERP_LINEAR;
+    voice->gainLeft = 1.0f;
+    voice->gainRight = 1.0f;
+    voice->released = false;
+    voice->finished = false;
+
+    soundfont_voice_set_pitch(voice, 0);
+}
+
+/*
+    Applies the sample addressing, loop mode and tuning generators of a resolved zone for the
+    given MIDI key.
+*/
+void soundfont_voice_apply_zone(SoundFontVoice *voice, const SoundFontZone *zone, uint8_t key) {
+    const SoundFontGenAmount *gen = zone->gen;
+    int64_t start = (int64_t)voice->view.start + gen[SOUNDFONT_GEN_START_ADDRS_OFFSET].value + 32768 * gen[SOUNDFONT_GEN_START_ADDRS_COARSE_OFFSET].value;
+    int64_t end = (int64_t)voice->view.end + gen[SOUNDFONT_GEN_END_ADDRS_OFFSET].value + 32768 * gen[SOUNDFONT_GEN_END_ADDRS_COARSE_OFFSET].value;
+    int64_t loopStart = (int64_t)voice->view.startLoop + gen[SOUNDFONT_GEN_STARTLOOP_ADDRS_OFFSET].value + 32768 * gen[SOUNDFONT_GEN_STARTLOOP_ADDRS_COARSE_OFFSET].value;
+    int64_t loopEnd = (int64_t)voice->view.endLoop + gen[SOUNDFONT_GEN_ENDLOOP_ADDRS_OFFSET].value + 32768 * gen[SOUNDFONT_GEN_ENDLOOP_ADDRS_COARSE_OFFSET].value;
+
+    // offsets may move the points inside the sample, never outside of it
+    if (start < voice->view.start || start >= voice->view.end) {
+        start = voice->view.start;
+    }
+    if (end <= start || end > voice->view.end) {
+        end = voice->view.end;
+    }
+    voice->start = (uint32_t)start;
+    voice->end = (uint32_t)end;
+    voice->phase = (uint64_t)voice->start << 32;
+
+    voice->loopMode = (SoundFontLoopMode)(gen[SOUNDFONT_GEN_SAMPLE_MODES].word & 3);
+    if (loopStart < start || loopEnd > end || loopEnd <= loopStart) {
+        voice->loopMode = SOUNDFONT_LOOP_NONE;
+    } else {
+        voice->loopStart = (uint32_t)loopStart;
+        voice->loopEnd = (uint32_t)loopEnd;
+    }
+
+    int root = gen[SOUNDFONT_GEN_OVERRIDING_ROOT_KEY].value >= 0 ? gen[SOUNDFONT_GEN_OVERRIDING_ROOT_KEY].value : voice->view.originalPitch;
+    int pitchKey = gen[SOUNDFONT_GEN_KEYNUM].value >= 0 ? gen[SOUNDFONT_GEN_KEYNUM].value : key;
+    voice->pitch = (double)(pitchKey - root) * gen[SOUNDFONT_GEN_SCALE_TUNING].value + gen[SOUNDFONT_GEN_COARSE_TUNE].value * 100.0 +
+                   gen[SOUNDFONT_GEN_FINE_TUNE].value + voice->view.pitchCorrection;
+
+    soundfont_voice_set_pitch(voice, 0);
+}
+
+// cents are added to the zone pitch, for pitch bend, vibrato and the like
+void soundfont_voice_set_pitch(SoundFontVoice *voice, double cents) {
+    double increment = pow(2.0, (voice->pitch + cents) / 1200.0) * voice->rateRatio;
+    // keep at least one step so a voice always advances, and at most 1024 frames per output frame
+    if (increment > 1024.0) {
+        increment = 1024.0;
+    }
+    voice->increment = (uint64_t)(increment * 4294967296.0);
+    if (voice->increment == 0) {
+        voice->increment = 1;
+    }
+}
+
+void soundfont_voice_release(SoundFontVoice *voice) {
+    voice->released = true;
+}
+
+/*
+    Adds up to frames of output to left and right. Runs where every interpolation tap lies inside
+    the playable range go through the vector kernels; the few frames next to a loop point or the
+    sample boundaries are interpolated one at a time with wrap-aware taps.
+*/
+uint32_t soundfont_voice_render(SoundFontVoice *voice, float *left, float *right, uint32_t frames) {
+    int32_t idx[SOUNDFONT_VOICE_BLOCK];
+    float frac[SOUNDFONT_VOICE_BLOCK];
+    float mono[SOUNDFONT_VOICE_BLOCK];
+
+    uint32_t tapsBefore = voice->interp != SOUNDFONT_INTERP_LINEAR ? 1 : 0;
+    uint32_t tapsAfter = voice->interp != SOUNDFONT_INTERP_LINEAR ? 2 : 1;
+
+    uint32_t done = 0;
+    while (done < frames && !voice->finished) {
+        uint32_t todo = frames - done < SOUNDFONT_VOICE_BLOCK ? frames - done : SOUNDFONT_VOICE_BLOCK;
+        uint32_t produced = 0;
+
+        while (produced < todo) {
+            bool looping = voice_looping(voice);
+            uint32_t limit = looping ? voice->loopEnd : voice->end;
+            uint32_t index = (uint32_t)(voice->phase >> 32);
+
+            if (index >= limit) {
+                if (looping) {
+                    voice->phase -= (uint64_t)(voice->loopEnd - voice->loopStart) << 32;
+                    continue;
+                }
+                voice->finished = true;
+                break;
+            }
+
+            if (index >= voice->start + tapsBefore && limit > tapsAfter && index < limit - tapsAfter) {
+                // every frame up to the last index whose taps stay below the limit
+                uint64_t bound = (uint64_t)(limit - tapsAfter) << 32;
+                uint64_t run = (bound - voice->phase + voice->increment - 1) / voice->increment;
+                uint32_t n = run < todo - produced ? (uint32_t)run : todo - produced;
+
+                uint64_t phase = voice->phase;
+                for (uint32_t k = 0; k < n; k++) {
+                    idx[k] = (int32_t)(phase >> 32);
+                    frac[k] = (float)((uint32_t)phase >> 8) * (1.0f / 16777216.0f);
+                    phase += voice->increment;
+                }
+                voice->phase = phase;
+
+                if (voice->interp != SOUNDFONT_INTERP_LINEAR) {
+                    interp_cubic(voice->view.data, idx, frac, mono + produced, n);
+                } else {
+                    interp_linear(voice->view.data, idx, frac, mono + produced, n);
+                }
+                produced += n;
+            } else {
+                float f = (float)((uint32_t)voice->phase >> 8) * (1.0f / 16777216.0f);
+                mono[produced++] = interpolate_edge(voice, index, f, looping);
+                voice->phase += voice->increment;
+            }
+        }
+
+        float gainLeft = voice->gainLeft;
+        float gainRight = voice->gainRight;
+        float *outLeft = left + done;
+        float *outRight = right + done;
+        for (uint32_t k = 0; k < produced; k++) {
+            outLeft[k] += mono[k] * gainLeft;
+            outRight[k] += mono[k] * gainRight;
+        }
+        done += produced;
+    }
+
+    return done;
+}
+
+static bool voice_looping(const SoundFontVoice *voice) {
+    return voice->loopMode == SOUNDFONT_LOOP_CONTINUOUS || (voice->loopMode == SOUNDFONT_LOOP_SUSTAIN && !voice->released);
+}
+
+static float edge_tap(const SoundFontVoice *voice, int64_t index, bool looping) {
+    if (looping && index >= voice->loopEnd) {
+        index -= voice->loopEnd - voice->loopStart;
+    }
+    if (index < voice->start) {
+        index = voice->start;
+    }
+    if (index >= voice->end) {
+        return 0.0f;
+    }
+
+    return voice->view.data[index] * SAMPLE_SCALE;
+}
+
+static float interpolate_edge(const SoundFontVoice *voice, uint32_t index, float frac, bool looping) {
+    float x0 = edge_tap(voice, index, looping);
+    float x1 = edge_tap(voice, (int64_t)index + 1, looping);
+    if (voice->interp == SOUNDFONT_INTERP_LINEAR) {
+        return x0 + frac * (x1 - x0);
+    }
+
+    float xm1 = edge_tap(voice, (int64_t)index - 1, looping);
+    float x2 = edge_tap(voice, (int64_t)index + 2, looping);
+    float c1 = 0.5f * (x1 - xm1);
+    float c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+    float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+
+    return ((c3 * frac + c2) * frac + c1) * frac + x0;
+}
+
+static void interp_linear(const int16_t *src, const int32_t *idx, const float *frac, float *out, uint32_t n) {
+    uint32_t k = 0;
+#if defined(SOUNDFONT_SIMD_AVX2)
+    const __m256 scale = _mm256_set1_ps(SAMPLE_SCALE);
+    for (; k + 8 <= n; k += 8) {
+        // one 32-bit gather at idx yields x[idx] in the low half and x[idx + 1] in the high half
+        __m256i pair = _mm256_i32gather_epi32((const int *)src, _mm256_loadu_si256((const __m256i *)(idx + k)), 2);
+        __m256 x0 = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(pair, 16), 16)), scale);
+        __m256 x1 = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(pair, 16)), scale);
+        __m256 f = _mm256_loadu_ps(frac + k);
+        _mm256_storeu_ps(out + k, _mm256_add_ps(x0, _mm256_mul_ps(f, _mm256_sub_ps(x1, x0))));
+    }
+#elif defined(SOUNDFONT_SIMD_SSE2)
+    const __m128 scale = _mm_set1_ps(SAMPLE_SCALE);
+    for (; k + 4 <= n; k += 4) {
+        const int32_t *i = idx + k;
+        __m128 x0 = _mm_mul_ps(_mm_setr_ps(src[i[0]], src[i[1]], src[i[2]], src[i[3]]), scale);
+        __m128 x1 = _mm_mul_ps(_mm_setr_ps(src[i[0] + 1], src[i[1] + 1], src[i[2] + 1], src[i[3] + 1]), scale);
+        __m128 f = _mm_loadu_ps(frac + k);
+        _mm_storeu_ps(out + k, _mm_add_ps(x0, _mm_mul_ps(f, _mm_sub_ps(x1, x0))));
+    }
+#elif defined(SOUNDFONT_SIMD_NEON)
+    for (; k + 4 <= n; k += 4) {
+        const int32_t *i = idx + k;
+        float a[4] = {src[i[0]], src[i[1]], src[i[2]], src[i[3]]};
+        float b[4] = {src[i[0] + 1], src[i[1] + 1], src[i[2] + 1], src[i[3] + 1]};
+        float32x4_t x0 = vmulq_n_f32(vld1q_f32(a), SAMPLE_SCALE);
+        float32x4_t x1 = vmulq_n_f32(vld1q_f32(b), SAMPLE_SCALE);
+        vst1q_f32(out + k, vmlaq_f32(x0, vld1q_f32(frac + k), vsubq_f32(x1, x0)));
+    }
+#endif
+    for (; k < n; k++) {
+        float x0 = src[idx[k]] * SAMPLE_SCALE;
+        float x1 = src[idx[k] + 1] * SAMPLE_SCALE;
+        out[k] = x0 + frac[k] * (x1 - x0);
+    }
+}
+
+static void interp_cubic(const int16_t *src, const int32_t *idx, const float *frac, float *out, uint32_t n) {
+    uint32_t k = 0;
+#if defined(SOUNDFONT_SIMD_AVX2)
+    const __m256 scale = _mm256_set1_ps(SAMPLE_SCALE);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 oneAndHalf = _mm256_set1_ps(1.5f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 twoAndHalf = _mm256_set1_ps(2.5f);
+    const __m256i one = _mm256_set1_epi32(1);
+    for (; k + 8 <= n; k += 8) {
+        __m256i i = _mm256_loadu_si256((const __m256i *)(idx + k));
+        __m256i before = _mm256_i32gather_epi32((const int *)src, _mm256_sub_epi32(i, one), 2);  // x[-1], x[0]
+        __m256i after = _mm256_i32gather_epi32((const int *)src, _mm256_add_epi32(i, one), 2);   // x[1], x[2]
+        __m256 xm1 = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(before, 16), 16)), scale);
+        __m256 x0 = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(before, 16)), scale);
+        __m256 x1 = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(after, 16), 16)), scale);
+        __m256 x2 = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(after, 16)), scale);
+
+        __m256 c1 = _mm256_mul_ps(half, _mm256_sub_ps(x1, xm1));
+        __m256 c2 = _mm256_sub_ps(_mm256_add_ps(_mm256_sub_ps(xm1, _mm256_mul_ps(twoAndHalf, x0)), _mm256_mul_ps(two, x1)), _mm256_mul_ps(half, x2));
+        __m256 c3 = _mm256_add_ps(_mm256_mul_ps(half, _mm256_sub_ps(x2, xm1)), _mm256_mul_ps(oneAndHalf, _mm256_sub_ps(x0, x1)));
+        __m256 f = _mm256_loadu_ps(frac + k);
+        __m256 y = _mm256_add_ps(_mm256_mul_ps(c3, f), c2);
+        y = _mm256_add_ps(_mm256_mul_ps(y, f), c1);
+        _mm256_storeu_ps(out + k, _mm256_add_ps(_mm256_mul_ps(y, f), x0));
+    }
+#elif defined(SOUNDFONT_SIMD_SSE2)
+    const __m128 scale = _mm_set1_ps(SAMPLE_SCALE);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 oneAndHalf = _mm_set1_ps(1.5f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 twoAndHalf = _mm_set1_ps(2.5f);
+    for (; k + 4 <= n; k += 4) {
+        const int32_t *i = idx + k;
+        __m128 xm1 = _mm_mul_ps(_mm_setr_ps(src[i[0] - 1], src[i[1] - 1], src[i[2] - 1], src[i[3] - 1]), scale);
+        __m128 x0 = _mm_mul_ps(_mm_setr_ps(src[i[0]], src[i[1]], src[i[2]], src[i[3]]), scale);
+        __m128 x1 = _mm_mul_ps(_mm_setr_ps(src[i[0] + 1], src[i[1] + 1], src[i[2] + 1], src[i[3] + 1]), scale);
+        __m128 x2 = _mm_mul_ps(_mm_setr_ps(src[i[0] + 2], src[i[1] + 2], src[i[2] + 2], src[i[3] + 2]), scale);
+
+        __m128 c1 = _mm_mul_ps(half, _mm_sub_ps(x1, xm1));
+        __m128 c2 = _mm_sub_ps(_mm_add_ps(_mm_sub_ps(xm1, _mm_mul_ps(twoAndHalf, x0)), _mm_mul_ps(two, x1)), _mm_mul_ps(half, x2));
+        __m128 c3 = _mm_add_ps(_mm_mul_ps(half, _mm_sub_ps(x2, xm1)), _mm_mul_ps(oneAndHalf, _mm_sub_ps(x0, x1)));
+        __m128 f = _mm_loadu_ps(frac + k);
+        __m128 y = _mm_add_ps(_mm_mul_ps(c3, f), c2);
+        y = _mm_add_ps(_mm_mul_ps(y, f), c1);
+        _mm_storeu_ps(out + k, _mm_add_ps(_mm_mul_ps(y, f), x0));
+    }
+#elif defined(SOUNDFONT_SIMD_NEON)
+    for (; k + 4 <= n; k += 4) {
+        const int32_t *i = idx + k;
+        float a[4] = {src[i[0] - 1], src[i[1] - 1], src[i[2] - 1], src[i[3] - 1]};
+        float b[4] = {src[i[0]], src[i[1]], src[i[2]], src[i[3]]};
+        float c[4] = {src[i[0] + 1], src[i[1] + 1], src[i[2] + 1], src[i[3] + 1]};
+        float d[4] = {src[i[0] + 2], src[i[1] + 2], src[i[2] + 2], src[i[3] + 2]};
+        float32x4_t xm1 = vmulq_n_f32(vld1q_f32(a), SAMPLE_SCALE);
+        float32x4_t x0 = vmulq_n_f32(vld1q_f32(b), SAMPLE_SCALE);
+        float32x4_t x1 = vmulq_n_f32(vld1q_f32(c), SAMPLE_SCALE);
+        float32x4_t x2 = vmulq_n_f32(vld1q_f32(d), SAMPLE_SCALE);
+
+        float32x4_t c1 = vmulq_n_f32(vsubq_f32(x1, xm1), 0.5f);
+        float32x4_t c2 = vsubq_f32(vaddq_f32(vsubq_f32(xm1, vmulq_n_f32(x0, 2.5f)), vmulq_n_f32(x1, 2.0f)), vmulq_n_f32(x2, 0.5f));
+        float32x4_t c3 = vaddq_f32(vmulq_n_f32(vsubq_f32(x2, xm1), 0.5f), vmulq_n_f32(vsubq_f32(x0, x1), 1.5f));
+        float32x4_t f = vld1q_f32(frac + k);
+        float32x4_t y = vmlaq_f32(c2, c3, f);
+        y = vmlaq_f32(c1, y, f);
+        vst1q_f32(out + k, vmlaq_f32(x0, y, f));
+    }
+#endif
+    for (; k < n; k++) {
+        float xm1 = src[idx[k] - 1] * SAMPLE_SCALE;
+        float x0 = src[idx[k]] * SAMPLE_SCALE;
+        float x1 = src[idx[k] + 1] * SAMPLE_SCALE;
+        float x2 = src[idx[k] + 2] * SAMPLE_SCALE;
+        float c1 = 0.5f * (x1 - xm1);
+        float c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+        float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+        out[k] = ((c3 * frac[k] + c2) * frac[k] + c1) * frac[k] + x0;
+    }
+}
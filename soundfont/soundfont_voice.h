@@ -0,0 +1,92 @@
+/*
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#ifndef CMANLH_SOUNDFONT_VOICE
+#define CMANLH_SOUNDFONT_VOICE
+
+#include "soundfont2.h"
+#include "soundfont_zone.h"
+
+#define SOUNDFONT_VOICE_BLOCK 64  // frames interpolated per kernel call
+
+typedef enum SoundFontInterp {
+    SOUNDFONT_INTERP_LINEAR,
+    SOUNDFONT_INTERP_CUBIC,  // 4-point Catmull-Rom
+    SOUNDFONT_INTERP_SINC    // windowed-sinc filter of the mixer, a lone SoundFontVoice plays it as cubic
+} SoundFontInterp;
+
+// values of the sampleModes generator
+typedef enum SoundFontLoopMode {
+    SOUNDFONT_LOOP_NONE = 0,
+    SOUNDFONT_LOOP_CONTINUOUS = 1,
+    SOUNDFONT_LOOP_UNUSED = 2,  // reserved by the spec, played like SOUNDFONT_LOOP_NONE
+    SOUNDFONT_LOOP_SUSTAIN = 3  // loops until the key is released, then plays to the end
+} SoundFontLoopMode;
+
+/*
+    The sample frames a voice may read. Positions are frame offsets from data, which for a view
+    made by soundfont_sample_view is the start of the smpl chunk.
+*/
+typedef struct SoundFontSampleView {
+    const int16_t *data;
+    const float *samples;  // the same frames as float32 once the sdta was converted, otherwise NULL
+    uint32_t frames;  // readable frames from data, bounds reads past end
+    uint32_t start;
+    uint32_t end;
+    uint32_t startLoop;
+    uint32_t endLoop;
+    uint32_t loopCopy;  // position of a copy of startLoop whose neighbours on both sides wrap around the loop, 0 when there is none
+    uint32_t sampleRate;
+    uint8_t originalPitch;
+    int8_t pitchCorrection;
+} SoundFontSampleView;
+
+typedef struct SoundFontVoice {
+    SoundFontSampleView view;
+    uint32_t start;  // view positions after the address offset generators
+    uint32_t end;
+    uint32_t loopStart;
+    uint32_t loopEnd;
+    uint64_t phase;      // 32.32 fixed point position from view.data
+    uint64_t increment;  // 32.32 fixed point frames per output frame
+    double pitch;        // cents relative to the sample's own pitch, from the zone
+    double rateRatio;    // sample rate over output rate
+    SoundFontLoopMode loopMode;
+    SoundFontInterp interp;
+    float gainLeft;
+    float gainRight;
+    bool released;
+    bool finished;
+} SoundFontVoice;
+
+bool soundfont_sample_view(SoundFontSampleView *view, const SoundFontSdtaData *sdta, const SoundFontSample *sample);
+void soundfont_sample_view_at(SoundFontSampleView *view, const int16_t *data, uint32_t frames, uint32_t origin, const SoundFontSample *sample);
+
+void soundfont_voice_init(SoundFontVoice *voice, const SoundFontSampleView *view, uint32_t outputRate);
+void soundfont_voice_apply_zone(SoundFontVoice *voice, const SoundFontZone *zone, uint8_t key);
+void soundfont_voice_set_pitch(SoundFontVoice *voice, double cents);
+void soundfont_voice_release(SoundFontVoice *voice);
+uint32_t soundfont_voice_render(SoundFontVoice *voice, float *left, float *right, uint32_t frames);
+
+#endif
@@ -0,0 +1,219 @@
+/*
+    RIFF file process library
+
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#include "soundfont_zone.h"
+
+// generators that a preset zone offsets, the others are only meaningful at instrument level
+static const bool ADDITIVE[SOUNDFONT_GEN_COUNT] = {
+    [SOUNDFONT_GEN_MOD_LFO_TO_PITCH] = true,
+    [SOUNDFONT_GEN_VIB_LFO_TO_PITCH] = true,
+    [SOUNDFONT_GEN_MOD_ENV_TO_PITCH] = true,
+    [SOUNDFONT_GEN_INITIAL_FILTER_FC] = true,
+    [SOUNDFONT_GEN_INITIAL_FILTER_Q] = true,
+    [SOUNDFONT_GEN_MOD_LFO_TO_FILTER_FC] = true,
+    [SOUNDFONT_GEN_MOD_ENV_TO_FILTER_FC] = true,
+    [SOUNDFONT_GEN_MOD_LFO_TO_VOLUME] = true,
+    [SOUNDFONT_GEN_CHORUS_EFFECTS_SEND] = true,
+    [SOUNDFONT_GEN_REVERB_EFFECTS_SEND] = true,
+    [SOUNDFONT_GEN_PAN] = true,
+    [SOUNDFONT_GEN_DELAY_MOD_LFO] = true,
+    [SOUNDFONT_GEN_FREQ_MOD_LFO] = true,
+    [SOUNDFONT_GEN_DELAY_VIB_LFO] = true,
+    [SOUNDFONT_GEN_FREQ_VIB_LFO] = true,
+    [SOUNDFONT_GEN_DELAY_MOD_ENV] = true,
+    [SOUNDFONT_GEN_ATTACK_MOD_ENV] = true,
+    [SOUNDFONT_GEN_HOLD_MOD_ENV] = true,
+    [SOUNDFONT_GEN_DECAY_MOD_ENV] = true,
+    [SOUNDFONT_GEN_SUSTAIN_MOD_ENV] = true,
+    [SOUNDFONT_GEN_RELEASE_MOD_ENV] = true,
+    [SOUNDFONT_GEN_KEYNUM_TO_MOD_ENV_HOLD] = true,
+    [SOUNDFONT_GEN_KEYNUM_TO_MOD_ENV_DECAY] = true,
+    [SOUNDFONT_GEN_DELAY_VOL_ENV] = true,
+    [SOUNDFONT_GEN_ATTACK_VOL_ENV] = true,
+    [SOUNDFONT_GEN_HOLD_VOL_ENV] = true,
+    [SOUNDFONT_GEN_DECAY_VOL_ENV] = true,
+    [SOUNDFONT_GEN_SUSTAIN_VOL_ENV] = true,
+    [SOUNDFONT_GEN_RELEASE_VOL_ENV] = true,
+    [SOUNDFONT_GEN_KEYNUM_TO_VOL_ENV_HOLD] = true,
+    [SOUNDFONT_GEN_KEYNUM_TO_VOL_ENV_DECAY] = true,
+    [SOUNDFONT_GEN_INITIAL_ATTENUATION] = true,
+    [SOUNDFONT_GEN_COARSE_TUNE] = true,
+    [SOUNDFONT_GEN_FINE_TUNE] = true,
+    [SOUNDFONT_GEN_SCALE_TUNING] = true};
+
+static void apply_gens(SoundFontZone *zone, const SoundFontGen *gens, uint32_t first, uint32_t last);
+static void build_level(SoundFontZone *zones, const SoundFontPdtaData *pdta, bool instLevel, uint32_t bagFirst, uint32_t bagLast, const SoundFontZone *defaults);
+
+void soundfont_init_zones(SoundFontZoneTable *table) {
+    table->memory = NULL;
+    table->presetZones = NULL;
+    table->presetZoneCount = 0;
+    table->instZones = NULL;
+    table->instZoneCount = 0;
+}
+
+void soundfont_default_zone(SoundFontZone *zone) {
+    memset(zone, 0, sizeof(SoundFontZone));
+
+    zone->gen[SOUNDFONT_GEN_INITIAL_FILTER_FC].value = 13500;
+    zone->gen[SOUNDFONT_GEN_DELAY_MOD_LFO].value = -12000;
+    zone->gen[SOUNDFONT_GEN_DELAY_VIB_LFO].value = -12000;
+    zone->gen[SOUNDFONT_GEN_DELAY_MOD_ENV].value = -12000;
+    zone->gen[SOUNDFONT_GEN_ATTACK_MOD_ENV].value = -12000;
+    zone->gen[SOUNDFONT_GEN_HOLD_MOD_ENV].value = -12000;
+    zone->gen[SOUNDFONT_GEN_DECAY_MOD_ENV].value = -12000;
+    zone->gen[SOUNDFONT_GEN_RELEASE_MOD_ENV].value = -12000;
+    zone->gen[SOUNDFONT_GEN_DELAY_VOL_ENV].value = -12000;
+    zone->gen[SOUNDFONT_GEN_ATTACK_VOL_ENV].value = -12000;
+    zone->gen[SOUNDFONT_GEN_HOLD_VOL_ENV].value = -12000;
+    zone->gen[SOUNDFONT_GEN_DECAY_VOL_ENV].value = -12000;
+    zone->gen[SOUNDFONT_GEN_RELEASE_VOL_ENV].value = -12000;
+    zone->gen[SOUNDFONT_GEN_KEY_RANGE].range.hi = 127;
+    zone->gen[SOUNDFONT_GEN_VEL_RANGE].range.hi = 127;
+    zone->gen[SOUNDFONT_GEN_KEYNUM].value = -1;
+    zone->gen[SOUNDFONT_GEN_VELOCITY].value = -1;
+    zone->gen[SOUNDFONT_GEN_SCALE_TUNING].value = 100;
+    zone->gen[SOUNDFONT_GEN_OVERRIDING_ROOT_KEY].value = -1;
+}
+
+bool soundfont_build_zones(SoundFontZoneTable *table, const SoundFontPdtaData *pdta) {
+    soundfont_init_zones(table);
+    if (!pdta->verified) {
+        printf("Zones are only built over a verified pdta.\n");
+        return false;
+    }
+
+    size_t presetBytes = sizeof(SoundFontZone) * pdta->presetIndexSize;
+    table->memory = malloc(presetBytes + sizeof(SoundFontZone) * pdta->presetIbagSize);
+    if (NULL == table->memory) {
+        printf("Not enough memory for building zones.\n");
+        return false;
+    }
+    table->presetZones = (SoundFontZone *)table->memory;
+    table->presetZoneCount = pdta->presetIndexSize;
+    table->instZones = (SoundFontZone *)((uint8_t *)table->memory + presetBytes);
+    table->instZoneCount = pdta->presetIbagSize;
+
+    // preset zones are offsets, so their defaults are zero apart from the full key and velocity ranges
+    SoundFontZone presetDefaults;
+    memset(&presetDefaults, 0, sizeof(SoundFontZone));
+    presetDefaults.gen[SOUNDFONT_GEN_KEY_RANGE].range.hi = 127;
+    presetDefaults.gen[SOUNDFONT_GEN_VEL_RANGE].range.hi = 127;
+    SoundFontZone instDefaults;
+    soundfont_default_zone(&instDefaults);
+
+    // zones no preset or instrument refers to still get sane values
+    for (uint16_t i = 0; i < table->presetZoneCount; i++) {
+        table->presetZones[i] = presetDefaults;
+    }
+    for (uint16_t i = 0; i < table->instZoneCount; i++) {
+        table->instZones[i] = instDefaults;
+    }
+
+    uint32_t bagFirst, bagLast;
+    for (int p = 0; p + 1 < pdta->presetHeaderSize; p++) {
+        soundfont_pdta_preset_zones(pdta, p, &bagFirst, &bagLast);
+        build_level(table->presetZones, pdta, false, bagFirst, bagLast, &presetDefaults);
+    }
+    for (int i = 0; i + 1 < pdta->presetInstSize; i++) {
+        soundfont_pdta_inst_zones(pdta, i, &bagFirst, &bagLast);
+        build_level(table->instZones, pdta, true, bagFirst, bagLast, &instDefaults);
+    }
+
+    return true;
+}
+
+void soundfont_release_zones(SoundFontZoneTable *table) {
+    if (NULL != table->memory) {
+        free(table->memory);
+    }
+    soundfont_init_zones(table);
+}
+
+/*
+    Combines the two levels of a region into the generator values of one voice: the instrument
+    zone plus the offsets of the preset zone, with the region's intersected ranges.
+*/
+void soundfont_resolve_zone(const SoundFontZoneTable *table, const SoundFontRegion *region, SoundFontZone *voice) {
+    const SoundFontZone *preset = table->presetZones + region->presetZone;
+    *voice = table->instZones[region->instZone];
+
+    for (int i = 0; i < SOUNDFONT_GEN_COUNT; i++) {
+        if (ADDITIVE[i]) {
+            int32_t value = voice->gen[i].value + preset->gen[i].value;
+            voice->gen[i].value = value < INT16_MIN ? INT16_MIN : (value > INT16_MAX ? INT16_MAX : value);
+        }
+    }
+    voice->gen[SOUNDFONT_GEN_KEY_RANGE].range.lo = region->keyLo;
+    voice->gen[SOUNDFONT_GEN_KEY_RANGE].range.hi = region->keyHi;
+    voice->gen[SOUNDFONT_GEN_VEL_RANGE].range.lo = region->velLo;
+    voice->gen[SOUNDFONT_GEN_VEL_RANGE].range.hi = region->velHi;
+}
+
+static void apply_gens(SoundFontZone *zone, const SoundFontGen *gens, uint32_t first, uint32_t last) {
+    for (uint32_t i = first; i < last; i++) {
+        if (gens[i].operator < SOUNDFONT_GEN_COUNT) {
+            zone->gen[gens[i].operator].word = gens[i].amount;
+        }
+    }
+}
+
+/*
+    Compiles the zones of one preset or instrument. A first zone without the link generator
+    (instrument for presets, sampleID for instruments) is the global zone and becomes the base
+    of every other zone of the same bag range. The pdta is verified, so every bag and generator
+    range is in bounds and in order.
+*/
+static void build_level(SoundFontZone *zones, const SoundFontPdtaData *pdta, bool instLevel, uint32_t bagFirst, uint32_t bagLast, const SoundFontZone *defaults) {
+    const SoundFontGen *gens = instLevel ? pdta->iGen : pdta->presetGen;
+    uint16_t linkOperator = instLevel ? SOUNDFONT_GEN_SAMPLE_ID : SOUNDFONT_GEN_INSTRUMENT;
+    SoundFontZone global = *defaults;
+
+    for (uint32_t z = bagFirst; z < bagLast; z++) {
+        uint32_t first, last;
+        if (instLevel) {
+            soundfont_pdta_inst_gens(pdta, z, &first, &last);
+        } else {
+            soundfont_pdta_preset_gens(pdta, z, &first, &last);
+        }
+
+        bool linked = false;
+        for (uint32_t i = first; i < last; i++) {
+            if (gens[i].operator == linkOperator) {
+                linked = true;
+                break;
+            }
+        }
+
+        if (!linked && z == bagFirst) {
+            apply_gens(&global, gens, first, last);
+            zones[z] = global;
+        } else {
+            zones[z] = global;
+            apply_gens(zones + z, gens, first, last);
+        }
+    }
+}
@@ -0,0 +1,65 @@
+/*
+    LICENSE (MIT)
+
+    Copyright (c) 2024 cmanlh (https://gitee.com/lifeonwalden/clib)
+                              (https://github.com/cmanlh/clib)
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#ifndef CMANLH_SOUNDFONT_ZONE
+#define CMANLH_SOUNDFONT_ZONE
+
+#include "soundfont2.h"
+#include "soundfont_region.h"
+
+typedef union SoundFontGenAmount {
+    int16_t value;  // signed generators, in their spec units
+    uint16_t word;  // instrument, sampleID and sampleModes
+    struct {
+        uint8_t lo;
+        uint8_t hi;
+    } range;  // keyRange and velRange
+} SoundFontGenAmount;
+
+/*
+    Every generator of a zone at a fixed slot. Instrument zones hold absolute values with the spec
+    defaults and the instrument global zone applied. Preset zones hold the additive offsets with
+    the preset global zone applied, so a voice value is the instrument slot plus the preset slot.
+*/
+typedef struct SoundFontZone {
+    SoundFontGenAmount gen[SOUNDFONT_GEN_COUNT];
+    uint16_t padding[3];  // keeps a zone at exactly two cache lines
+} SoundFontZone;
+
+typedef struct SoundFontZoneTable {
+    void *memory;
+    SoundFontZone *presetZones;  // indexed like presetIndex
+    uint16_t presetZoneCount;
+    SoundFontZone *instZones;  // indexed like presetIbag
+    uint16_t instZoneCount;
+} SoundFontZoneTable;
+
+void soundfont_init_zones(SoundFontZoneTable *table);
+bool soundfont_build_zones(SoundFontZoneTable *table, const SoundFontPdtaData *pdta);
+void soundfont_release_zones(SoundFontZoneTable *table);
+
+void soundfont_default_zone(SoundFontZone *zone);
+void soundfont_resolve_zone(const SoundFontZoneTable *table, const SoundFontRegion *region, SoundFontZone *voice);
+
+#endif